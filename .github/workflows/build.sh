@@ -26,5 +26,5 @@
 
 mkdir build
 cd build
-cmake -DENABLE_DISCOVER_EXAMPLES=ON ..
+cmake -DENABLE_DISCOVER_EXAMPLES=ON -DENABLE_DISCOVER_BENCHMARKS=ON ..
 make -j$(nproc)
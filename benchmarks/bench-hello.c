@@ -0,0 +1,112 @@
+/**
+ * @file      bench-hello.c
+ * @brief     Benchmark of the handling of the hello messages
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021-2023 joelguittet and c-discover contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/******************************************************************************/
+/* Definitions                                                                */
+/******************************************************************************/
+
+/* Port used by the benchmark */
+#define BENCH_HELLO_PORT 12500
+
+/******************************************************************************/
+/* Functions                                                                  */
+/******************************************************************************/
+
+/**
+ * @brief Main function
+ * @param argc Number of arguments
+ * @param argv Arguments, the number of peers and the number of rounds can be given
+ * @return 0 if the benchmark succeeded, 1 otherwise
+ */
+int
+main(int argc, char **argv) {
+
+    int peers  = (1 < argc) ? atoi(argv[1]) : 1000;
+    int rounds = (2 < argc) ? atoi(argv[2]) : 20;
+
+    /* Create the instance under test, the messages are handled by discover_process so that the measure doesn't depend on the threads */
+    discover_t *discover = bench_create_instance(BENCH_HELLO_PORT, false);
+    if ((NULL == discover) || (0 != discover_start(discover))) {
+        printf("unable to start discover instance\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Create the injector */
+    bench_injector_t injector;
+    if (0 != bench_injector_create(&injector, BENCH_HELLO_PORT)) {
+        printf("unable to create injector\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Send and receive the hello message of the instance before measuring */
+    discover_process(discover, bench_get_time() / 1000);
+    usleep(10000);
+    discover_process(discover, bench_get_time() / 1000);
+
+    /* First round, the nodes are created */
+    uint64_t created = 0;
+    if (0 != bench_injector_process_hellos(&injector, discover, 0, peers, &created)) {
+        printf("messages lost\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Next rounds, the nodes are updated */
+    uint64_t updated = 0;
+    for (int round = 1; round < rounds; round++) {
+        uint64_t duration = 0;
+        if (0 != bench_injector_process_hellos(&injector, discover, 0, peers, &duration)) {
+            printf("messages lost\n");
+            exit(EXIT_FAILURE);
+        }
+        updated += duration;
+    }
+
+    /* Print the results */
+    bench_report("hello.peers", peers, "nodes");
+    bench_report("hello.create.cost", (double)created / peers, "us/msg");
+    bench_report("hello.create.throughput", 1000000.0 * peers / created, "msg/s");
+    if (1 < rounds) {
+        bench_report("hello.update.cost", (double)updated / ((rounds - 1) * (double)peers), "us/msg");
+        bench_report("hello.update.throughput", 1000000.0 * (rounds - 1) * peers / updated, "msg/s");
+    }
+
+    /* Release memory */
+    bench_injector_release(&injector);
+    discover_release(discover);
+
+    return 0;
+}
@@ -0,0 +1,297 @@
+/**
+ * @file      bench-latency.c
+ * @brief     Benchmark of the end-to-end latency of the messages and of the events
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021-2023 joelguittet and c-discover contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <semaphore.h>
+
+#include "bench.h"
+
+/******************************************************************************/
+/* Definitions                                                                */
+/******************************************************************************/
+
+/* Port used by the benchmark */
+#define BENCH_LATENCY_PORT 12503
+
+/* Benchmark context structure */
+typedef struct {
+    uint64_t  received; /* Time the last callback has been invoked, in microseconds */
+    uint64_t *samples;  /* Latencies measured, in microseconds */
+    sem_t     sem;      /* Semaphore posted when the callback is invoked */
+} bench_latency_t;
+
+/******************************************************************************/
+/* Prototypes                                                                 */
+/******************************************************************************/
+
+/**
+ * @brief Callback function invoked when a message is received on the benchmark channel
+ * @param discover Discover instance
+ * @param event Event
+ * @param data Data
+ * @param user User data
+ */
+static void *bench_latency_message_cb(discover_t *discover, char *event, cJSON *data, void *user);
+
+/**
+ * @brief Callback function invoked when a hello message is received
+ * @param discover Discover instance
+ * @param node Node
+ * @param user User data
+ */
+static void *bench_latency_hello_cb(discover_t *discover, discover_node_t *node, void *user);
+
+/**
+ * @brief Wait for the callback to be invoked
+ * @param latency Benchmark context
+ * @return 0 if the callback has been invoked, -1 if it has not been invoked within one second
+ */
+static int bench_latency_wait(bench_latency_t *latency);
+
+/**
+ * @brief Compare two latencies, used to sort the samples
+ * @param a First latency
+ * @param b Second latency
+ * @return Negative, zero or positive value as the first latency is lower, equal or greater than the second one
+ */
+static int bench_latency_compare(const void *a, const void *b);
+
+/**
+ * @brief Print the minimum, average and percentiles of the latencies measured
+ * @param prefix Prefix of the names of the results
+ * @param samples Latencies measured
+ * @param count Number of latencies
+ */
+static void bench_latency_report(const char *prefix, uint64_t *samples, int count);
+
+/******************************************************************************/
+/* Functions                                                                  */
+/******************************************************************************/
+
+/**
+ * @brief Main function
+ * @param argc Number of arguments
+ * @param argv Arguments, the number of samples can be given
+ * @return 0 if the benchmark succeeded, 1 otherwise
+ */
+int
+main(int argc, char **argv) {
+
+    int             count = (1 < argc) ? atoi(argv[1]) : 2000;
+    bench_latency_t latency;
+
+    /* Initialize the context */
+    if (0 >= count) {
+        printf("invalid number of samples\n");
+        exit(EXIT_FAILURE);
+    }
+    latency.samples = (uint64_t *)malloc(count * sizeof(uint64_t));
+    if (NULL == latency.samples) {
+        printf("unable to allocate memory\n");
+        exit(EXIT_FAILURE);
+    }
+    sem_init(&latency.sem, 0, 0);
+
+    /* Create the instance under test, its own messages are received so that the complete path is measured */
+    discover_t *discover = bench_create_instance(BENCH_LATENCY_PORT, true);
+    if (NULL == discover) {
+        printf("unable to create discover instance\n");
+        exit(EXIT_FAILURE);
+    }
+    bool ignore = false;
+    discover_set_option(discover, "ignoreProcess", &ignore);
+    discover_set_option(discover, "ignoreInstance", &ignore);
+    if (0 != discover_start(discover)) {
+        printf("unable to start discover instance\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Create the injector */
+    bench_injector_t injector;
+    if (0 != bench_injector_create(&injector, BENCH_LATENCY_PORT)) {
+        printf("unable to create injector\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Let the hello message of the instance being handled before registering the callbacks */
+    usleep(100000);
+    discover_join(discover, "bench", &bench_latency_message_cb, &latency);
+    discover_on(discover, "helloReceived", &bench_latency_hello_cb, &latency);
+
+    /* Latency from discover_send to the channel callback, one message at a time */
+    cJSON *data = cJSON_CreateObject();
+    cJSON_AddStringToObject(data, "status", "ready");
+    for (int index = 0; index < count; index++) {
+        uint64_t start = bench_get_time();
+        if ((0 != discover_send(discover, "bench", data)) || (0 != bench_latency_wait(&latency))) {
+            printf("message %d lost\n", index);
+            exit(EXIT_FAILURE);
+        }
+        latency.samples[index] = latency.received - start;
+    }
+    cJSON_Delete(data);
+    bench_latency_report("latency.message", latency.samples, count);
+
+    /* Latency from the reception of a hello message to the helloReceived callback */
+    for (int index = 0; index < count; index++) {
+        uint64_t start = bench_get_time();
+        if ((0 != bench_injector_send_hello(&injector, index)) || (0 != bench_latency_wait(&latency))) {
+            printf("hello %d lost\n", index);
+            exit(EXIT_FAILURE);
+        }
+        latency.samples[index] = latency.received - start;
+    }
+    bench_latency_report("latency.hello", latency.samples, count);
+
+    /* Release memory */
+    bench_injector_release(&injector);
+    discover_release(discover);
+    sem_destroy(&latency.sem);
+    free(latency.samples);
+
+    return 0;
+}
+
+/**
+ * @brief Callback function invoked when a message is received on the benchmark channel
+ * @param discover Discover instance
+ * @param event Event
+ * @param data Data
+ * @param user User data
+ */
+static void *
+bench_latency_message_cb(discover_t *discover, char *event, cJSON *data, void *user) {
+
+    (void)discover;
+    (void)event;
+    (void)data;
+    bench_latency_t *latency = (bench_latency_t *)user;
+
+    /* Record the time and wake up the benchmark */
+    latency->received = bench_get_time();
+    sem_post(&latency->sem);
+
+    return NULL;
+}
+
+/**
+ * @brief Callback function invoked when a hello message is received
+ * @param discover Discover instance
+ * @param node Node
+ * @param user User data
+ */
+static void *
+bench_latency_hello_cb(discover_t *discover, discover_node_t *node, void *user) {
+
+    (void)discover;
+    (void)node;
+    bench_latency_t *latency = (bench_latency_t *)user;
+
+    /* Record the time and wake up the benchmark */
+    latency->received = bench_get_time();
+    sem_post(&latency->sem);
+
+    return NULL;
+}
+
+/**
+ * @brief Wait for the callback to be invoked
+ * @param latency Benchmark context
+ * @return 0 if the callback has been invoked, -1 if it has not been invoked within one second
+ */
+static int
+bench_latency_wait(bench_latency_t *latency) {
+
+    struct timespec ts;
+
+    /* Compute the deadline, sem_timedwait uses the realtime clock */
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += 1;
+
+    /* Wait for the callback */
+    while (0 != sem_timedwait(&latency->sem, &ts)) {
+        if (ETIMEDOUT == errno) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Compare two latencies, used to sort the samples
+ * @param a First latency
+ * @param b Second latency
+ * @return Negative, zero or positive value as the first latency is lower, equal or greater than the second one
+ */
+static int
+bench_latency_compare(const void *a, const void *b) {
+
+    uint64_t first  = *((const uint64_t *)a);
+    uint64_t second = *((const uint64_t *)b);
+
+    return (first < second) ? -1 : ((first > second) ? 1 : 0);
+}
+
+/**
+ * @brief Print the minimum, average and percentiles of the latencies measured
+ * @param prefix Prefix of the names of the results
+ * @param samples Latencies measured
+ * @param count Number of latencies
+ */
+static void
+bench_latency_report(const char *prefix, uint64_t *samples, int count) {
+
+    char     name[64];
+    uint64_t sum = 0;
+
+    /* Sort the samples to retrieve the percentiles */
+    qsort(samples, count, sizeof(uint64_t), &bench_latency_compare);
+    for (int index = 0; index < count; index++) {
+        sum += samples[index];
+    }
+
+    /* Print the results */
+    snprintf(name, sizeof(name), "%s.min", prefix);
+    bench_report(name, (double)samples[0], "us");
+    snprintf(name, sizeof(name), "%s.avg", prefix);
+    bench_report(name, (double)sum / count, "us");
+    snprintf(name, sizeof(name), "%s.p50", prefix);
+    bench_report(name, (double)samples[count / 2], "us");
+    snprintf(name, sizeof(name), "%s.p99", prefix);
+    bench_report(name, (double)samples[(count * 99) / 100], "us");
+    snprintf(name, sizeof(name), "%s.max", prefix);
+    bench_report(name, (double)samples[count - 1], "us");
+}
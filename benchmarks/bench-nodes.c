@@ -0,0 +1,176 @@
+/**
+ * @file      bench-nodes.c
+ * @brief     Benchmark of the lookup and expiry of the nodes depending on the number of nodes
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021-2023 joelguittet and c-discover contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+/******************************************************************************/
+/* Definitions                                                                */
+/******************************************************************************/
+
+/* Port used by the benchmark */
+#define BENCH_NODES_PORT 12501
+
+/* Number of lookups measured for each number of nodes */
+#define BENCH_NODES_LOOKUPS 100000
+
+/******************************************************************************/
+/* Prototypes                                                                 */
+/******************************************************************************/
+
+/**
+ * @brief Measure the cost of the nodes operations with the wanted number of nodes
+ * @param count Number of nodes
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int bench_nodes_run(int count);
+
+/******************************************************************************/
+/* Functions                                                                  */
+/******************************************************************************/
+
+/**
+ * @brief Main function
+ * @param argc Number of arguments
+ * @param argv Arguments, the maximum number of nodes can be given
+ * @return 0 if the benchmark succeeded, 1 otherwise
+ */
+int
+main(int argc, char **argv) {
+
+    int max = (1 < argc) ? atoi(argv[1]) : 10000;
+
+    /* Number of nodes is multiplied by 10 at each step */
+    for (int count = 10; count <= max; count *= 10) {
+        if (0 != bench_nodes_run(count)) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Measure the cost of the nodes operations with the wanted number of nodes
+ * @param count Number of nodes
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+bench_nodes_run(int count) {
+
+    char             name[64];
+    char             pid[DISCOVER_NODE_UUID_SIZE];
+    char             iid[DISCOVER_NODE_UUID_SIZE];
+    discover_stats_t stats;
+    uint64_t         duration;
+    int              ret = -1;
+
+    /* Create the instance under test, the messages are handled by discover_process so that the measure doesn't depend on the threads */
+    discover_t *discover = bench_create_instance(BENCH_NODES_PORT, false);
+    if ((NULL == discover) || (0 != discover_start(discover))) {
+        printf("unable to start discover instance\n");
+        goto END;
+    }
+
+    /* Create the injector */
+    bench_injector_t injector;
+    if (0 != bench_injector_create(&injector, BENCH_NODES_PORT)) {
+        printf("unable to create injector\n");
+        goto END;
+    }
+
+    /* Insertion of the nodes */
+    if (0 != bench_injector_process_hellos(&injector, discover, 0, count, &duration)) {
+        printf("messages lost\n");
+        goto RELEASE;
+    }
+    discover_get_stats(discover, &stats);
+    if (count != (int)stats.nodes_count) {
+        printf("%d nodes expected, %d nodes found\n", count, (int)stats.nodes_count);
+        goto RELEASE;
+    }
+    snprintf(name, sizeof(name), "nodes.%d.insert", count);
+    bench_report(name, (double)duration / count, "us/node");
+
+    /* Refresh of the nodes */
+    if (0 != bench_injector_process_hellos(&injector, discover, 0, count, &duration)) {
+        printf("messages lost\n");
+        goto RELEASE;
+    }
+    snprintf(name, sizeof(name), "nodes.%d.refresh", count);
+    bench_report(name, (double)duration / count, "us/node");
+
+    /* Lookup of the nodes, the peers are visited in a different order than the insertion */
+    uint64_t start = bench_get_time();
+    for (int index = 0; index < BENCH_NODES_LOOKUPS; index++) {
+        bench_peer_uuids((int)(((unsigned int)index * 2654435761u) % (unsigned int)count), pid, iid);
+        discover_node_t *node = discover_find_node(discover, pid, iid);
+        if (NULL == node) {
+            printf("node %s not found\n", pid);
+            goto RELEASE;
+        }
+        discover_node_release(node);
+    }
+    duration = bench_get_time() - start;
+    snprintf(name, sizeof(name), "nodes.%d.lookup", count);
+    bench_report(name, 1000.0 * duration / BENCH_NODES_LOOKUPS, "ns/lookup");
+
+    /* Expiry of all the nodes, the clock given to discover_process is advanced after the timeout of the nodes */
+    start = bench_get_time();
+    discover_process(discover, start / 1000 + 2 * BENCH_NODE_TIMEOUT);
+    duration = bench_get_time() - start;
+    discover_get_stats(discover, &stats);
+    if (0 != stats.nodes_count) {
+        printf("%d nodes not expired\n", (int)stats.nodes_count);
+        goto RELEASE;
+    }
+    snprintf(name, sizeof(name), "nodes.%d.expiry", count);
+    bench_report(name, 1000.0 * duration / count, "ns/node");
+
+    /* Benchmark succeeded */
+    ret = 0;
+
+RELEASE:
+
+    /* Release memory */
+    bench_injector_release(&injector);
+
+END:
+
+    /* Release memory */
+    if (NULL != discover) {
+        discover_release(discover);
+    }
+
+    return ret;
+}
@@ -0,0 +1,162 @@
+/**
+ * @file      bench-send.c
+ * @brief     Benchmark of the throughput of discover_send
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021-2023 joelguittet and c-discover contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+
+#include "bench.h"
+
+/******************************************************************************/
+/* Definitions                                                                */
+/******************************************************************************/
+
+/* Port used by the benchmark */
+#define BENCH_SEND_PORT 12502
+
+/******************************************************************************/
+/* Prototypes                                                                 */
+/******************************************************************************/
+
+/**
+ * @brief Measure the throughput of discover_send
+ * @param threaded true to send the messages using the sender thread, false to send the messages from the calling thread
+ * @param count Number of messages
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int bench_send_run(bool threaded, int count);
+
+/******************************************************************************/
+/* Functions                                                                  */
+/******************************************************************************/
+
+/**
+ * @brief Main function
+ * @param argc Number of arguments
+ * @param argv Arguments, the number of messages can be given
+ * @return 0 if the benchmark succeeded, 1 otherwise
+ */
+int
+main(int argc, char **argv) {
+
+    int count = (1 < argc) ? atoi(argv[1]) : 100000;
+
+    /* Measure the throughput with and without the sender thread */
+    if ((0 != bench_send_run(true, count)) || (0 != bench_send_run(false, count))) {
+        exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Measure the throughput of discover_send
+ * @param threaded true to send the messages using the sender thread, false to send the messages from the calling thread
+ * @param count Number of messages
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+bench_send_run(bool threaded, int count) {
+
+    char *           mode = (true == threaded) ? "threaded" : "direct";
+    char             name[64];
+    discover_stats_t stats;
+    uint64_t         retries = 0;
+    int              ret     = -1;
+
+    /* Create the instance under test */
+    discover_t *discover = bench_create_instance(BENCH_SEND_PORT, threaded);
+    if ((NULL == discover) || (0 != discover_start(discover))) {
+        printf("unable to start discover instance\n");
+        goto END;
+    }
+
+    /* Create the message sent, similar to the small notifications usually exchanged */
+    cJSON *data = cJSON_CreateObject();
+    if (NULL == data) {
+        printf("unable to create message\n");
+        goto END;
+    }
+    cJSON_AddStringToObject(data, "status", "ready");
+    cJSON_AddNumberToObject(data, "sequence", 0);
+
+    /* Retrieve the number of datagrams already sent, including the ones the system failed to send */
+    discover_get_stats(discover, &stats);
+    uint64_t expected = stats.tx_packets + stats.tx_errors + (uint64_t)count;
+
+    /* Send the messages, retry when the send queue is full */
+    uint64_t start = bench_get_time();
+    for (int index = 0; index < count; index++) {
+        while (0 != discover_send(discover, "bench", data)) {
+            retries++;
+            sched_yield();
+        }
+    }
+    uint64_t queued = bench_get_time() - start;
+
+    /* Wait for all the datagrams to be sent */
+    uint64_t deadline = bench_get_time() + 10000000;
+    do {
+        discover_get_stats(discover, &stats);
+    } while ((stats.tx_packets + stats.tx_errors < expected) && (bench_get_time() < deadline));
+    uint64_t duration = bench_get_time() - start;
+    if (stats.tx_packets + stats.tx_errors < expected) {
+        printf("%d datagrams not sent\n", (int)(expected - stats.tx_packets - stats.tx_errors));
+        goto RELEASE;
+    }
+
+    /* Print the results */
+    snprintf(name, sizeof(name), "send.%s.call", mode);
+    bench_report(name, (double)queued / count, "us/msg");
+    snprintf(name, sizeof(name), "send.%s.throughput", mode);
+    bench_report(name, 1000000.0 * count / duration, "msg/s");
+    snprintf(name, sizeof(name), "send.%s.retries", mode);
+    bench_report(name, (double)retries, "calls");
+    snprintf(name, sizeof(name), "send.%s.errors", mode);
+    bench_report(name, (double)stats.tx_errors, "msgs");
+
+    /* Benchmark succeeded */
+    ret = 0;
+
+RELEASE:
+
+    /* Release memory */
+    cJSON_Delete(data);
+
+END:
+
+    /* Release memory */
+    if (NULL != discover) {
+        discover_release(discover);
+    }
+
+    return ret;
+}
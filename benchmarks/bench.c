@@ -0,0 +1,245 @@
+/**
+ * @file      bench.c
+ * @brief     Helpers shared by the discover benchmarks
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021-2023 joelguittet and c-discover contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <assert.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "bench.h"
+
+/******************************************************************************/
+/* Functions                                                                  */
+/******************************************************************************/
+
+/**
+ * @brief Retrieve the current time of the monotonic clock
+ * @return Time in microseconds
+ */
+uint64_t
+bench_get_time(void) {
+
+    /* The monotonic clock is not affected by the changes of the system time */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Create a discover instance bound to the loopback interface, using unicast so that the messages don't leave the host
+ * @param port Port
+ * @param threaded false to create no thread, the benchmark then calls discover_process
+ * @return Discover instance if the function succeeded, NULL otherwise
+ */
+discover_t *
+bench_create_instance(uint16_t port, bool threaded) {
+
+    /* Create discover instance */
+    discover_t *discover = discover_create();
+    if (NULL == discover) {
+        /* Unable to create instance */
+        return NULL;
+    }
+
+    /* Set options, the hello messages of the instance are rare and the nodes don't expire so that they don't disturb the measures */
+    int  hello_interval = 60000;
+    int  node_timeout   = BENCH_NODE_TIMEOUT;
+    bool reuse_addr     = true;
+    discover_set_option(discover, "address", BENCH_ADDRESS);
+    discover_set_option(discover, "unicast", BENCH_ADDRESS);
+    discover_set_option(discover, "port", &port);
+    discover_set_option(discover, "reuseAddr", &reuse_addr);
+    discover_set_option(discover, "helloInterval", &hello_interval);
+    discover_set_option(discover, "masterTimeout", &node_timeout);
+    discover_set_option(discover, "nodeTimeout", &node_timeout);
+    discover_set_option(discover, "threaded", &threaded);
+
+    return discover;
+}
+
+/**
+ * @brief Format the UUIDs of a simulated peer
+ * @param peer Index of the peer
+ * @param pid Process UUID of the peer
+ * @param iid Instance UUID of the peer
+ */
+void
+bench_peer_uuids(int peer, char *pid, char *iid) {
+
+    assert(NULL != pid);
+    assert(NULL != iid);
+
+    /* The UUIDs are derived from the index, so that the peers can be found again */
+    sprintf(pid, "00000000-0000-4000-8000-%012x", (unsigned int)peer);
+    sprintf(iid, "00000000-0000-4000-9000-%012x", (unsigned int)peer);
+}
+
+/**
+ * @brief Create a loopback packet injector
+ * @param injector Injector
+ * @param port Port of the instance under test
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+bench_injector_create(bench_injector_t *injector, uint16_t port) {
+
+    assert(NULL != injector);
+
+    /* Create the socket */
+    injector->socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (0 > injector->socket) {
+        /* Unable to create socket */
+        return -1;
+    }
+
+    /* Set the address of the instance under test */
+    memset(&injector->destination, 0, sizeof(struct sockaddr_in));
+    injector->destination.sin_family      = AF_INET;
+    injector->destination.sin_port        = htons(port);
+    injector->destination.sin_addr.s_addr = inet_addr(BENCH_ADDRESS);
+
+    return 0;
+}
+
+/**
+ * @brief Send the hello message of a simulated peer
+ * @param injector Injector
+ * @param peer Index of the peer
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+bench_injector_send_hello(bench_injector_t *injector, int peer) {
+
+    assert(NULL != injector);
+
+    /* Format the hello message, the same as the ones sent by discover Node.js version */
+    char pid[36 + 1];
+    char iid[36 + 1];
+    char buffer[512];
+    bench_peer_uuids(peer, pid, iid);
+    int size = snprintf(buffer,
+                        sizeof(buffer),
+                        "{\"event\":\"hello\",\"pid\":\"%s\",\"iid\":\"%s\",\"hostName\":\"peer-%d\",\"data\":{\"isMaster\":false,"
+                        "\"isMasterEligible\":true,\"weight\":%d.5,\"address\":\"" BENCH_ADDRESS "\"}}",
+                        pid,
+                        iid,
+                        peer,
+                        peer);
+
+    /* Send the message */
+    if (size != sendto(injector->socket, buffer, size, 0, (struct sockaddr *)&injector->destination, sizeof(struct sockaddr_in))) {
+        /* Unable to send data */
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Inject the hello messages of simulated peers to a non-threaded instance and measure the time spent handling them
+ * @param injector Injector
+ * @param discover Discover instance
+ * @param first First peer
+ * @param count Number of peers
+ * @param duration Time spent handling the messages in microseconds
+ * @return 0 if the function succeeded, -1 if messages have been lost
+ */
+int
+bench_injector_process_hellos(bench_injector_t *injector, discover_t *discover, int first, int count, uint64_t *duration) {
+
+    discover_stats_t stats;
+
+    assert(NULL != injector);
+    assert(NULL != discover);
+    assert(NULL != duration);
+
+    /* Retrieve the number of messages already received */
+    discover_get_stats(discover, &stats);
+    uint64_t expected = stats.rx_packets;
+
+    /* Inject the messages by batches, only the handling of the messages is measured */
+    *duration = 0;
+    for (int batch = first; batch < first + count; batch += BENCH_INJECT_BATCH) {
+        for (int peer = batch; (peer < batch + BENCH_INJECT_BATCH) && (peer < first + count); peer++) {
+            if (0 == bench_injector_send_hello(injector, peer)) {
+                expected++;
+            }
+        }
+        uint64_t start    = bench_get_time();
+        uint64_t deadline = start + 1000000;
+        do {
+            discover_process(discover, bench_get_time() / 1000);
+            discover_get_stats(discover, &stats);
+        } while ((stats.rx_packets < expected) && (bench_get_time() < deadline));
+        if (stats.rx_packets < expected) {
+            /* Messages lost */
+            return -1;
+        }
+        *duration += bench_get_time() - start;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Release a loopback packet injector
+ * @param injector Injector
+ */
+void
+bench_injector_release(bench_injector_t *injector) {
+
+    assert(NULL != injector);
+
+    /* Close the socket */
+    close(injector->socket);
+}
+
+/**
+ * @brief Print a benchmark result, one line per result so that they can be compared by a script
+ * @param name Name of the result
+ * @param value Value
+ * @param unit Unit of the value
+ */
+void
+bench_report(const char *name, double value, const char *unit) {
+
+    assert(NULL != name);
+    assert(NULL != unit);
+
+    /* Print the result */
+    printf("%-40s %14.3f %s\n", name, value, unit);
+    fflush(stdout);
+}
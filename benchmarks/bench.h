@@ -0,0 +1,135 @@
+/**
+ * @file      bench.h
+ * @brief     Helpers shared by the discover benchmarks
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021-2023 joelguittet and c-discover contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <netinet/in.h>
+
+#include "discover.h"
+
+/******************************************************************************/
+/* Definitions                                                                */
+/******************************************************************************/
+
+/* Address used by the benchmarks, so that no real network is needed */
+#define BENCH_ADDRESS "127.0.0.1"
+
+/* Timeout of the nodes, in milliseconds, long enough so that the nodes only expire when the benchmark wants it */
+#define BENCH_NODE_TIMEOUT 600000
+
+/* Number of messages injected before they are handled, small enough to fit in the socket buffer */
+#define BENCH_INJECT_BATCH 128
+
+/* Loopback packet injector, sends the messages of simulated peers to the instance under test */
+typedef struct {
+    int                socket;      /* Socket used to send the messages */
+    struct sockaddr_in destination; /* Address of the instance under test */
+} bench_injector_t;
+
+/******************************************************************************/
+/* Prototypes                                                                 */
+/******************************************************************************/
+
+/**
+ * @brief Retrieve the current time of the monotonic clock
+ * @return Time in microseconds
+ */
+uint64_t bench_get_time(void);
+
+/**
+ * @brief Create a discover instance bound to the loopback interface, using unicast so that the messages don't leave the host
+ * @param port Port
+ * @param threaded false to create no thread, the benchmark then calls discover_process
+ * @return Discover instance if the function succeeded, NULL otherwise
+ */
+discover_t *bench_create_instance(uint16_t port, bool threaded);
+
+/**
+ * @brief Format the UUIDs of a simulated peer
+ * @param peer Index of the peer
+ * @param pid Process UUID of the peer
+ * @param iid Instance UUID of the peer
+ */
+void bench_peer_uuids(int peer, char *pid, char *iid);
+
+/**
+ * @brief Create a loopback packet injector
+ * @param injector Injector
+ * @param port Port of the instance under test
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int bench_injector_create(bench_injector_t *injector, uint16_t port);
+
+/**
+ * @brief Send the hello message of a simulated peer
+ * @param injector Injector
+ * @param peer Index of the peer
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int bench_injector_send_hello(bench_injector_t *injector, int peer);
+
+/**
+ * @brief Inject the hello messages of simulated peers to a non-threaded instance and measure the time spent handling them
+ * @param injector Injector
+ * @param discover Discover instance
+ * @param first First peer
+ * @param count Number of peers
+ * @param duration Time spent handling the messages in microseconds
+ * @return 0 if the function succeeded, -1 if messages have been lost
+ */
+int bench_injector_process_hellos(bench_injector_t *injector, discover_t *discover, int first, int count, uint64_t *duration);
+
+/**
+ * @brief Release a loopback packet injector
+ * @param injector Injector
+ */
+void bench_injector_release(bench_injector_t *injector);
+
+/**
+ * @brief Print a benchmark result, one line per result so that they can be compared by a script
+ * @param name Name of the result
+ * @param value Value
+ * @param unit Unit of the value
+ */
+void bench_report(const char *name, double value, const char *unit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BENCH_H__ */
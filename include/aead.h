@@ -0,0 +1,131 @@
+/**
+ * @file      aead.h
+ * @brief     Authenticated encryption of the messages
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021-2023 joelguittet and c-discover contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __AEAD_H__
+#define __AEAD_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <semaphore.h>
+
+/******************************************************************************/
+/* Definitions                                                                */
+/******************************************************************************/
+
+/* Magic byte starting encrypted messages */
+#define AEAD_MAGIC 0xD6
+
+/* Version of the encryption format */
+#define AEAD_VERSION 1
+
+/* Sizes of the header, nonce and authentication tag of the encrypted messages */
+#define AEAD_HEADER_SIZE 2
+#define AEAD_NONCE_SIZE  12
+#define AEAD_TAG_SIZE    16
+
+/* Number of bytes added to the messages when they are encrypted */
+#define AEAD_OVERHEAD (AEAD_HEADER_SIZE + AEAD_NONCE_SIZE + AEAD_TAG_SIZE)
+
+/* Maximum number of senders whose replay windows are tracked, the least recently seen one is replaced when the table is full */
+#define AEAD_REPLAY_SENDERS 256
+
+/* Size of the replay window, at most 64 as the window is a 64 bits bitmap, counters older than the highest one received minus this size are dropped */
+#define AEAD_REPLAY_WINDOW 64
+
+/* Replay window of a sender, identified by the prefix of its nonces */
+typedef struct {
+    uint8_t  prefix[4]; /* Prefix of the nonces of the sender */
+    uint64_t highest;   /* Highest counter received from the sender */
+    uint64_t window;    /* Bitmap of the counters received below the highest one, bit 0 is the highest one */
+    uint64_t seen;      /* Sequence number of the last message received from the sender, used to replace the least recently seen sender */
+} aead_replay_t;
+
+/* AEAD instance structure, ChaCha20-Poly1305 */
+typedef struct aead_s {
+    uint32_t key[8];    /* ChaCha20 key words, derived once from the passphrase */
+    uint8_t  prefix[4]; /* Random prefix of the nonces of the instance */
+    uint64_t counter;   /* Counter used to generate unique nonces, starting at a random value */
+    struct {
+        aead_replay_t senders[AEAD_REPLAY_SENDERS]; /* Replay windows of the senders */
+        int           count;                        /* Number of senders tracked */
+        uint64_t      sequence;                     /* Sequence number of the last message received */
+        sem_t         sem;                          /* Semaphore used to protect the replay windows, messages are decrypted from several threads */
+    } replay;
+} aead_t;
+
+/******************************************************************************/
+/* Prototypes                                                                 */
+/******************************************************************************/
+
+/**
+ * @brief Function used to create an AEAD instance
+ * @param passphrase Passphrase from which the key is derived
+ * @return AEAD instance if the function succeeded, NULL otherwise
+ */
+aead_t *aead_create(const char *passphrase);
+
+/**
+ * @brief Encrypt and authenticate a message
+ * @param aead AEAD instance
+ * @param buffer Message
+ * @param size Size of the message
+ * @param encrypted_size Size of the encrypted message
+ * @return Encrypted message if the function succeeded, NULL otherwise, it must be released by the caller
+ */
+void *aead_encrypt(aead_t *aead, void *buffer, size_t size, size_t *encrypted_size);
+
+/**
+ * @brief Authenticate and decrypt a message in place
+ * @param aead AEAD instance
+ * @param buffer Encrypted message
+ * @param size Size of the encrypted message
+ * @param message Decrypted message, pointing to the buffer
+ * @param message_size Size of the decrypted message
+ * @return 0 if the function succeeded, -1 if the message is invalid, can't be authenticated or is replayed
+ */
+int aead_decrypt(aead_t *aead, void *buffer, size_t size, void **message, size_t *message_size);
+
+/**
+ * @brief Release AEAD instance
+ * @param aead AEAD instance
+ */
+void aead_release(aead_t *aead);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AEAD_H__ */
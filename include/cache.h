@@ -0,0 +1,126 @@
+/**
+ * @file      cache.h
+ * @brief     Persistent cache of the nodes
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021-2023 joelguittet and c-discover contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+/******************************************************************************/
+/* Definitions                                                                */
+/******************************************************************************/
+
+/* Magic number starting the cache files */
+#define CACHE_MAGIC 0x43435344
+
+/* Version of the cache files */
+#define CACHE_VERSION 1
+
+/* Size of a UUID as a string, including the null character */
+#define CACHE_UUID_STR_SIZE (36 + 1)
+
+/* Size of an address as a string, including the null character */
+#define CACHE_ADDRESS_STR_SIZE (45 + 1)
+
+/* Node of the cache */
+typedef struct {
+    char     pid[CACHE_UUID_STR_SIZE];              /* Process UUID */
+    char     iid[CACHE_UUID_STR_SIZE];              /* Instance UUID */
+    char *   hostname;                              /* Hostname, NULL if it is unknown */
+    char     address[CACHE_ADDRESS_STR_SIZE];       /* Address of the node */
+    uint16_t port;                                  /* Port of the node */
+    time_t   last_seen;                             /* Last time the node has been seen */
+    bool     is_master;                             /* true if the node is master, false otherwise */
+    bool     is_master_eligible;                    /* true if the node is master eligible, false otherwise */
+    double   weight;                                /* Weight of the node */
+    char     bound_address[CACHE_ADDRESS_STR_SIZE]; /* Address on which the node bound */
+    uint32_t advertisement_hash;                    /* Hash of the advertisement, 0 if unknown */
+    char *   advertisement;                         /* Advertisement serialized, not null terminated, NULL if there is no advertisement */
+    uint32_t advertisement_size;                    /* Size of the advertisement */
+} cache_node_t;
+
+/* Cache instance, file mapped in memory */
+typedef struct cache_s cache_t;
+
+/******************************************************************************/
+/* Prototypes                                                                 */
+/******************************************************************************/
+
+/**
+ * @brief Write the cache file, the previous file is replaced at once so that it is never read partially written
+ * @param path Path of the file
+ * @param nodes Nodes
+ * @param count Number of nodes
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int cache_write(char *path, cache_node_t *nodes, size_t count);
+
+/**
+ * @brief Open the cache file and map it in memory
+ * @param path Path of the file
+ * @return Cache instance if the function succeeded, NULL if the file doesn't exist or is invalid
+ */
+cache_t *cache_open(char *path);
+
+/**
+ * @brief Retrieve the number of nodes of the cache
+ * @param cache Cache instance
+ * @return Number of nodes
+ */
+size_t cache_count(cache_t *cache);
+
+/**
+ * @brief Read a node of the cache, strings of the node point to the file mapped
+ * @param cache Cache instance
+ * @param index Index of the node
+ * @param node Node
+ * @return 0 if the function succeeded, -1 if the node is invalid
+ */
+int cache_read_node(cache_t *cache, size_t index, cache_node_t *node);
+
+/**
+ * @brief Unmap the cache file and release the cache instance
+ * @param cache Cache instance
+ */
+void cache_close(cache_t *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CACHE_H__ */
@@ -88,6 +88,8 @@ then using the DISCOVER_API_VISIBILITY flag to "export" the same symbols the way
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
+#include <regex.h>
 #include <semaphore.h>
 #include <cJSON.h>
 
@@ -95,76 +97,341 @@ then using the DISCOVER_API_VISIBILITY flag to "export" the same symbols the way
 /* Definitions                                                                */
 /******************************************************************************/
 
+/* Size of the UUIDs of the nodes, including the null character */
+#define DISCOVER_NODE_UUID_SIZE (36 + 1)
+
+/* Size of the addresses of the nodes, IPv4 or IPv6, including the null character */
+#define DISCOVER_NODE_ADDRESS_SIZE (45 + 1)
+
+/* Number of nodes records allocated at once */
+#define DISCOVER_NODES_SLAB_SIZE 64
+
+/* Number of hello messages sent at the hello interval when the instance starts or when its state changes */
+#define DISCOVER_HELLO_BURST 3
+
+/* Number of directed messages received remembered to drop the ones retransmitted */
+#define DISCOVER_DIRECTED_HISTORY 64
+
+/* Size of the bloom filter of the channels joined advertised in the hello messages, in bytes, same as the binary encoding */
+#define DISCOVER_CHANNELS_FILTER_SIZE 32
+
+/* Number of bits of the bloom filter of the channels joined set for each channel */
+#define DISCOVER_CHANNELS_FILTER_HASHES 3
+
+/* Maximum number of unicast addresses, the messages are sent to all of them when there are more */
+#define DISCOVER_UNICAST_FILTER_MAX 64
+
+/* Prefix of the events reserved by the library, the applications can't join or send events starting with it */
+#define DISCOVER_RESERVED_PREFIX "discover:"
+
+/* Reserved event of the batches of messages */
+#define DISCOVER_RESERVED_BATCH DISCOVER_RESERVED_PREFIX "batch"
+
+/* Reserved event of the acknowledgements of the directed messages */
+#define DISCOVER_RESERVED_ACK DISCOVER_RESERVED_PREFIX "ack"
+
+/* Reserved event of the requests of the advertisements */
+#define DISCOVER_RESERVED_ADVERTISEMENT_REQUEST DISCOVER_RESERVED_PREFIX "advertisementRequest"
+
 /* Discover nodes */
 typedef struct discover_node_s {
-    struct discover_node_s *prev;      /* Previous node */
-    struct discover_node_s *next;      /* Next node */
-    char *                  pid;       /* Process UUID of the node */
-    char *                  iid;       /* Instance UUID of the node */
-    char *                  hostname;  /* Hostname of the node */
-    char *                  address;   /* Address of the node */
-    uint16_t                port;      /* Port of the node */
-    time_t                  last_seen; /* Last time the node has been seen */
+    struct discover_node_s *prev;                                /* Previous node */
+    struct discover_node_s *next;                                /* Next node */
+    char                    pid[DISCOVER_NODE_UUID_SIZE];        /* Process UUID of the node */
+    char                    iid[DISCOVER_NODE_UUID_SIZE];        /* Instance UUID of the node */
+    char *                  hostname;                            /* Hostname of the node */
+    char                    address[DISCOVER_NODE_ADDRESS_SIZE]; /* Address of the node */
+    uint16_t                port;                                /* Port of the node */
+    time_t                  last_seen;                           /* Last time the node has been seen */
+    uint64_t                last_seen_ms;                        /* Last time the node has been seen, monotonic clock in milliseconds */
     struct {
-        bool   is_master;          /* true if the node is master, false otherwise */
-        bool   is_master_eligible; /* true if the node is master eligible, false otherwise */
-        double weight;             /* Weight of the node */
-        char * address;            /* Address on which the node bound */
-        cJSON *advertisement;      /* Advestisement object */
+        bool     is_master;                               /* true if the node is master, false otherwise */
+        bool     is_master_eligible;                      /* true if the node is master eligible, false otherwise */
+        double   weight;                                  /* Weight of the node */
+        char     address[DISCOVER_NODE_ADDRESS_SIZE];     /* Address on which the node bound */
+        cJSON *  advertisement;                           /* Advestisement object */
+        uint32_t advertisement_hash;                      /* Hash of the advertisement, 0 if unknown */
+        bool     filtered;                                /* true if the node advertises the channels it has joined, false if it may have joined any channel */
+        uint8_t  channels[DISCOVER_CHANNELS_FILTER_SIZE]; /* Bloom filter of the channels joined by the node */
+        bool     stale;                                   /* true if the node has been loaded from the cache and has not been seen since */
     } data;
 } discover_node_t;
 
+/* Discover nodes slab, nodes records allocated at once and reused when the nodes are removed, private to the library */
+typedef struct discover_nodes_slab_s discover_nodes_slab_t;
+
+/* Discover nodes snapshot, immutable copy of the nodes shared by the readers */
+typedef struct {
+    discover_node_t *nodes;   /* Copies of the nodes, linked together using prev and next */
+    size_t           count;   /* Number of nodes */
+    uint64_t         version; /* Version of the nodes when the snapshot has been taken */
+    int              refs;    /* Number of references to the snapshot */
+} discover_nodes_snapshot_t;
+
 /* Axon topic subscription */
 struct discover_s;
 typedef struct discover_channel_s {
     struct discover_channel_s *next;                            /* Next channel */
     char *                     event;                           /* Event of the channel */
+    bool                       literal;                         /* true if the event contains no regular expression special character */
+    regex_t                    regex;                           /* Compiled regular expression of the event, if not literal */
     void *(*fct)(struct discover_s *, char *, cJSON *, void *); /* Callback function invoked when event is received */
     void *user;                                                 /* User data passed to the callback */
 } discover_channel_t;
 
+/* Discover callback events */
+typedef enum {
+    DISCOVER_EVENT_HELLO_RECEIVED, /* Hello message received */
+    DISCOVER_EVENT_ADDED,          /* Node added */
+    DISCOVER_EVENT_MASTER,         /* New master */
+    DISCOVER_EVENT_REMOVED,        /* Node removed */
+    DISCOVER_EVENT_PROMOTION,      /* I promoted myself */
+    DISCOVER_EVENT_DEMOTION,       /* I demoted myself */
+    DISCOVER_EVENT_CHECK,          /* Check executed */
+    DISCOVER_EVENT_STATS           /* Statistics due */
+} discover_event_type_t;
+
+/* Number of buckets of the latency histograms */
+#define DISCOVER_HISTOGRAM_SIZE 24
+
+/* Discover latency histogram, the bucket i counts the latencies from 2^(i-1) to 2^i - 1 microseconds, the last bucket counts all the higher ones */
+typedef struct {
+    uint64_t buckets[DISCOVER_HISTOGRAM_SIZE]; /* Number of samples per bucket */
+    uint64_t count;                            /* Number of samples */
+    uint64_t sum;                              /* Sum of the samples in microseconds */
+} discover_histogram_t;
+
+/* Discover lock statistics, only the waits for a lock already taken are measured */
+typedef struct {
+    uint64_t contended; /* Number of times the lock was already taken */
+    uint64_t wait;      /* Time spent waiting for the lock in microseconds */
+} discover_lock_stats_t;
+
+/* Discover directed message waiting for its acknowledgement */
+typedef struct discover_directed_s {
+    struct discover_directed_s *next;                                /* Next directed message */
+    uint32_t                    sequence;                            /* Sequence number of the message, acknowledged by the destination */
+    char                        pid[DISCOVER_NODE_UUID_SIZE];        /* Process UUID of the destination, checked against the sender of the acknowledgement */
+    char                        iid[DISCOVER_NODE_UUID_SIZE];        /* Instance UUID of the destination, checked against the sender of the acknowledgement */
+    char                        address[DISCOVER_NODE_ADDRESS_SIZE]; /* Address of the destination */
+    uint16_t                    port;                                /* Port of the destination */
+    char *                      buffer;                              /* Message serialized, not encrypted */
+    size_t                      size;                                /* Size of the message */
+    int                         retries;                             /* Number of retransmissions remaining */
+    int                         timeout;                             /* Time to wait for the acknowledgement in milliseconds */
+    uint64_t                    deadline;                            /* Time of the next retransmission, monotonic clock in milliseconds */
+} discover_directed_t;
+
+/* Discover channels joined by the nodes bound to a unicast address */
+typedef struct {
+    int     nodes;                                   /* Number of nodes known at the address */
+    int     unfiltered;                              /* Number of nodes at the address which don't advertise the channels they have joined */
+    int     bits[8 * DISCOVER_CHANNELS_FILTER_SIZE]; /* Number of nodes at the address setting each bit of their bloom filter */
+    uint8_t channels[DISCOVER_CHANNELS_FILTER_SIZE]; /* Union of the bloom filters of the nodes at the address */
+} discover_unicast_filter_t;
+
+/* Discover statistics */
+typedef struct {
+    uint64_t              rx_packets;        /* Number of messages received and handled, the messages dropped are not included */
+    uint64_t              rx_dropped;        /* Number of messages dropped because no buffer was free or the receive queue was full */
+    uint64_t              rx_oversized;      /* Number of messages dropped because they were larger than the maximum datagram size */
+    uint64_t              rx_short;          /* Number of messages dropped because they were empty */
+    uint64_t              rx_invalid;        /* Number of messages dropped because they could not be authenticated, decoded or parsed */
+    uint64_t              tx_packets;        /* Number of messages sent, one per destination */
+    uint64_t              tx_rejected;       /* Number of messages rejected because the send queue was full */
+    uint64_t              tx_errors;         /* Number of messages the system failed to send */
+    uint64_t              tx_batched;        /* Number of messages sent in batches of messages */
+    uint64_t              tx_retransmitted;  /* Number of directed messages retransmitted because they were not acknowledged in time */
+    uint64_t              tx_unacknowledged; /* Number of directed messages never acknowledged */
+    uint64_t              tx_filtered;       /* Number of messages not sent to nodes which have not joined their channel */
+    uint64_t              nodes_added;       /* Number of nodes added */
+    uint64_t              nodes_removed;     /* Number of nodes removed */
+    uint64_t              nodes_count;       /* Number of nodes */
+    uint64_t              events_dispatched; /* Number of callback events dispatched */
+    uint64_t              events_dropped;    /* Number of callback events dropped because the event queue was full */
+    int                   receive_threads;   /* Number of threads handling the messages received */
+    int                   send_threads;      /* Number of threads sending the messages */
+    discover_lock_stats_t nodes_lock;        /* Statistics of the lock protecting the nodes */
+    discover_lock_stats_t options_lock;      /* Statistics of the lock protecting the options */
+    discover_histogram_t  receive_latency;   /* Time from the reception of the messages to the invocation of their callbacks */
+    discover_histogram_t  callback_duration; /* Time spent in the callbacks of the messages and of the events */
+} discover_stats_t;
+
+/* Discover callback event, queued until its callback is invoked */
+typedef struct discover_event_s {
+    struct discover_event_s *next;  /* Next event */
+    discover_event_type_t    type;  /* Type of the event */
+    discover_node_t *        node;  /* Copy of the node, owned by the event, NULL if the event is not related to a node */
+    discover_stats_t *       stats; /* Copy of the statistics, owned by the event, NULL if the event is not a statistics event */
+    uint64_t                 time;  /* Time the message causing the event has been received, monotonic clock in microseconds, 0 if not caused by a message */
+} discover_event_t;
+
 /* Discover instance */
 typedef struct sock_s sock_t;
+typedef struct aead_s aead_t;
 typedef struct discover_s {
     struct {
         int           hello_interval; /* How often to broadcast a hello packet in milliseconds */
         int           check_interval; /* How often to to check for missing nodes in milliseconds */
         int           node_timeout;   /* Consider a node dead if not seen in this many milliseconds */
         int           master_timeout; /* Consider a master node dead if not seen in this many milliseconds */
+        int           hello_jitter;   /* Random variation of the hello interval in percent, so that the nodes don't send their hello messages together */
+        int           hello_nodes;    /* Number of nodes above which the hello interval grows with the number of nodes - 0 to keep it fixed */
         char *        address;        /* Address to bind to */
         uint16_t      port;           /* Port on which to bind and communicate with other node-discover processes */
         char *        broadcast;      /* Broadcast address if using broadcast */
         char *        multicast;      /* Multicast address if using multicast - If net set, broadcast or unicast is used */
         unsigned char multicast_ttl;  /* Multicast TTL for when using multicast */
+        char *        interfaces;     /* Comma separated string of the interfaces on which the multicast group is joined - If not set, the system chooses */
         char *
                unicast; /* Comma separated string of Unicast addresses of known nodes - It is advised to specify the address of the local interface when using unicast and expecting local discovery to work*/
-        char * key;     /* Encryption key if your broadcast packets should be encrypted */
-        int    masters_required; /* The count of master processes that should always be available */
-        double weight;           /* A number used to determine the preference for a specific process to become master - Higher numbers win */
-        bool   client;           /* When true operate in client only mode (don't broadcast existence of node, just listen and discover) */
-        bool   reuse_addr;       /* Allow multiple processes on the same host to bind to the same address and port */
-        bool   ignore_process;  /* If set to false, will not ignore messages from other Discover instances within the same process (on non-reserved channels) */
-        bool   ignore_instance; /* If set to false, will not ignore messages from self (on non-reserved channels) */
-        cJSON *advertisement;   /* The initial advertisement which is sent with each hello packet */
-        char * hostname;        /* Override the OS hostname with a custom value */
-        sem_t  sem;             /* Semaphore used to protect options */
+        char * key;                  /* Encryption key if your broadcast packets should be encrypted, messages not authenticated with this key are dropped */
+        int    masters_required;     /* The count of master processes that should always be available */
+        double weight;               /* A number used to determine the preference for a specific process to become master - Higher numbers win */
+        bool   client;               /* When true operate in client only mode (don't broadcast existence of node, just listen and discover) */
+        bool   reuse_addr;           /* Allow multiple processes on the same host to bind to the same address and port */
+        bool   ignore_process;       /* If set to false, will not ignore messages from other Discover instances within the same process (on non-reserved channels) */
+        bool   ignore_instance;      /* If set to false, will not ignore messages from self (on non-reserved channels) */
+        cJSON *advertisement;        /* The initial advertisement which is sent with each hello packet */
+        char * hostname;             /* Override the OS hostname with a custom value */
+        int    receive_workers;      /* Number of threads handling the messages received */
+        int    receive_queue_depth;  /* Maximum number of messages waiting to be handled, messages received when the queue is full are dropped */
+        int    receive_shards;       /* Number of threads receiving and handling the messages, each one handles the messages of a subset of the senders */
+        int    send_queue_depth;     /* Maximum number of messages waiting to be sent, sending fails when the queue is full */
+        int    max_datagram_size;    /* Maximum size of the messages received, larger ones are dropped */
+        int    batch_size;           /* Maximum size of the batches of messages sent in bytes - 0 to send each message alone */
+        int    batch_delay;          /* Maximum time a message waits in a batch before it is sent in milliseconds */
+        int    ack_timeout;          /* Time to wait for the acknowledgement of a directed message before retransmitting it in milliseconds - 0 to disable it */
+        int    ack_retries;          /* Number of retransmissions of a directed message before it is reported as not acknowledged */
+        bool   binary_hello;         /* Send hello messages using the binary encoding, smaller but only understood by other C instances */
+        bool   channels_filter;      /* Advertise the channels joined in the hello messages so that the senders skip the instance for the other channels */
+        int    advertisement_rounds; /* Number of hello messages carrying the advertisement after it has changed, then only its hash is sent - 0 to always send it */
+        bool   poll_events;          /* Callbacks are invoked by discover_poll_events instead of a dedicated thread */
+        int    event_queue_depth;    /* Maximum number of events waiting for their callbacks, events queued when the queue is full are dropped */
+        bool   threaded;             /* false to create no thread, the application then calls discover_process from its own event loop */
+        int    stats_interval;       /* How often to invoke the stats callback in milliseconds - 0 to disable it */
+        char * cache_file;           /* Path of the file caching the nodes, loaded when starting so that the nodes are known at once - If not set, no cache */
+        sem_t  sem;                  /* Semaphore used to protect options */
     } options;
     sock_t *  sock;               /* Sock instance */
+    aead_t *  aead;               /* Encryption instance, created when starting if a key is set */
     pthread_t thread_check;       /* Check thread handle */
     pthread_t thread_hello;       /* Hello thread handle */
+    pthread_t thread_dispatch;    /* Dispatch thread handle */
+    pthread_t thread_send;        /* Send thread handle */
+    uint64_t  next_hello;         /* Time of the next hello message, monotonic clock in milliseconds */
+    uint64_t  next_check;         /* Time of the next check when no thread is created, monotonic clock in milliseconds */
     char *    pid;                /* Process UUID */
     char *    iid;                /* Instance UUID */
     bool      is_master;          /* true if master, false otherwise */
     bool      is_master_eligible; /* true if master eligible, false otherwise */
     struct {
-        discover_node_t *first; /* First node of the daisy chain */
-        discover_node_t *last;  /* Last node of the daisy chain */
-        sem_t            sem;   /* Semaphore used to protect daisy chain */
+        char *       buffer;             /* Hello message serialized, built again only when the state of the instance changes */
+        size_t       size;               /* Size of the hello message */
+        bool         dirty;              /* true if the options have changed since the hello message has been serialized */
+        bool         is_master;          /* Master flag when the hello message has been serialized */
+        bool         is_master_eligible; /* Master eligible flag when the hello message has been serialized */
+        bool         omitted;            /* true if the advertisement has been omitted when the hello message has been serialized */
+        int          rounds;             /* Number of hello messages sent since the advertisement has changed or has been requested */
+        bool         filtered;                                /* true if the channels joined are advertised, false if a channel is a regular expression */
+        uint8_t      channels[DISCOVER_CHANNELS_FILTER_SIZE]; /* Bloom filter of the channels joined */
+        int          burst;              /* Number of hello messages still sent at the hello interval, whatever the number of nodes */
+        unsigned int seed;               /* Seed of the random variation of the hello interval */
+        sem_t        wakeup;             /* Semaphore used to wake up the hello thread when the next hello message is due sooner or when it is stopped */
+        bool         stop;               /* Flag set to stop the hello thread */
+    } hello;
+    struct {
+        sem_t wakeup; /* Semaphore used to wake up the check thread when it is stopped */
+        bool  stop;   /* Flag set to stop the check thread */
+    } check;
+    struct {
+        discover_node_t *      first;                   /* First node of the daisy chain */
+        discover_node_t *      last;                    /* Last node of the daisy chain */
+        discover_node_t **     buckets;                 /* Index of the nodes by Process and Instance UUIDs */
+        size_t                 size;                    /* Number of buckets of the index, power of 2 */
+        discover_node_t **     heap;                    /* Min-heap of the nodes ordered by deadline, same size than the index */
+        size_t                 count;                   /* Number of nodes */
+        double                 weight;                  /* Weight used to compute the counters below */
+        int                    masters;                 /* Number of master nodes */
+        int                    masters_higher_weight;   /* Number of master nodes with a weight higher than mine */
+        int                    eligibles_higher_weight; /* Number of master eligible nodes, not master, with a weight higher than mine */
+        discover_node_t *      master_first;            /* Index of the master nodes, ordered by decreasing weight */
+        size_t                 master_count;            /* Number of master nodes in the index */
+        discover_node_t *      eligible_first;          /* Index of the master eligible nodes, ordered by decreasing weight */
+        size_t                 eligible_count;          /* Number of master eligible nodes in the index */
+        uint64_t               version;                 /* Incremented each time a node is added, removed or its data change */
+        discover_nodes_slab_t *slabs;                   /* Slabs of nodes records */
+        discover_node_t *      unused;                  /* Nodes records available, linked together using next */
+        sem_t                  sem;                     /* Semaphore used to protect daisy chain, index and counters */
     } nodes;
+    struct {
+        discover_nodes_snapshot_t *current; /* Latest snapshot of the nodes, NULL if not taken yet */
+        sem_t                      sem;     /* Semaphore used to protect the latest snapshot, never held while the nodes are accessed */
+    } snapshot;
+    struct {
+        discover_event_t *first;   /* First event of the queue */
+        discover_event_t *last;    /* Last event of the queue */
+        int               count;   /* Number of events in the queue */
+        int               depth;   /* Maximum number of events in the queue, set when starting */
+        uint64_t          dropped; /* Number of events dropped because the queue was full */
+        bool              running; /* true if the dispatch thread is running */
+        bool              stop;    /* Flag set to stop the dispatch thread */
+        sem_t             sem;     /* Semaphore used to protect the queue */
+        sem_t             pending; /* Semaphore counting the events pending in the queue */
+    } events;
+    struct {
+        char *   header;   /* Beginning of the batches, the envelope of the messages up to the opening bracket of the array of messages */
+        size_t   length;   /* Length of the beginning of the batches */
+        char *   buffer;   /* Messages of the batch pending, separated by commas, allocated when starting if batching is enabled */
+        size_t   size;     /* Size of the messages of the batch pending */
+        size_t   capacity; /* Maximum size of the batches, including the beginning and the end of the batch */
+        int      count;    /* Number of messages of the batch pending */
+        uint64_t deadline; /* Time the batch pending must be sent, monotonic clock in milliseconds */
+        sem_t    sem;      /* Semaphore used to protect the batch */
+    } batch;
+    struct {
+        discover_directed_t *first;    /* First directed message waiting for its acknowledgement */
+        uint32_t             sequence; /* Sequence number of the last directed message sent */
+        struct {
+            uint64_t node;     /* Hash of the Process and Instance UUIDs of the sender */
+            uint32_t sequence; /* Sequence number of the message */
+        } history[DISCOVER_DIRECTED_HISTORY]; /* Directed messages received most recently */
+        size_t next;                          /* Position of the next directed message received in the history */
+        sem_t  sem;                           /* Semaphore used to protect the directed messages */
+    } directed;
+    struct {
+        bool  running; /* true if the send thread is running */
+        bool  stop;    /* Flag set to stop the send thread */
+        sem_t wakeup;  /* Semaphore used to wake up the send thread when a batch is started, when a directed message is sent or when it is stopped */
+    } sender;
+    struct {
+        char *                     buffer;    /* Copy of the unicast addresses, split in place */
+        char **                    addresses; /* Unicast addresses, set when starting, the nodes bound to them are skipped for the channels they have not joined */
+        int                        count;     /* Number of unicast addresses */
+        discover_unicast_filter_t *filters;   /* Channels joined by the nodes at each unicast address, nodes semaphore must be taken */
+    } unicast;
+    struct {
+        uint64_t version; /* Version of the nodes when the cache file has been written */
+    } cache;
     struct {
         discover_channel_t *first; /* Event channel daisy chain */
         sem_t               sem;   /* Semaphore used to protect daisy chain */
     } channels;
+    struct {
+        uint64_t              rx_invalid;        /* Number of messages dropped because they could not be authenticated, decoded or parsed */
+        uint64_t              tx_batched;        /* Number of messages sent in batches of messages */
+        uint64_t              tx_retransmitted;  /* Number of directed messages retransmitted because they were not acknowledged in time */
+        uint64_t              tx_unacknowledged; /* Number of directed messages never acknowledged */
+        uint64_t              tx_filtered;       /* Number of messages not sent to nodes which have not joined their channel */
+        uint64_t              nodes_added;       /* Number of nodes added */
+        uint64_t              nodes_removed;     /* Number of nodes removed */
+        uint64_t              events_dispatched; /* Number of callback events dispatched */
+        discover_lock_stats_t nodes_lock;        /* Statistics of the lock protecting the nodes */
+        discover_lock_stats_t options_lock;      /* Statistics of the lock protecting the options */
+        discover_histogram_t  receive_latency;   /* Time from the reception of the messages to the invocation of their callbacks */
+        discover_histogram_t  callback_duration; /* Time spent in the callbacks of the messages and of the events */
+        uint64_t              next;              /* Time of the next stats callback, monotonic clock in milliseconds */
+    } stats;
     struct {
         struct {
             void *(*fct)(struct discover_s *, discover_node_t *, void *); /* Callback function invoked when hello message is received */
@@ -202,6 +469,10 @@ typedef struct discover_s {
             void *(*fct)(struct discover_s *, char *, void *); /* Callback function invoked when an error occurs */
             void *user;                                        /* User data passed to the callback */
         } error;
+        struct {
+            void *(*fct)(struct discover_s *, discover_stats_t *, void *); /* Callback function invoked periodically with the statistics */
+            void *user;                                                    /* User data passed to the callback */
+        } stats;
     } cb;
 } discover_t;
 
@@ -287,10 +558,118 @@ DISCOVER_PUBLIC(int) discover_leave(discover_t *discover, char *event);
  * @param discover Discover instance
  * @param event Event
  * @param data Data to send
- * @return 0 if the function succeeded, -1 otherwise
+ * @return 0 if the function succeeded, -1 otherwise (the send queue is full when sending faster than the network)
  */
 DISCOVER_PUBLIC(int) discover_send(discover_t *discover, char *event, cJSON *data);
 
+/**
+ * @brief Function used to send event data to a single node, using the address and port learned from its hello messages
+ * @param discover Discover instance
+ * @param node Node to which the message is sent
+ * @param event Event
+ * @param data Data to send
+ * @return 0 if the function succeeded, or if the node has not joined the channel and the acknowledgement is not requested, -1 otherwise
+ */
+DISCOVER_PUBLIC(int) discover_send_to(discover_t *discover, discover_node_t *node, char *event, cJSON *data);
+
+/**
+ * @brief Find a node using its Process and Instance UUIDs
+ * @param discover Discover instance
+ * @param pid Process UUID of the node
+ * @param iid Instance UUID of the node
+ * @return Copy of the node if it is found, NULL otherwise, the copy must be released using discover_node_release
+ */
+DISCOVER_PUBLIC(discover_node_t *) discover_find_node(discover_t *discover, char *pid, char *iid);
+
+/**
+ * @brief Release a node returned by discover_find_node
+ * @param node Node
+ */
+DISCOVER_PUBLIC(void) discover_node_release(discover_node_t *node);
+
+/**
+ * @brief Retrieve a snapshot of the nodes, the same snapshot is shared by the readers as long as the nodes don't change
+ * @param discover Discover instance
+ * @return Snapshot if the function succeeded, NULL otherwise, the snapshot must be released using discover_nodes_release
+ */
+DISCOVER_PUBLIC(discover_nodes_snapshot_t *) discover_nodes_snapshot(discover_t *discover);
+
+/**
+ * @brief Release a snapshot returned by discover_nodes_snapshot
+ * @param snapshot Snapshot
+ */
+DISCOVER_PUBLIC(void) discover_nodes_release(discover_nodes_snapshot_t *snapshot);
+
+/**
+ * @brief Retrieve the number of nodes
+ * @param discover Discover instance
+ * @return Number of nodes
+ */
+DISCOVER_PUBLIC(size_t) discover_nodes_count(discover_t *discover);
+
+/**
+ * @brief Retrieve the master nodes, ordered by decreasing weight
+ * @param discover Discover instance
+ * @return Snapshot of the master nodes if the function succeeded, NULL otherwise, the snapshot must be released using discover_nodes_release
+ */
+DISCOVER_PUBLIC(discover_nodes_snapshot_t *) discover_get_masters(discover_t *discover);
+
+/**
+ * @brief Retrieve the master eligible nodes with the highest weights, ordered by decreasing weight
+ * @param discover Discover instance
+ * @param max Maximum number of nodes, 0 to retrieve all the master eligible nodes
+ * @return Snapshot of the master eligible nodes if the function succeeded, NULL otherwise, the snapshot must be released using discover_nodes_release
+ */
+DISCOVER_PUBLIC(discover_nodes_snapshot_t *) discover_get_eligibles(discover_t *discover, size_t max);
+
+/**
+ * @brief Retrieve the nodes with a field of their advertisement matching a value
+ * @param discover Discover instance
+ * @param field Name of the member of the advertisement object
+ * @param value Value of the member, NULL to retrieve the nodes with the member whatever its value
+ * @return Snapshot of the nodes matching if the function succeeded, NULL otherwise, the snapshot must be released using discover_nodes_release
+ */
+DISCOVER_PUBLIC(discover_nodes_snapshot_t *) discover_filter_nodes(discover_t *discover, char *field, cJSON *value);
+
+/**
+ * @brief Invoke the callbacks of the events pending, when the callbacks are not invoked by a dedicated thread
+ * @param discover Discover instance
+ * @return Number of events handled if the function succeeded, -1 if the pollEvents option is not set
+ */
+DISCOVER_PUBLIC(int) discover_poll_events(discover_t *discover);
+
+/**
+ * @brief Retrieve the sockets the application must watch for input when no thread is created
+ * @param discover Discover instance
+ * @param fds Sockets
+ * @param max Maximum number of sockets
+ * @return Number of sockets if the function succeeded, -1 if the threaded option is set
+ */
+DISCOVER_PUBLIC(int) discover_get_fds(discover_t *discover, int *fds, int max);
+
+/**
+ * @brief Receive the messages pending, send the hello message and check the nodes when they are due, and invoke the callbacks, when no thread is created
+ * @param discover Discover instance
+ * @param now_ms Current time, monotonic clock in milliseconds
+ * @return 0 if the function succeeded, -1 otherwise or if the threaded option is set
+ */
+DISCOVER_PUBLIC(int) discover_process(discover_t *discover, uint64_t now_ms);
+
+/**
+ * @brief Retrieve the time until discover_process must be called again, when no thread is created
+ * @param discover Discover instance
+ * @return Time in milliseconds, 0 if discover_process must be called now, -1 if the threaded option is set
+ */
+DISCOVER_PUBLIC(int) discover_next_timeout(discover_t *discover);
+
+/**
+ * @brief Retrieve discover statistics
+ * @param discover Discover instance
+ * @param stats Statistics
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+DISCOVER_PUBLIC(int) discover_get_stats(discover_t *discover, discover_stats_t *stats);
+
 /**
  * @brief Release discover instance
  * @param discover Discover instance
@@ -0,0 +1,99 @@
+/**
+ * @file      poller.h
+ * @brief     Wait for events on a set of file descriptors
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021-2023 joelguittet and c-discover contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __POLLER_H__
+#define __POLLER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************/
+/* Definitions                                                                */
+/******************************************************************************/
+
+/* Poller instance structure */
+typedef struct {
+    int  fd;        /* epoll instance on Linux, kqueue instance on BSD and macOS, -1 otherwise */
+    int *fds;       /* Table of the file descriptors watched */
+    int  count;     /* Number of file descriptors watched */
+    int  wakeup[2]; /* Wake up file descriptors, read and write sides (eventfd on Linux, pipe otherwise) */
+} poller_t;
+
+/******************************************************************************/
+/* Prototypes                                                                 */
+/******************************************************************************/
+
+/**
+ * @brief Function used to create a poller instance
+ * @return Poller instance if the function succeeded, NULL otherwise
+ */
+poller_t *poller_create(void);
+
+/**
+ * @brief Watch input on a file descriptor
+ * @param poller Poller instance
+ * @param fd File descriptor
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int poller_add(poller_t *poller, int fd);
+
+/**
+ * @brief Wait until input arrives on one or more file descriptors
+ * @param poller Poller instance
+ * @param fds Table filled with the file descriptors with input pending
+ * @param max Size of the table
+ * @param timeout Timeout in milliseconds, -1 to wait forever
+ * @return Number of file descriptors with input pending, 0 on timeout or wake up, -1 otherwise
+ */
+int poller_wait(poller_t *poller, int *fds, int max, int timeout);
+
+/**
+ * @brief Wake up the thread waiting on the poller
+ * @param poller Poller instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int poller_wakeup(poller_t *poller);
+
+/**
+ * @brief Release poller instance, the file descriptors watched are not closed
+ * @param poller Poller instance
+ */
+void poller_release(poller_t *poller);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __POLLER_H__ */
@@ -39,11 +39,98 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 #include <semaphore.h>
+#include <netinet/in.h>
+#include <net/if.h>
+
+#include "poller.h"
 
 /******************************************************************************/
 /* Definitions                                                                */
 /******************************************************************************/
 
+/* Maximum size of a datagram, maximum UDP payload over IPv4 */
+#define SOCK_DATAGRAM_SIZE_MAX (65535 - 8 - 20)
+
+/* Maximum size of the text representation of an address, IPv4 or IPv6, including the null character */
+#define SOCK_ADDRESS_SIZE (45 + 1)
+
+/* Maximum number of datagrams read at once by the listenner */
+#define SOCK_RECEIVE_BATCH_SIZE 16
+
+/* Maximum number of datagrams sent at once by the sender */
+#define SOCK_SEND_BATCH_SIZE 64
+
+/* Maximum number of shards receiving the datagrams */
+#define SOCK_RECEIVE_SHARDS_MAX 64
+
+/* Sock datagram structure */
+typedef struct {
+    char     ip[SOCK_ADDRESS_SIZE]; /* IP address of the sender */
+    uint16_t port;                  /* Port of the sender */
+    void *   buffer;                /* Datagram buffer, maximum datagram size + 1 bytes so that the data is always null terminated */
+    size_t   size;                  /* Datagram size */
+    uint64_t time;                  /* Time the datagram has been read, monotonic clock in microseconds */
+} sock_datagram_t;
+
+/* Datagram queue structure */
+typedef struct {
+    sock_datagram_t * slots;     /* Datagram slots, their buffers are allocated once and reused */
+    void *            buffers;   /* Memory area of the buffers of the slots */
+    sock_datagram_t **free;      /* Stack of the slots available for the listenner */
+    size_t            unused;    /* Number of slots in the stack */
+    sock_datagram_t **items;     /* Circular buffer of slots pending */
+    size_t            depth;     /* Maximum number of slots in the queue */
+    size_t            head;      /* Index of the first slot in the queue */
+    size_t            count;     /* Number of slots in the queue */
+    size_t            size;      /* Size of the buffers of the slots, without the null character */
+    uint64_t          received;  /* Number of datagrams read, including the dropped, oversized and empty ones */
+    uint64_t          dropped;   /* Number of datagrams dropped because the queue was full */
+    uint64_t          oversized; /* Number of datagrams dropped because they were larger than the buffers of the slots */
+    uint64_t          empty;     /* Number of datagrams dropped because they were empty */
+    sem_t             sem;       /* Semaphore used to protect the queue */
+    sem_t             pending;   /* Semaphore counting the slots pending in the queue */
+} sock_queue_t;
+
+/* Send queue cell structure */
+typedef struct {
+    size_t                  sequence; /* Sequence number of the cell */
+    void *                  buffer;   /* Buffer to be sent */
+    size_t                  size;     /* Size of buffer to send */
+    struct sockaddr_storage to;       /* Destination of the buffer, family AF_UNSPEC to send the buffer to all destinations */
+} sock_send_cell_t;
+
+/* Send queue structure, lock-free bounded queue with multiple producers and a single consumer */
+typedef struct {
+    sock_send_cell_t *cells;    /* Circular buffer of cells */
+    size_t            depth;    /* Number of cells, power of 2 */
+    size_t            enqueue;  /* Position of the next cell to be written by the producers */
+    size_t            dequeue;  /* Position of the next cell to be read by the consumer */
+    uint64_t          rejected; /* Number of buffers rejected because the queue was full */
+    uint64_t          sent;     /* Number of datagrams sent, one per destination */
+    uint64_t          errors;   /* Number of datagrams the system failed to send */
+    sem_t             pending;  /* Semaphore counting the buffers pending in the queue */
+} sock_send_queue_t;
+
+/* Sock statistics structure */
+typedef struct {
+    uint64_t rx_packets;      /* Number of datagrams received and handled, the datagrams dropped are not included */
+    uint64_t rx_dropped;      /* Number of datagrams dropped because no buffer was free or the receive queue was full */
+    uint64_t rx_oversized;    /* Number of datagrams dropped because they were larger than the maximum datagram size */
+    uint64_t rx_short;        /* Number of datagrams dropped because they were empty */
+    uint64_t tx_packets;      /* Number of datagrams sent, one per destination */
+    uint64_t tx_rejected;     /* Number of buffers rejected because the send queue was full */
+    uint64_t tx_errors;       /* Number of datagrams the system failed to send */
+    int      receive_threads; /* Number of messengers, or of listenners when the datagrams are sharded */
+    int      send_threads;    /* Number of senders */
+} sock_stats_t;
+
+/* Network interface structure */
+typedef struct {
+    char           name[IF_NAMESIZE]; /* Name of the interface */
+    unsigned int   index;             /* Index of the interface */
+    struct in_addr address;           /* IPv4 address of the interface, used to join the IPv4 multicast groups */
+} sock_interface_t;
+
 /* Sock worker structure */
 struct sock_s;
 typedef struct sock_worker_s {
@@ -53,18 +140,17 @@ typedef struct sock_worker_s {
     pthread_t             thread; /* Thread handle of the worker */
     union {
         struct {
-            int    socket; /* Listenner socket */
-            fd_set fds;    /* Listenner FDs (myself) */
+            int *     sockets; /* Listenner sockets, one per interface when interfaces are given for multicast */
+            int       count;   /* Number of listenner sockets */
+            int       shard;   /* Shard of the listenner, index of its sockets in the groups of sockets sharing the port */
+            poller_t *poller;  /* Poller waiting for the datagrams received on the sockets */
+            bool      stop;    /* Flag set to stop the listenner */
         } listenner;
+        sock_datagram_t *messenger; /* Datagram slot currently handled by the messenger */
         struct {
-            char     ip[15 + 1]; /* Messenger IP address of the sender */
-            uint16_t port;       /* Messenger port of the sender */
-            void *   buffer;     /* Messenger buffer */
-            size_t   size;       /* Messenger buffer size */
-        } messenger;
-        struct {
-            void * buffer; /* Sender buffer */
-            size_t size;   /* Sender buffer size */
+            void *                  buffer; /* Sender buffer */
+            size_t                  size;   /* Sender buffer size */
+            struct sockaddr_storage to;     /* Sender buffer destination, family AF_UNSPEC to send the buffer to all destinations */
         } sender;
     } type;
 } sock_worker_t;
@@ -73,6 +159,7 @@ typedef struct sock_worker_s {
 typedef struct {
     sock_worker_t *first; /* First worker of the daisy chain */
     sock_worker_t *last;  /* Last worker of the daisy chain */
+    bool           stop;  /* Flag set to stop the workers of the daisy chain */
     sem_t          sem;   /* Semaphore used to protect daisy chain */
 } sock_worker_list_t;
 
@@ -84,21 +171,44 @@ typedef struct sock_s {
         char *        broadcast;     /* Broadcast address if using broadcast */
         char *        multicast;     /* Multicast address if using multicast - If net set, broadcast or unicast is used */
         unsigned char multicast_ttl; /* Multicast TTL for when using multicast */
+        char *        interfaces;    /* Comma separated string of the interfaces on which the multicast group is joined - If not set, the system chooses */
         char *
              unicast; /* Comma separated string of Unicast addresses of known nodes - It is advised to specify the address of the local interface when using unicast and expecting local discovery to work*/
-        bool reuse_addr; /* Allow multiple processes on the same host to bind to the same address and port */
+        bool reuse_addr;          /* Allow multiple processes on the same host to bind to the same address and port */
+        int  receive_workers;     /* Number of messengers handling the datagrams received */
+        int  receive_queue_depth; /* Maximum number of datagrams waiting for a messenger */
+        int  receive_shards;      /* Number of listenners sharing the port, each one handles the datagrams of a subset of the senders */
+        int  send_queue_depth;    /* Maximum number of buffers waiting for the sender */
+        int  max_datagram_size;   /* Maximum size of the datagrams received, larger ones are dropped */
+        bool threaded;            /* false to create no thread, the datagrams are then received by sock_process and the buffers sent by sock_send */
     } options;
     sock_worker_list_t listenners; /* List of listenners */
     sock_worker_list_t messengers; /* List of messengers */
+    sock_queue_t       received;   /* Queue of datagrams received, waiting for a messenger */
     sock_worker_list_t senders;    /* List of senders */
+    sock_send_queue_t  sending;    /* Queue of buffers to be sent, waiting for the sender */
+    struct {
+        int                     family; /* Address family of the sockets, AF_INET or AF_INET6 */
+        struct sockaddr_storage addr;   /* Address to which the sockets are bound */
+        socklen_t               length; /* Length of the addresses of the family */
+    } local;
+    struct {
+        struct sockaddr_storage *addrs; /* Addresses to which the buffers are sent, parsed once when binding */
+        int                      count; /* Number of addresses */
+    } destinations;
     struct {
-        fd_set fds; /* All clients sockets */
-        sem_t  sem; /* Semaphore used to protect clients */
+        sock_interface_t *items; /* Interfaces on which the multicast group is joined, parsed once when binding */
+        int               count; /* Number of interfaces */
+    } interfaces;
+    struct {
+        int * sockets; /* All clients sockets */
+        int   count;   /* Number of clients sockets */
+        sem_t sem;     /* Semaphore used to protect clients */
     } clients;
     struct {
         struct {
-            void (*fct)(struct sock_s *, char *, uint16_t, void *, size_t, void *); /* Callback function invoked when message is received */
-            void *user;                                                             /* User data passed to the callback */
+            void (*fct)(struct sock_s *, char *, uint16_t, void *, size_t, uint64_t, void *); /* Callback function invoked when message is received */
+            void *user;                                                                       /* User data passed to the callback */
         } message;
         struct {
             void (*fct)(struct sock_s *, char *, void *); /* Callback function invoked when an error occured*/
@@ -117,6 +227,15 @@ typedef struct sock_s {
  */
 sock_t *sock_create(void);
 
+/**
+ * @brief Set sock options
+ * @param sock Sock instance
+ * @param option Option by name
+ * @param value New value of the option
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int sock_set_option(sock_t *sock, char *option, void *value);
+
 /**
  * @brief Bind a new socket to the wanted port, unicast configuration
  * @param sock Sock instance
@@ -166,10 +285,45 @@ int sock_on(sock_t *sock, char *topic, void *fct, void *user);
  * @param sock Sock instance
  * @param buffer Buffer to be sent
  * @param size Size of buffer to send
- * @return 0 if the function succeeded, -1 otherwise
+ * @return 0 if the function succeeded and the buffer is owned by the sock instance, -1 if the send queue is full or the sender is not started
  */
 int sock_send(sock_t *sock, void *buffer, size_t size);
 
+/**
+ * @brief Function used to send data to a single destination instead of all the destinations
+ * @param sock Sock instance
+ * @param ip Numeric IP address of the destination, as reported to the message callback
+ * @param port Port of the destination
+ * @param buffer Buffer to be sent
+ * @param size Size of buffer to send
+ * @return 0 if the function succeeded and the buffer is owned by the sock instance, -1 if the address is invalid or if the buffer cannot be queued
+ */
+int sock_send_to(sock_t *sock, char *ip, uint16_t port, void *buffer, size_t size);
+
+/**
+ * @brief Retrieve the sockets to watch for input when no thread is created
+ * @param sock Sock instance
+ * @param fds Sockets
+ * @param max Maximum number of sockets
+ * @return Number of sockets
+ */
+int sock_get_fds(sock_t *sock, int *fds, int max);
+
+/**
+ * @brief Receive the datagrams pending and invoke the message callback, when no thread is created
+ * @param sock Sock instance
+ * @return Number of datagrams handled if the function succeeded, -1 otherwise
+ */
+int sock_process(sock_t *sock);
+
+/**
+ * @brief Retrieve sock statistics
+ * @param sock Sock instance
+ * @param stats Statistics
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int sock_get_stats(sock_t *sock, sock_stats_t *stats);
+
 /**
  * @brief Release sock instance
  * @param sock Sock instance
@@ -0,0 +1,113 @@
+/**
+ * @file      wire.h
+ * @brief     Binary encoding of the messages
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021-2023 joelguittet and c-discover contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __WIRE_H__
+#define __WIRE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/******************************************************************************/
+/* Definitions                                                                */
+/******************************************************************************/
+
+/* Magic byte starting binary messages, JSON messages always start with '{' */
+#define WIRE_MAGIC 0xD5
+
+/* Version of the binary encoding */
+#define WIRE_VERSION 1
+
+/* Types of binary messages */
+#define WIRE_TYPE_HELLO 1
+
+/* Size of a UUID as a string, including the null character */
+#define WIRE_UUID_STR_SIZE (36 + 1)
+
+/* Maximum length of the strings of the binary messages */
+#define WIRE_STRING_LENGTH_MAX 255
+
+/* Size of the bloom filter of the channels joined, in bytes */
+#define WIRE_CHANNELS_SIZE 32
+
+/* Hello message structure */
+typedef struct {
+    char     pid[WIRE_UUID_STR_SIZE]; /* Process UUID */
+    char     iid[WIRE_UUID_STR_SIZE]; /* Instance UUID */
+    char *   hostname;                /* Hostname */
+    bool     is_master;               /* true if the node is master, false otherwise */
+    bool     is_master_eligible;      /* true if the node is master eligible, false otherwise */
+    double   weight;                  /* Weight of the node */
+    char *   address;                 /* Address on which the node bound */
+    uint32_t advertisement_hash;      /* Hash of the advertisement, 0 if there is no advertisement */
+    uint8_t *channels;                /* Bloom filter of the channels joined, WIRE_CHANNELS_SIZE bytes, NULL if the channels are not advertised */
+    char *   advertisement;           /* Advertisement serialized, not null terminated, NULL if there is no advertisement or if it is omitted */
+    uint16_t advertisement_size;      /* Size of the advertisement */
+} wire_hello_t;
+
+/******************************************************************************/
+/* Prototypes                                                                 */
+/******************************************************************************/
+
+/**
+ * @brief Check if a buffer contains a binary message
+ * @param buffer Buffer
+ * @param size Size of the buffer
+ * @return true if the buffer starts with the magic byte and a supported version, false otherwise
+ */
+bool wire_is_binary(void *buffer, size_t size);
+
+/**
+ * @brief Encode hello message
+ * @param hello Hello message
+ * @param size Size of the message encoded
+ * @return Message encoded if the function succeeded, NULL otherwise, it must be released by the caller
+ */
+void *wire_encode_hello(wire_hello_t *hello, size_t *size);
+
+/**
+ * @brief Decode hello message, strings of the hello message point to the buffer
+ * @param buffer Buffer
+ * @param size Size of the buffer
+ * @param hello Hello message
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int wire_decode_hello(void *buffer, size_t size, wire_hello_t *hello);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WIRE_H__ */
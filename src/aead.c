@@ -0,0 +1,858 @@
+/**
+ * @file      aead.c
+ * @brief     Authenticated encryption of the messages
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021-2023 joelguittet and c-discover contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <assert.h>
+
+#include "aead.h"
+
+/******************************************************************************/
+/* Definitions                                                                */
+/******************************************************************************/
+
+/* Size of the ChaCha20 and Poly1305 blocks */
+#define AEAD_CHACHA20_BLOCK_SIZE 64
+#define AEAD_POLY1305_BLOCK_SIZE 16
+
+/* Size of the SHA-256 blocks and digest */
+#define AEAD_SHA256_BLOCK_SIZE  64
+#define AEAD_SHA256_DIGEST_SIZE 32
+
+/* Rotate 32 bits word to the left */
+#define AEAD_ROTL32(value, count) (((value) << (count)) | ((value) >> (32 - (count))))
+
+/* Rotate 32 bits word to the right */
+#define AEAD_ROTR32(value, count) (((value) >> (count)) | ((value) << (32 - (count))))
+
+/* ChaCha20 quarter round */
+#define AEAD_CHACHA20_QUARTER_ROUND(a, b, c, d)                                                                                                                \
+    do {                                                                                                                                                       \
+        a += b;                                                                                                                                                \
+        d ^= a;                                                                                                                                                \
+        d = AEAD_ROTL32(d, 16);                                                                                                                                \
+        c += d;                                                                                                                                                \
+        b ^= c;                                                                                                                                                \
+        b = AEAD_ROTL32(b, 12);                                                                                                                                \
+        a += b;                                                                                                                                                \
+        d ^= a;                                                                                                                                                \
+        d = AEAD_ROTL32(d, 8);                                                                                                                                 \
+        c += d;                                                                                                                                                \
+        b ^= c;                                                                                                                                                \
+        b = AEAD_ROTL32(b, 7);                                                                                                                                 \
+    } while (0)
+
+/* Poly1305 state structure, 26 bits limbs */
+typedef struct {
+    uint32_t r[5];   /* Clamped multiplier */
+    uint32_t h[5];   /* Accumulator */
+    uint32_t pad[4]; /* Value added to the accumulator at the end */
+} aead_poly1305_t;
+
+/******************************************************************************/
+/* Variables                                                                  */
+/******************************************************************************/
+
+/* SHA-256 round constants */
+static const uint32_t aead_sha256_k[64]
+    = { 0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
+
+/******************************************************************************/
+/* Prototypes                                                                 */
+/******************************************************************************/
+
+/**
+ * @brief Read 32 bits little endian word
+ * @param buffer Buffer
+ * @return Word
+ */
+static uint32_t aead_load32_le(const uint8_t *buffer);
+
+/**
+ * @brief Write 32 bits little endian word
+ * @param buffer Buffer
+ * @param value Word
+ */
+static void aead_store32_le(uint8_t *buffer, uint32_t value);
+
+/**
+ * @brief Compute SHA-256 digest, used to derive the key from the passphrase
+ * @param data Data
+ * @param size Size of the data
+ * @param digest Digest, AEAD_SHA256_DIGEST_SIZE bytes
+ */
+static void aead_sha256(const uint8_t *data, size_t size, uint8_t *digest);
+
+/**
+ * @brief Process one SHA-256 block
+ * @param state SHA-256 state
+ * @param block Block, AEAD_SHA256_BLOCK_SIZE bytes
+ */
+static void aead_sha256_block(uint32_t *state, const uint8_t *block);
+
+/**
+ * @brief Compute one ChaCha20 key stream block
+ * @param aead AEAD instance
+ * @param counter Block counter
+ * @param nonce Nonce, AEAD_NONCE_SIZE bytes
+ * @param block Key stream block, AEAD_CHACHA20_BLOCK_SIZE bytes
+ */
+static void aead_chacha20_block(aead_t *aead, uint32_t counter, const uint8_t *nonce, uint8_t *block);
+
+/**
+ * @brief Encrypt or decrypt data in place with ChaCha20, the block counter starting at 1
+ * @param aead AEAD instance
+ * @param nonce Nonce, AEAD_NONCE_SIZE bytes
+ * @param data Data
+ * @param size Size of the data
+ */
+static void aead_chacha20_xor(aead_t *aead, const uint8_t *nonce, uint8_t *data, size_t size);
+
+/**
+ * @brief Initialize Poly1305 state
+ * @param poly1305 Poly1305 state
+ * @param key One-time key, 32 bytes
+ */
+static void aead_poly1305_init(aead_poly1305_t *poly1305, const uint8_t *key);
+
+/**
+ * @brief Process data with Poly1305, the last block being padded with zeros
+ * @param poly1305 Poly1305 state
+ * @param data Data
+ * @param size Size of the data
+ */
+static void aead_poly1305_update(aead_poly1305_t *poly1305, const uint8_t *data, size_t size);
+
+/**
+ * @brief Process one Poly1305 block
+ * @param poly1305 Poly1305 state
+ * @param block Block, AEAD_POLY1305_BLOCK_SIZE bytes
+ */
+static void aead_poly1305_block(aead_poly1305_t *poly1305, const uint8_t *block);
+
+/**
+ * @brief Finalize Poly1305 and compute the tag
+ * @param poly1305 Poly1305 state
+ * @param tag Tag, AEAD_TAG_SIZE bytes
+ */
+static void aead_poly1305_finish(aead_poly1305_t *poly1305, uint8_t *tag);
+
+/**
+ * @brief Compute the authentication tag of a message
+ * @param aead AEAD instance
+ * @param nonce Nonce, AEAD_NONCE_SIZE bytes
+ * @param header Header, authenticated but not encrypted
+ * @param ciphertext Encrypted data
+ * @param size Size of the encrypted data
+ * @param tag Tag, AEAD_TAG_SIZE bytes
+ */
+static void aead_compute_tag(aead_t *aead, const uint8_t *nonce, const uint8_t *header, const uint8_t *ciphertext, size_t size, uint8_t *tag);
+
+/**
+ * @brief Check the counter of an authenticated message against the replay window of its sender, and record it
+ * @param aead AEAD instance
+ * @param nonce Nonce, AEAD_NONCE_SIZE bytes
+ * @return 0 if the message has not already been received, -1 otherwise
+ */
+static int aead_check_replay(aead_t *aead, const uint8_t *nonce);
+
+/**
+ * @brief Fill buffer with random bytes, /dev/urandom is used when available
+ * @param buffer Buffer
+ * @param size Size of the buffer
+ */
+static void aead_random(uint8_t *buffer, size_t size);
+
+/******************************************************************************/
+/* Functions                                                                  */
+/******************************************************************************/
+
+/**
+ * @brief Function used to create an AEAD instance
+ * @param passphrase Passphrase from which the key is derived
+ * @return AEAD instance if the function succeeded, NULL otherwise
+ */
+aead_t *
+aead_create(const char *passphrase) {
+
+    assert(NULL != passphrase);
+
+    /* Create AEAD instance */
+    aead_t *aead = (aead_t *)malloc(sizeof(aead_t));
+    if (NULL == aead) {
+        /* Unable to allocate memory */
+        return NULL;
+    }
+    memset(aead, 0, sizeof(aead_t));
+
+    /* Derive the key from the passphrase, the key words are computed once for all the messages */
+    uint8_t digest[AEAD_SHA256_DIGEST_SIZE];
+    aead_sha256((const uint8_t *)passphrase, strlen(passphrase), digest);
+    for (int index = 0; index < 8; index++) {
+        aead->key[index] = aead_load32_le(&digest[4 * index]);
+    }
+    memset(digest, 0, sizeof(digest));
+
+    /* Nonces are built from a random prefix and a counter starting at a random value so that they are unique among the instances sharing the key */
+    uint8_t seed[sizeof(uint64_t)];
+    aead_random(aead->prefix, sizeof(aead->prefix));
+    aead_random(seed, sizeof(seed));
+    memcpy(&aead->counter, seed, sizeof(seed));
+
+    /* Initialize semaphore used to access the replay windows */
+    sem_init(&aead->replay.sem, 0, 1);
+
+    return aead;
+}
+
+/**
+ * @brief Encrypt and authenticate a message
+ * @param aead AEAD instance
+ * @param buffer Message
+ * @param size Size of the message
+ * @param encrypted_size Size of the encrypted message
+ * @return Encrypted message if the function succeeded, NULL otherwise, it must be released by the caller
+ */
+void *
+aead_encrypt(aead_t *aead, void *buffer, size_t size, size_t *encrypted_size) {
+
+    assert(NULL != aead);
+    assert(NULL != buffer);
+    assert(NULL != encrypted_size);
+
+    /* Allocate memory */
+    *encrypted_size = AEAD_OVERHEAD + size;
+    uint8_t *encrypted = (uint8_t *)malloc(*encrypted_size);
+    if (NULL == encrypted) {
+        /* Unable to allocate memory */
+        return NULL;
+    }
+    uint8_t *nonce      = encrypted + AEAD_HEADER_SIZE;
+    uint8_t *ciphertext = nonce + AEAD_NONCE_SIZE;
+
+    /* Header */
+    encrypted[0] = AEAD_MAGIC;
+    encrypted[1] = AEAD_VERSION;
+
+    /* Nonce, the counter is incremented atomically because messages may be sent from several threads */
+    uint64_t counter = __atomic_fetch_add(&aead->counter, 1, __ATOMIC_RELAXED);
+    memcpy(nonce, aead->prefix, sizeof(aead->prefix));
+    for (int index = 0; index < 8; index++) {
+        nonce[sizeof(aead->prefix) + index] = (uint8_t)(counter >> (8 * index));
+    }
+
+    /* Encrypt the message */
+    memcpy(ciphertext, buffer, size);
+    aead_chacha20_xor(aead, nonce, ciphertext, size);
+
+    /* Authenticate the header and the encrypted message */
+    aead_compute_tag(aead, nonce, encrypted, ciphertext, size, ciphertext + size);
+
+    return encrypted;
+}
+
+/**
+ * @brief Authenticate and decrypt a message in place
+ * @param aead AEAD instance
+ * @param buffer Encrypted message
+ * @param size Size of the encrypted message
+ * @param message Decrypted message, pointing to the buffer
+ * @param message_size Size of the decrypted message
+ * @return 0 if the function succeeded, -1 if the message is invalid or can't be authenticated
+ */
+int
+aead_decrypt(aead_t *aead, void *buffer, size_t size, void **message, size_t *message_size) {
+
+    assert(NULL != aead);
+    assert(NULL != buffer);
+    assert(NULL != message);
+    assert(NULL != message_size);
+
+    uint8_t *encrypted = (uint8_t *)buffer;
+
+    /* Check the header */
+    if ((AEAD_OVERHEAD > size) || (AEAD_MAGIC != encrypted[0]) || (AEAD_VERSION != encrypted[1])) {
+        /* Not an encrypted message */
+        return -1;
+    }
+    uint8_t *nonce      = encrypted + AEAD_HEADER_SIZE;
+    uint8_t *ciphertext = nonce + AEAD_NONCE_SIZE;
+    size_t   length     = size - AEAD_OVERHEAD;
+
+    /* Authenticate the message before decrypting it, the comparison is done in constant time */
+    uint8_t tag[AEAD_TAG_SIZE];
+    uint8_t diff = 0;
+    aead_compute_tag(aead, nonce, encrypted, ciphertext, length, tag);
+    for (int index = 0; index < AEAD_TAG_SIZE; index++) {
+        diff |= tag[index] ^ ciphertext[length + index];
+    }
+    if (0 != diff) {
+        /* Invalid tag */
+        return -1;
+    }
+
+    /* Drop the messages already received, the check is done once the message is authenticated so that forged messages don't alter the windows */
+    if (0 != aead_check_replay(aead, nonce)) {
+        /* Replayed message */
+        return -1;
+    }
+
+    /* Decrypt the message */
+    aead_chacha20_xor(aead, nonce, ciphertext, length);
+    *message      = ciphertext;
+    *message_size = length;
+
+    return 0;
+}
+
+/**
+ * @brief Release AEAD instance
+ * @param aead AEAD instance
+ */
+void
+aead_release(aead_t *aead) {
+
+    /* Release AEAD instance */
+    if (NULL != aead) {
+        sem_close(&aead->replay.sem);
+        volatile uint8_t *pos = (volatile uint8_t *)aead;
+        for (size_t index = 0; index < sizeof(aead_t); index++) {
+            pos[index] = 0;
+        }
+        free(aead);
+    }
+}
+
+/**
+ * @brief Read 32 bits little endian word
+ * @param buffer Buffer
+ * @return Word
+ */
+static uint32_t
+aead_load32_le(const uint8_t *buffer) {
+
+    assert(NULL != buffer);
+
+    return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+/**
+ * @brief Write 32 bits little endian word
+ * @param buffer Buffer
+ * @param value Word
+ */
+static void
+aead_store32_le(uint8_t *buffer, uint32_t value) {
+
+    assert(NULL != buffer);
+
+    buffer[0] = (uint8_t)value;
+    buffer[1] = (uint8_t)(value >> 8);
+    buffer[2] = (uint8_t)(value >> 16);
+    buffer[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * @brief Compute SHA-256 digest, used to derive the key from the passphrase
+ * @param data Data
+ * @param size Size of the data
+ * @param digest Digest, AEAD_SHA256_DIGEST_SIZE bytes
+ */
+static void
+aead_sha256(const uint8_t *data, size_t size, uint8_t *digest) {
+
+    assert((NULL != data) || (0 == size));
+    assert(NULL != digest);
+
+    uint32_t state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    uint8_t  block[AEAD_SHA256_BLOCK_SIZE];
+    size_t   offset = 0;
+
+    /* Process the complete blocks */
+    while (AEAD_SHA256_BLOCK_SIZE <= size - offset) {
+        aead_sha256_block(state, data + offset);
+        offset += AEAD_SHA256_BLOCK_SIZE;
+    }
+
+    /* Padding, the size in bits is appended in big endian */
+    size_t remaining = size - offset;
+    memset(block, 0, sizeof(block));
+    if (0 < remaining) {
+        memcpy(block, data + offset, remaining);
+    }
+    block[remaining] = 0x80;
+    if (AEAD_SHA256_BLOCK_SIZE - sizeof(uint64_t) <= remaining) {
+        aead_sha256_block(state, block);
+        memset(block, 0, sizeof(block));
+    }
+    uint64_t bits = (uint64_t)size * 8;
+    for (int index = 0; index < 8; index++) {
+        block[AEAD_SHA256_BLOCK_SIZE - 1 - index] = (uint8_t)(bits >> (8 * index));
+    }
+    aead_sha256_block(state, block);
+
+    /* Digest, big endian */
+    for (int index = 0; index < 8; index++) {
+        digest[4 * index]     = (uint8_t)(state[index] >> 24);
+        digest[4 * index + 1] = (uint8_t)(state[index] >> 16);
+        digest[4 * index + 2] = (uint8_t)(state[index] >> 8);
+        digest[4 * index + 3] = (uint8_t)state[index];
+    }
+}
+
+/**
+ * @brief Process one SHA-256 block
+ * @param state SHA-256 state
+ * @param block Block, AEAD_SHA256_BLOCK_SIZE bytes
+ */
+static void
+aead_sha256_block(uint32_t *state, const uint8_t *block) {
+
+    assert(NULL != state);
+    assert(NULL != block);
+
+    uint32_t w[64];
+
+    /* Message schedule */
+    for (int index = 0; index < 16; index++) {
+        w[index] = ((uint32_t)block[4 * index] << 24) | ((uint32_t)block[4 * index + 1] << 16) | ((uint32_t)block[4 * index + 2] << 8)
+                   | (uint32_t)block[4 * index + 3];
+    }
+    for (int index = 16; index < 64; index++) {
+        uint32_t s0 = AEAD_ROTR32(w[index - 15], 7) ^ AEAD_ROTR32(w[index - 15], 18) ^ (w[index - 15] >> 3);
+        uint32_t s1 = AEAD_ROTR32(w[index - 2], 17) ^ AEAD_ROTR32(w[index - 2], 19) ^ (w[index - 2] >> 10);
+        w[index]    = w[index - 16] + s0 + w[index - 7] + s1;
+    }
+
+    /* Compression */
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int index = 0; index < 64; index++) {
+        uint32_t t1 = h + (AEAD_ROTR32(e, 6) ^ AEAD_ROTR32(e, 11) ^ AEAD_ROTR32(e, 25)) + ((e & f) ^ (~e & g)) + aead_sha256_k[index] + w[index];
+        uint32_t t2 = (AEAD_ROTR32(a, 2) ^ AEAD_ROTR32(a, 13) ^ AEAD_ROTR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h           = g;
+        g           = f;
+        f           = e;
+        e           = d + t1;
+        d           = c;
+        c           = b;
+        b           = a;
+        a           = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+/**
+ * @brief Compute one ChaCha20 key stream block
+ * @param aead AEAD instance
+ * @param counter Block counter
+ * @param nonce Nonce, AEAD_NONCE_SIZE bytes
+ * @param block Key stream block, AEAD_CHACHA20_BLOCK_SIZE bytes
+ */
+static void
+aead_chacha20_block(aead_t *aead, uint32_t counter, const uint8_t *nonce, uint8_t *block) {
+
+    assert(NULL != aead);
+    assert(NULL != nonce);
+    assert(NULL != block);
+
+    uint32_t state[16];
+    uint32_t x[16];
+
+    /* Initial state: constants, key, counter and nonce */
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    memcpy(&state[4], aead->key, sizeof(aead->key));
+    state[12] = counter;
+    state[13] = aead_load32_le(nonce);
+    state[14] = aead_load32_le(nonce + 4);
+    state[15] = aead_load32_le(nonce + 8);
+    memcpy(x, state, sizeof(state));
+
+    /* 20 rounds, alternating column and diagonal rounds */
+    for (int index = 0; index < 10; index++) {
+        AEAD_CHACHA20_QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+        AEAD_CHACHA20_QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+        AEAD_CHACHA20_QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        AEAD_CHACHA20_QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        AEAD_CHACHA20_QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        AEAD_CHACHA20_QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        AEAD_CHACHA20_QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+        AEAD_CHACHA20_QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+    }
+
+    /* Add the initial state and serialize the key stream */
+    for (int index = 0; index < 16; index++) {
+        aead_store32_le(&block[4 * index], x[index] + state[index]);
+    }
+}
+
+/**
+ * @brief Encrypt or decrypt data in place with ChaCha20, the block counter starting at 1
+ * @param aead AEAD instance
+ * @param nonce Nonce, AEAD_NONCE_SIZE bytes
+ * @param data Data
+ * @param size Size of the data
+ */
+static void
+aead_chacha20_xor(aead_t *aead, const uint8_t *nonce, uint8_t *data, size_t size) {
+
+    assert(NULL != aead);
+    assert(NULL != nonce);
+    assert((NULL != data) || (0 == size));
+
+    uint8_t  block[AEAD_CHACHA20_BLOCK_SIZE];
+    uint32_t counter = 1;
+
+    /* Apply the key stream block per block */
+    for (size_t offset = 0; offset < size; offset += AEAD_CHACHA20_BLOCK_SIZE) {
+        size_t length = (AEAD_CHACHA20_BLOCK_SIZE < size - offset) ? AEAD_CHACHA20_BLOCK_SIZE : size - offset;
+        aead_chacha20_block(aead, counter++, nonce, block);
+        for (size_t index = 0; index < length; index++) {
+            data[offset + index] ^= block[index];
+        }
+    }
+}
+
+/**
+ * @brief Initialize Poly1305 state
+ * @param poly1305 Poly1305 state
+ * @param key One-time key, 32 bytes
+ */
+static void
+aead_poly1305_init(aead_poly1305_t *poly1305, const uint8_t *key) {
+
+    assert(NULL != poly1305);
+    assert(NULL != key);
+
+    /* Clamp r and split it in 26 bits limbs */
+    poly1305->r[0] = aead_load32_le(&key[0]) & 0x3ffffff;
+    poly1305->r[1] = (aead_load32_le(&key[3]) >> 2) & 0x3ffff03;
+    poly1305->r[2] = (aead_load32_le(&key[6]) >> 4) & 0x3ffc0ff;
+    poly1305->r[3] = (aead_load32_le(&key[9]) >> 6) & 0x3f03fff;
+    poly1305->r[4] = (aead_load32_le(&key[12]) >> 8) & 0x00fffff;
+
+    /* Reset the accumulator */
+    memset(poly1305->h, 0, sizeof(poly1305->h));
+
+    /* Keep s for the end */
+    for (int index = 0; index < 4; index++) {
+        poly1305->pad[index] = aead_load32_le(&key[16 + 4 * index]);
+    }
+}
+
+/**
+ * @brief Process data with Poly1305, the last block being padded with zeros
+ * @param poly1305 Poly1305 state
+ * @param data Data
+ * @param size Size of the data
+ */
+static void
+aead_poly1305_update(aead_poly1305_t *poly1305, const uint8_t *data, size_t size) {
+
+    assert(NULL != poly1305);
+    assert((NULL != data) || (0 == size));
+
+    uint8_t block[AEAD_POLY1305_BLOCK_SIZE];
+
+    /* Process the data block per block, as required by the AEAD construction the last block is padded with zeros and processed as a full block */
+    for (size_t offset = 0; offset < size; offset += AEAD_POLY1305_BLOCK_SIZE) {
+        if (AEAD_POLY1305_BLOCK_SIZE <= size - offset) {
+            aead_poly1305_block(poly1305, data + offset);
+        } else {
+            memset(block, 0, sizeof(block));
+            memcpy(block, data + offset, size - offset);
+            aead_poly1305_block(poly1305, block);
+        }
+    }
+}
+
+/**
+ * @brief Process one Poly1305 block
+ * @param poly1305 Poly1305 state
+ * @param block Block, AEAD_POLY1305_BLOCK_SIZE bytes
+ */
+static void
+aead_poly1305_block(aead_poly1305_t *poly1305, const uint8_t *block) {
+
+    assert(NULL != poly1305);
+    assert(NULL != block);
+
+    uint32_t *r = poly1305->r;
+    uint32_t *h = poly1305->h;
+    uint32_t  s1 = r[1] * 5, s2 = r[2] * 5, s3 = r[3] * 5, s4 = r[4] * 5;
+    uint64_t  d0, d1, d2, d3, d4;
+    uint32_t  c;
+
+    /* Add the block to the accumulator, the block being complete the bit 128 is set */
+    h[0] += aead_load32_le(&block[0]) & 0x3ffffff;
+    h[1] += (aead_load32_le(&block[3]) >> 2) & 0x3ffffff;
+    h[2] += (aead_load32_le(&block[6]) >> 4) & 0x3ffffff;
+    h[3] += (aead_load32_le(&block[9]) >> 6) & 0x3ffffff;
+    h[4] += (aead_load32_le(&block[12]) >> 8) | (1 << 24);
+
+    /* Multiply the accumulator by r modulo 2^130 - 5 */
+    d0 = (uint64_t)h[0] * r[0] + (uint64_t)h[1] * s4 + (uint64_t)h[2] * s3 + (uint64_t)h[3] * s2 + (uint64_t)h[4] * s1;
+    d1 = (uint64_t)h[0] * r[1] + (uint64_t)h[1] * r[0] + (uint64_t)h[2] * s4 + (uint64_t)h[3] * s3 + (uint64_t)h[4] * s2;
+    d2 = (uint64_t)h[0] * r[2] + (uint64_t)h[1] * r[1] + (uint64_t)h[2] * r[0] + (uint64_t)h[3] * s4 + (uint64_t)h[4] * s3;
+    d3 = (uint64_t)h[0] * r[3] + (uint64_t)h[1] * r[2] + (uint64_t)h[2] * r[1] + (uint64_t)h[3] * r[0] + (uint64_t)h[4] * s4;
+    d4 = (uint64_t)h[0] * r[4] + (uint64_t)h[1] * r[3] + (uint64_t)h[2] * r[2] + (uint64_t)h[3] * r[1] + (uint64_t)h[4] * r[0];
+
+    /* Partial carry propagation */
+    c    = (uint32_t)(d0 >> 26);
+    h[0] = (uint32_t)d0 & 0x3ffffff;
+    d1 += c;
+    c    = (uint32_t)(d1 >> 26);
+    h[1] = (uint32_t)d1 & 0x3ffffff;
+    d2 += c;
+    c    = (uint32_t)(d2 >> 26);
+    h[2] = (uint32_t)d2 & 0x3ffffff;
+    d3 += c;
+    c    = (uint32_t)(d3 >> 26);
+    h[3] = (uint32_t)d3 & 0x3ffffff;
+    d4 += c;
+    c    = (uint32_t)(d4 >> 26);
+    h[4] = (uint32_t)d4 & 0x3ffffff;
+    h[0] += c * 5;
+    c = h[0] >> 26;
+    h[0] &= 0x3ffffff;
+    h[1] += c;
+}
+
+/**
+ * @brief Finalize Poly1305 and compute the tag
+ * @param poly1305 Poly1305 state
+ * @param tag Tag, AEAD_TAG_SIZE bytes
+ */
+static void
+aead_poly1305_finish(aead_poly1305_t *poly1305, uint8_t *tag) {
+
+    assert(NULL != poly1305);
+    assert(NULL != tag);
+
+    uint32_t *h = poly1305->h;
+    uint32_t  g[5];
+    uint32_t  c, mask;
+    uint64_t  f;
+
+    /* Full carry propagation */
+    for (int index = 1; index < 5; index++) {
+        c = h[index] >> 26;
+        h[index] &= 0x3ffffff;
+        h[(index + 1) % 5] += (4 == index) ? c * 5 : c;
+    }
+    c = h[0] >> 26;
+    h[0] &= 0x3ffffff;
+    h[1] += c;
+
+    /* Compute h - p and select it in constant time if h is greater or equal to p */
+    g[0] = h[0] + 5;
+    c    = g[0] >> 26;
+    g[0] &= 0x3ffffff;
+    for (int index = 1; index < 4; index++) {
+        g[index] = h[index] + c;
+        c        = g[index] >> 26;
+        g[index] &= 0x3ffffff;
+    }
+    g[4] = h[4] + c - (1 << 26);
+    mask = (g[4] >> 31) - 1;
+    for (int index = 0; index < 5; index++) {
+        h[index] = (h[index] & ~mask) | (g[index] & mask);
+    }
+
+    /* Convert to 32 bits words and add s */
+    uint32_t words[4];
+    words[0] = h[0] | (h[1] << 26);
+    words[1] = (h[1] >> 6) | (h[2] << 20);
+    words[2] = (h[2] >> 12) | (h[3] << 14);
+    words[3] = (h[3] >> 18) | (h[4] << 8);
+    f        = 0;
+    for (int index = 0; index < 4; index++) {
+        f = (uint64_t)words[index] + poly1305->pad[index] + (f >> 32);
+        aead_store32_le(&tag[4 * index], (uint32_t)f);
+    }
+}
+
+/**
+ * @brief Compute the authentication tag of a message
+ * @param aead AEAD instance
+ * @param nonce Nonce, AEAD_NONCE_SIZE bytes
+ * @param header Header, authenticated but not encrypted
+ * @param ciphertext Encrypted data
+ * @param size Size of the encrypted data
+ * @param tag Tag, AEAD_TAG_SIZE bytes
+ */
+static void
+aead_compute_tag(aead_t *aead, const uint8_t *nonce, const uint8_t *header, const uint8_t *ciphertext, size_t size, uint8_t *tag) {
+
+    assert(NULL != aead);
+    assert(NULL != nonce);
+    assert(NULL != header);
+    assert((NULL != ciphertext) || (0 == size));
+    assert(NULL != tag);
+
+    aead_poly1305_t poly1305;
+    uint8_t         block[AEAD_CHACHA20_BLOCK_SIZE];
+    uint8_t         lengths[AEAD_POLY1305_BLOCK_SIZE];
+
+    /* One-time Poly1305 key, first half of the key stream block 0 */
+    aead_chacha20_block(aead, 0, nonce, block);
+    aead_poly1305_init(&poly1305, block);
+
+    /* Header as additional data, then encrypted data and lengths */
+    aead_poly1305_update(&poly1305, header, AEAD_HEADER_SIZE);
+    aead_poly1305_update(&poly1305, ciphertext, size);
+    memset(lengths, 0, sizeof(lengths));
+    lengths[0] = AEAD_HEADER_SIZE;
+    for (int index = 0; index < 8; index++) {
+        lengths[8 + index] = (uint8_t)((uint64_t)size >> (8 * index));
+    }
+    aead_poly1305_update(&poly1305, lengths, sizeof(lengths));
+    aead_poly1305_finish(&poly1305, tag);
+}
+
+/**
+ * @brief Check the counter of an authenticated message against the replay window of its sender, and record it
+ * @param aead AEAD instance
+ * @param nonce Nonce, AEAD_NONCE_SIZE bytes
+ * @return 0 if the message has not already been received, -1 otherwise
+ */
+static int
+aead_check_replay(aead_t *aead, const uint8_t *nonce) {
+
+    assert(NULL != aead);
+    assert(NULL != nonce);
+
+    int ret = -1;
+
+    /* Retrieve the counter of the nonce */
+    uint64_t counter = 0;
+    for (int index = 0; index < 8; index++) {
+        counter |= (uint64_t)nonce[sizeof(aead->prefix) + index] << (8 * index);
+    }
+
+    sem_wait(&aead->replay.sem);
+
+    /* Search the sender using the prefix of the nonce, and the least recently seen one which is replaced if the sender is not tracked */
+    aead_replay_t *sender = NULL;
+    aead_replay_t *oldest = NULL;
+    for (int index = 0; index < aead->replay.count; index++) {
+        if (0 == memcmp(aead->replay.senders[index].prefix, nonce, sizeof(aead->prefix))) {
+            sender = &aead->replay.senders[index];
+            break;
+        }
+        if ((NULL == oldest) || (aead->replay.senders[index].seen < oldest->seen)) {
+            oldest = &aead->replay.senders[index];
+        }
+    }
+
+    /* Check the counter */
+    if (NULL == sender) {
+        /* New sender, its window starts at the counter of the message */
+        sender = (AEAD_REPLAY_SENDERS > aead->replay.count) ? &aead->replay.senders[aead->replay.count++] : oldest;
+        memcpy(sender->prefix, nonce, sizeof(aead->prefix));
+        sender->highest = counter;
+        sender->window  = 1;
+        ret             = 0;
+    } else {
+        /* The counters are compared using their difference so that the counter may wrap */
+        uint64_t ahead = counter - sender->highest;
+        if ((0 != ahead) && (((uint64_t)1 << 63) > ahead)) {
+            /* Counter higher than the highest one received, the window is shifted */
+            sender->window  = (AEAD_REPLAY_WINDOW > ahead) ? ((sender->window << ahead) | 1) : 1;
+            sender->highest = counter;
+            ret             = 0;
+        } else {
+            /* Counter lower than or equal to the highest one received, it is accepted only if it is in the window and not already received */
+            uint64_t behind = sender->highest - counter;
+            if ((AEAD_REPLAY_WINDOW > behind) && (0 == (sender->window & ((uint64_t)1 << behind)))) {
+                sender->window |= (uint64_t)1 << behind;
+                ret = 0;
+            }
+        }
+    }
+    if (0 == ret) {
+        sender->seen = ++aead->replay.sequence;
+    }
+
+    sem_post(&aead->replay.sem);
+
+    return ret;
+}
+
+/**
+ * @brief Fill buffer with random bytes, /dev/urandom is used when available
+ * @param buffer Buffer
+ * @param size Size of the buffer
+ */
+static void
+aead_random(uint8_t *buffer, size_t size) {
+
+    assert(NULL != buffer);
+
+    /* Read /dev/urandom */
+    FILE *file = fopen("/dev/urandom", "rb");
+    if (NULL != file) {
+        size_t count = fread(buffer, 1, size, file);
+        fclose(file);
+        if (count == size) {
+            return;
+        }
+    }
+
+    /* Fallback to a weaker seed built from the time, the process ID and the buffer address */
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t seed = ((uint64_t)ts.tv_sec << 32) ^ (uint64_t)ts.tv_nsec ^ ((uint64_t)getpid() << 16) ^ (uint64_t)(uintptr_t)buffer;
+    for (size_t index = 0; index < size; index++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        buffer[index] = (uint8_t)(seed >> 32);
+    }
+}
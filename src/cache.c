@@ -0,0 +1,356 @@
+/**
+ * @file      cache.c
+ * @brief     Persistent cache of the nodes
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021-2023 joelguittet and c-discover contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+
+/******************************************************************************/
+/* Definitions                                                                */
+/******************************************************************************/
+
+/* Header of the cache files, followed by the records of the nodes and by their strings, in the native byte order of the host */
+typedef struct {
+    uint32_t magic;   /* Magic number */
+    uint32_t version; /* Version of the file */
+    uint32_t count;   /* Number of records */
+    uint32_t size;    /* Size of the file */
+} cache_header_t;
+
+/* Record of a node, fixed size so that the records are used in place once the file is mapped */
+typedef struct {
+    char     pid[CACHE_UUID_STR_SIZE];              /* Process UUID */
+    char     iid[CACHE_UUID_STR_SIZE];              /* Instance UUID */
+    char     address[CACHE_ADDRESS_STR_SIZE];       /* Address of the node */
+    char     bound_address[CACHE_ADDRESS_STR_SIZE]; /* Address on which the node bound */
+    uint16_t port;                                  /* Port of the node */
+    uint8_t  is_master;                             /* 1 if the node is master, 0 otherwise */
+    uint8_t  is_master_eligible;                    /* 1 if the node is master eligible, 0 otherwise */
+    uint32_t advertisement_hash;                    /* Hash of the advertisement, 0 if unknown */
+    double   weight;                                /* Weight of the node */
+    int64_t  last_seen;                             /* Last time the node has been seen */
+    uint32_t hostname_offset;                       /* Offset of the hostname in the file, null terminated, 0 if there is no hostname */
+    uint32_t advertisement_offset;                  /* Offset of the advertisement in the file, 0 if there is no advertisement */
+    uint32_t advertisement_size;                    /* Size of the advertisement */
+} cache_record_t;
+
+/* Cache instance */
+struct cache_s {
+    void * map;  /* File mapped in memory */
+    size_t size; /* Size of the file */
+};
+
+/******************************************************************************/
+/* Prototypes                                                                 */
+/******************************************************************************/
+
+/**
+ * @brief Write a buffer to a file, retrying until it is completely written
+ * @param fd File descriptor
+ * @param buffer Buffer
+ * @param size Size of the buffer
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int cache_write_buffer(int fd, void *buffer, size_t size);
+
+/******************************************************************************/
+/* Functions                                                                  */
+/******************************************************************************/
+
+/**
+ * @brief Write the cache file, the previous file is replaced at once so that it is never read partially written
+ * @param path Path of the file
+ * @param nodes Nodes
+ * @param count Number of nodes
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+cache_write(char *path, cache_node_t *nodes, size_t count) {
+
+    assert(NULL != path);
+    assert((NULL != nodes) || (0 == count));
+
+    /* Compute the size of the file, the strings follow the records */
+    size_t size = sizeof(cache_header_t) + count * sizeof(cache_record_t);
+    for (size_t index = 0; index < count; index++) {
+        size += (NULL != nodes[index].hostname) ? strlen(nodes[index].hostname) + 1 : 0;
+        size += (NULL != nodes[index].advertisement) ? nodes[index].advertisement_size : 0;
+    }
+    if (UINT32_MAX < size) {
+        /* File is too large */
+        return -1;
+    }
+
+    /* Allocate memory, the padding of the records is zeroed */
+    uint8_t *buffer = (uint8_t *)malloc(size);
+    if (NULL == buffer) {
+        /* Unable to allocate memory */
+        return -1;
+    }
+    memset(buffer, 0, size);
+
+    /* Header */
+    cache_header_t *header = (cache_header_t *)buffer;
+    header->magic          = CACHE_MAGIC;
+    header->version        = CACHE_VERSION;
+    header->count          = (uint32_t)count;
+    header->size           = (uint32_t)size;
+
+    /* Records and strings */
+    cache_record_t *records = (cache_record_t *)(buffer + sizeof(cache_header_t));
+    size_t          offset  = sizeof(cache_header_t) + count * sizeof(cache_record_t);
+    for (size_t index = 0; index < count; index++) {
+        cache_node_t *  node   = &nodes[index];
+        cache_record_t *record = &records[index];
+        strcpy(record->pid, node->pid);
+        strcpy(record->iid, node->iid);
+        strcpy(record->address, node->address);
+        strcpy(record->bound_address, node->bound_address);
+        record->port               = node->port;
+        record->is_master          = (true == node->is_master) ? 1 : 0;
+        record->is_master_eligible = (true == node->is_master_eligible) ? 1 : 0;
+        record->advertisement_hash = node->advertisement_hash;
+        record->weight             = node->weight;
+        record->last_seen          = (int64_t)node->last_seen;
+        if (NULL != node->hostname) {
+            record->hostname_offset = (uint32_t)offset;
+            strcpy((char *)buffer + offset, node->hostname);
+            offset += strlen(node->hostname) + 1;
+        }
+        if (NULL != node->advertisement) {
+            record->advertisement_offset = (uint32_t)offset;
+            record->advertisement_size   = node->advertisement_size;
+            memcpy(buffer + offset, node->advertisement, node->advertisement_size);
+            offset += node->advertisement_size;
+        }
+    }
+
+    /* Write a temporary file, then replace the previous file */
+    char *tmp = (char *)malloc(strlen(path) + sizeof(".tmp"));
+    if (NULL == tmp) {
+        /* Unable to allocate memory */
+        free(buffer);
+        return -1;
+    }
+    sprintf(tmp, "%s.tmp", path);
+    int ret = -1;
+    int fd  = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (0 <= fd) {
+        ret = cache_write_buffer(fd, buffer, size);
+        if ((0 != close(fd)) || (0 != ret) || (0 != rename(tmp, path))) {
+            /* Unable to write the file */
+            unlink(tmp);
+            ret = -1;
+        }
+    }
+
+    /* Release memory */
+    free(tmp);
+    free(buffer);
+
+    return ret;
+}
+
+/**
+ * @brief Open the cache file and map it in memory
+ * @param path Path of the file
+ * @return Cache instance if the function succeeded, NULL if the file doesn't exist or is invalid
+ */
+cache_t *
+cache_open(char *path) {
+
+    assert(NULL != path);
+
+    struct stat st;
+
+    /* Open the file */
+    int fd = open(path, O_RDONLY);
+    if (0 > fd) {
+        /* Unable to open the file */
+        return NULL;
+    }
+    if ((0 != fstat(fd, &st)) || ((off_t)sizeof(cache_header_t) > st.st_size) || ((off_t)UINT32_MAX < st.st_size)) {
+        /* Invalid file */
+        close(fd);
+        return NULL;
+    }
+
+    /* Map the file, the mapping remains valid once the file is closed */
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == map) {
+        /* Unable to map the file */
+        return NULL;
+    }
+
+    /* Check the header, the records must be in the file */
+    cache_header_t *header = (cache_header_t *)map;
+    if ((CACHE_MAGIC != header->magic) || (CACHE_VERSION != header->version) || ((size_t)st.st_size != header->size)
+        || ((header->size - sizeof(cache_header_t)) / sizeof(cache_record_t) < header->count)) {
+        /* Invalid file */
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+
+    /* Create cache instance */
+    cache_t *cache = (cache_t *)malloc(sizeof(cache_t));
+    if (NULL == cache) {
+        /* Unable to allocate memory */
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    cache->map  = map;
+    cache->size = (size_t)st.st_size;
+
+    return cache;
+}
+
+/**
+ * @brief Retrieve the number of nodes of the cache
+ * @param cache Cache instance
+ * @return Number of nodes
+ */
+size_t
+cache_count(cache_t *cache) {
+
+    assert(NULL != cache);
+
+    return ((cache_header_t *)cache->map)->count;
+}
+
+/**
+ * @brief Read a node of the cache, strings of the node point to the file mapped
+ * @param cache Cache instance
+ * @param index Index of the node
+ * @param node Node
+ * @return 0 if the function succeeded, -1 if the node is invalid
+ */
+int
+cache_read_node(cache_t *cache, size_t index, cache_node_t *node) {
+
+    assert(NULL != cache);
+    assert(NULL != node);
+
+    /* Check the index */
+    if (cache_count(cache) <= index) {
+        /* Invalid index */
+        return -1;
+    }
+    uint8_t *       map    = (uint8_t *)cache->map;
+    cache_record_t *record = &((cache_record_t *)(map + sizeof(cache_header_t)))[index];
+
+    /* Check the strings of the record are null terminated */
+    if ((NULL == memchr(record->pid, '\0', sizeof(record->pid))) || (NULL == memchr(record->iid, '\0', sizeof(record->iid)))
+        || (NULL == memchr(record->address, '\0', sizeof(record->address))) || (NULL == memchr(record->bound_address, '\0', sizeof(record->bound_address)))) {
+        /* Invalid record */
+        return -1;
+    }
+
+    /* Check the hostname and the advertisement are in the file */
+    if ((0 != record->hostname_offset)
+        && ((cache->size <= record->hostname_offset) || (NULL == memchr(map + record->hostname_offset, '\0', cache->size - record->hostname_offset)))) {
+        /* Invalid hostname */
+        return -1;
+    }
+    if ((0 != record->advertisement_offset)
+        && ((cache->size <= record->advertisement_offset) || (cache->size - record->advertisement_offset < record->advertisement_size))) {
+        /* Invalid advertisement */
+        return -1;
+    }
+
+    /* Read the node */
+    memset(node, 0, sizeof(cache_node_t));
+    strcpy(node->pid, record->pid);
+    strcpy(node->iid, record->iid);
+    strcpy(node->address, record->address);
+    strcpy(node->bound_address, record->bound_address);
+    node->hostname           = (0 != record->hostname_offset) ? (char *)map + record->hostname_offset : NULL;
+    node->port               = record->port;
+    node->last_seen          = (time_t)record->last_seen;
+    node->is_master          = (0 != record->is_master) ? true : false;
+    node->is_master_eligible = (0 != record->is_master_eligible) ? true : false;
+    node->weight             = record->weight;
+    node->advertisement_hash = record->advertisement_hash;
+    if (0 != record->advertisement_offset) {
+        node->advertisement      = (char *)map + record->advertisement_offset;
+        node->advertisement_size = record->advertisement_size;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Unmap the cache file and release the cache instance
+ * @param cache Cache instance
+ */
+void
+cache_close(cache_t *cache) {
+
+    /* Release cache instance */
+    if (NULL != cache) {
+        munmap(cache->map, cache->size);
+        free(cache);
+    }
+}
+
+/**
+ * @brief Write a buffer to a file, retrying until it is completely written
+ * @param fd File descriptor
+ * @param buffer Buffer
+ * @param size Size of the buffer
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+cache_write_buffer(int fd, void *buffer, size_t size) {
+
+    uint8_t *pos = (uint8_t *)buffer;
+
+    /* Write until the buffer is completely written */
+    while (0 < size) {
+        ssize_t written = write(fd, pos, size);
+        if (0 > written) {
+            /* Unable to write the file */
+            return -1;
+        }
+        pos += written;
+        size -= (size_t)written;
+    }
+
+    return 0;
+}
@@ -29,20 +29,55 @@
 /* Includes                                                                   */
 /******************************************************************************/
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* Required for sem_clockwait */
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include <unistd.h>
 #include <assert.h>
+#include <time.h>
 #include <pthread.h>
 #include <regex.h>
 #include <uuid4.h>
 #include <cJSON.h>
 #include <math.h>
+#include <limits.h>
 
 #include "discover.h"
 #include "sock.h"
+#include "wire.h"
+#include "aead.h"
+#include "cache.h"
+
+/******************************************************************************/
+/* Definitions                                                                */
+/******************************************************************************/
+
+/* Discover node record, the node and the fields of the index, of the expiry heap and of the indexes of the masters, which are not copied with the node */
+typedef struct {
+    discover_node_t  node;     /* Node, first member so that the nodes of the list are their records */
+    discover_node_t *hnext;    /* Next node in the same bucket of the index */
+    discover_node_t *mprev;    /* Previous node in the index of the master nodes */
+    discover_node_t *mnext;    /* Next node in the index of the master nodes */
+    discover_node_t *eprev;    /* Previous node in the index of the master eligible nodes */
+    discover_node_t *enext;    /* Next node in the index of the master eligible nodes */
+    uint64_t         hash;     /* Hash of the Process and Instance UUIDs of the node */
+    uint64_t         deadline; /* Time after which the node is considered dead, monotonic clock in milliseconds */
+    size_t           position; /* Position of the node in the expiry heap */
+} discover_record_t;
+
+/* Discover nodes slab, nodes records allocated at once and reused when the nodes are removed */
+struct discover_nodes_slab_s {
+    struct discover_nodes_slab_s *next;                              /* Next slab */
+    discover_record_t             records[DISCOVER_NODES_SLAB_SIZE]; /* Nodes records */
+};
+
+/* Record of a node of the list, the copies of the nodes have no record */
+#define DISCOVER_RECORD(node) ((discover_record_t *)(node))
 
 /******************************************************************************/
 /* Prototypes                                                                 */
@@ -62,6 +97,32 @@ static int discover_start_hello(discover_t *discover);
  */
 static void *discover_thread_hello(void *arg);
 
+/**
+ * @brief Send the hello message
+ * @param discover Discover instance
+ */
+static void discover_emit_hello(discover_t *discover);
+
+/**
+ * @brief Compute the time of the next hello message, depending of the number of nodes
+ * @param discover Discover instance
+ * @param now Current time, monotonic clock in milliseconds
+ */
+static void discover_schedule_hello(discover_t *discover, uint64_t now);
+
+/**
+ * @brief Send the next hello messages sooner, at the hello interval, because the state of the instance has changed
+ * @param discover Discover instance
+ */
+static void discover_request_hellos(discover_t *discover);
+
+/**
+ * @brief Wait until a time or until the semaphore is posted
+ * @param sem Semaphore
+ * @param time Time, monotonic clock in milliseconds
+ */
+static void discover_wait_until(sem_t *sem, uint64_t time);
+
 /**
  * @brief Start check thread
  * @param discover Discover instance
@@ -77,1218 +138,5648 @@ static int discover_start_check(discover_t *discover);
 static void *discover_thread_check(void *arg);
 
 /**
- * @brief Callback function called to handle received data
- * @param sock Sock instance
- * @param ip IP address of the sender
- * @param port Port of the sender
- * @param buffer Data received
- * @param size Size of data received
- * @param user User data
+ * @brief Remove the nodes which are no more alive and elect the masters
+ * @param discover Discover instance
+ * @param now Current time, monotonic clock in milliseconds
  */
-static void discover_message_cb(sock_t *sock, char *ip, uint16_t port, void *buffer, size_t size, void *user);
+static void discover_check_nodes(discover_t *discover, uint64_t now);
 
 /**
- * @brief Callback function called to handle error from sock instance
- * @param sock Sock instance
- * @param err Error as string
- * @param user User data
+ * @brief Start dispatch thread
+ * @param discover Discover instance
+ * @return 0 if the function succeeded, -1 otherwise
  */
-static void discover_error_cb(sock_t *sock, char *err, void *user);
+static int discover_start_dispatch(discover_t *discover);
 
 /**
- * @brief Generate UUID V4
- * @param buf Buffer to store UUID
- * @return 0 if the function succeeded, -1 otherwise
+ * @brief Thread used to invoke the callbacks of the events queued
+ * @param arg Discover instance
+ * @return Always returns NULL
  */
-static int discover_generate_uuid(char **buf);
+static void *discover_thread_dispatch(void *arg);
 
-/******************************************************************************/
-/* Functions                                                                  */
-/******************************************************************************/
+/**
+ * @brief Queue an event, its callback is invoked later by the dispatch thread or by discover_poll_events
+ * @param discover Discover instance
+ * @param type Type of the event
+ * @param node Copy of the node, owned by the event, NULL if the event is not related to a node
+ * @param received Time the message causing the event has been received, monotonic clock in microseconds, 0 if not caused by a message
+ */
+static void discover_queue_event(discover_t *discover, discover_event_type_t type, discover_node_t *node, uint64_t received);
 
 /**
- * @brief Function used to create discover instance
- * @return Discover instance if the function succeeded, NULL otherwise
+ * @brief Queue a statistics event with a copy of the current statistics, its callback is invoked later by the dispatch thread or by discover_poll_events
+ * @param discover Discover instance
  */
-discover_t *
-discover_create(void) {
+static void discover_queue_stats(discover_t *discover);
 
-    /* Create discover instance */
-    discover_t *discover = (discover_t *)malloc(sizeof(discover_t));
-    if (NULL == discover) {
-        /* Unable to allocate memory */
-        return NULL;
-    }
-    memset(discover, 0, sizeof(discover_t));
+/**
+ * @brief Add an event at the end of the queue, it is released if the queue is full
+ * @param discover Discover instance
+ * @param event Event
+ */
+static void discover_push_event(discover_t *discover, discover_event_t *event);
 
-    /* Create sock instance */
-    if (NULL == (discover->sock = sock_create())) {
-        /* Unable to allocate memory */
-        free(discover);
-        return NULL;
-    }
+/**
+ * @brief Remove the first event of the queue
+ * @param discover Discover instance
+ * @return Event if the queue is not empty, NULL otherwise
+ */
+static discover_event_t *discover_pop_event(discover_t *discover);
 
-    /* Set default options */
-    discover->options.hello_interval = 1000;
-    discover->options.check_interval = 2000;
-    discover->options.node_timeout   = 2000;
-    discover->options.master_timeout = 2000;
-    discover->options.address        = strdup("0.0.0.0");
-    if (NULL == discover->options.address) {
-        /* Unable to allocate memory */
-        sock_release(discover->sock);
-        free(discover);
-        return NULL;
-    }
-    discover->options.port      = 12345;
-    discover->options.broadcast = strdup("255.255.255.255");
-    if (NULL == discover->options.broadcast) {
-        /* Unable to allocate memory */
-        sock_release(discover->sock);
-        free(discover->options.address);
-        free(discover);
-        return NULL;
-    }
-    discover->options.multicast        = NULL;
-    discover->options.multicast_ttl    = 1;
-    discover->options.unicast          = NULL;
-    discover->options.key              = NULL;
-    discover->options.masters_required = 1;
-    discover->options.client           = false;
-    discover->options.reuse_addr       = true;
-    discover->options.ignore_process   = true;
-    discover->options.ignore_instance  = true;
-    discover->options.advertisement    = NULL;
+/**
+ * @brief Invoke the callback of an event and release it
+ * @param discover Discover instance
+ * @param event Event
+ */
+static void discover_dispatch_event(discover_t *discover, discover_event_t *event);
 
-    /* Get hostname */
-    if (NULL == (discover->options.hostname = (char *)malloc(128 + 1))) {
-        /* Unable to allocate memory */
-        sock_release(discover->sock);
-        free(discover->options.address);
-        free(discover->options.broadcast);
-        free(discover);
-        return NULL;
-    }
-    memset(discover->options.hostname, 0, 128);
-    if (0 > gethostname(discover->options.hostname, 128)) {
-        /* Unable to get hostname */
-        sock_release(discover->sock);
-        free(discover->options.address);
-        free(discover->options.broadcast);
-        free(discover->options.hostname);
-        free(discover);
-        return NULL;
-    }
+/**
+ * @brief Invoke the callbacks of the events already queued
+ * @param discover Discover instance
+ * @return Number of events handled
+ */
+static int discover_dispatch_events(discover_t *discover);
 
-    /* Compute weight */
-    discover->options.weight = (double)time(NULL);
-    while (1 < discover->options.weight) {
-        discover->options.weight /= 10;
-    }
-    discover->options.weight *= -1;
+/**
+ * @brief Build the beginning of the batches of messages and allocate the batch, options semaphore must be taken
+ * @param discover Discover instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int discover_prepare_batch(discover_t *discover);
 
-    /* Generate Process UUID */
-    if (0 > discover_generate_uuid(&discover->pid)) {
-        /* Unable to generate Process UUID */
-        sock_release(discover->sock);
-        free(discover->options.address);
-        free(discover->options.broadcast);
-        free(discover->options.hostname);
-        free(discover);
-        return NULL;
-    }
+/**
+ * @brief Start send thread
+ * @param discover Discover instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int discover_start_send(discover_t *discover);
 
-    /* Generate Instance UUID */
-    if (0 > discover_generate_uuid(&discover->iid)) {
-        /* Unable to generate Instance UUID */
-        sock_release(discover->sock);
-        free(discover->options.address);
-        free(discover->options.broadcast);
-        free(discover->options.hostname);
-        free(discover->pid);
-        free(discover);
-        return NULL;
-    }
+/**
+ * @brief Thread used to send the batches of messages and to retransmit the directed messages when they are due
+ * @param arg Discover instance
+ * @return Always returns NULL
+ */
+static void *discover_thread_send(void *arg);
 
-    /* Eligible as master by default */
-    discover->is_master_eligible = true;
+/**
+ * @brief Add a message to the batch pending, the batch is sent first if the message doesn't fit in it
+ * @param discover Discover instance
+ * @param str Message serialized without its envelope, released by the function
+ * @param delay Maximum time the message waits in the batch in milliseconds
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int discover_batch_message(discover_t *discover, char *str, int delay);
 
-    /* Initialize semaphore used to access nodes */
-    sem_init(&discover->nodes.sem, 0, 1);
+/**
+ * @brief Send the batch pending if it is due
+ * @param discover Discover instance
+ * @param now Current time, monotonic clock in milliseconds
+ * @return Time the batch pending must be sent if it is not due, 0 if no batch is pending
+ */
+static uint64_t discover_check_batch(discover_t *discover, uint64_t now);
 
-    /* Initialize semaphore used to access channels */
-    sem_init(&discover->channels.sem, 0, 1);
+/**
+ * @brief Send a batch of messages, batch semaphore must be taken
+ * @param discover Discover instance
+ * @param messages Messages serialized without their envelope, separated by commas
+ * @param size Size of the messages
+ * @param count Number of messages
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int discover_transmit_batch(discover_t *discover, char *messages, size_t size, int count);
 
-    /* Initialize semaphore used to access options */
-    sem_init(&discover->options.sem, 0, 1);
+/**
+ * @brief Retransmit the directed messages not acknowledged in time, the ones without retransmissions remaining are reported and removed
+ * @param discover Discover instance
+ * @param now Current time, monotonic clock in milliseconds
+ * @return Time of the next retransmission, 0 if no directed message is waiting for its acknowledgement
+ */
+static uint64_t discover_check_directed(discover_t *discover, uint64_t now);
 
-    /* Register message and error callbacks */
-    sock_on(discover->sock, "message", &discover_message_cb, discover);
-    sock_on(discover->sock, "error", &discover_error_cb, discover);
+/**
+ * @brief Remove a directed message waiting for its acknowledgement
+ * @param discover Discover instance
+ * @param sequence Sequence number of the message
+ * @param pid Process UUID of the destination of the message
+ * @param iid Instance UUID of the destination of the message
+ * @return 0 if the function succeeded, -1 if the message is not found
+ */
+static int discover_remove_directed(discover_t *discover, uint32_t sequence, char *pid, char *iid);
 
-    return discover;
-}
+/**
+ * @brief Serialize a message, options semaphore must be taken
+ * @param discover Discover instance
+ * @param event Event name
+ * @param data Data of the message
+ * @return Message serialized if the function succeeded, NULL otherwise
+ */
+static char *discover_serialize_message(discover_t *discover, char *event, cJSON *data);
 
 /**
- * @brief Set discover options
+ * @brief Serialize a message without its envelope, to be sent in a batch
+ * @param event Event name
+ * @param data Data of the message
+ * @return Message serialized if the function succeeded, NULL otherwise
+ */
+static char *discover_serialize_batched(char *event, cJSON *data);
+
+/**
+ * @brief Serialize a message directed to a single node, options semaphore must be taken
  * @param discover Discover instance
- * @param option Option by name
- * @param value New value of the option
+ * @param event Event name
+ * @param data Data of the message
+ * @param pid Process UUID of the destination
+ * @param iid Instance UUID of the destination
+ * @param sequence Sequence number of the message, 0 if no acknowledgement is requested
+ * @return Message serialized if the function succeeded, NULL otherwise
+ */
+static char *discover_serialize_directed(discover_t *discover, char *event, cJSON *data, char *pid, char *iid, uint32_t sequence);
+
+/**
+ * @brief Serialize the hello message and store it, options semaphore must be taken
+ * @param discover Discover instance
+ * @param omit true to omit the advertisement, only its hash is sent
  * @return 0 if the function succeeded, -1 otherwise
  */
-int
-discover_set_option(discover_t *discover, char *option, void *value) {
+static int discover_serialize_hello(discover_t *discover, bool omit);
 
-    assert(NULL != discover);
-    assert(NULL != option);
-    assert(NULL != value);
+/**
+ * @brief Serialize the hello message using the binary encoding, options semaphore must be taken
+ * @param discover Discover instance
+ * @param advertisement Advertisement serialized, NULL if there is no advertisement or if it is omitted
+ * @param hash Hash of the advertisement, 0 if there is no advertisement
+ * @param size Size of the message serialized
+ * @return Message serialized if the function succeeded, NULL otherwise
+ */
+static char *discover_serialize_binary_hello(discover_t *discover, char *advertisement, uint32_t hash, size_t *size);
 
-    int ret = -1;
+/**
+ * @brief Compute the hash of a serialized advertisement
+ * @param advertisement Advertisement serialized
+ * @return Hash value, never 0
+ */
+static uint32_t discover_hash_advertisement(const char *advertisement);
 
-    /* Wait options semaphore */
-    sem_wait(&discover->options.sem);
+/**
+ * @brief Callback function called to handle received data
+ * @param sock Sock instance
+ * @param ip IP address of the sender
+ * @param port Port of the sender
+ * @param buffer Data received
+ * @param size Size of data received
+ * @param received Time the data has been received, monotonic clock in microseconds
+ * @param user User data
+ */
+static void discover_message_cb(sock_t *sock, char *ip, uint16_t port, void *buffer, size_t size, uint64_t received, void *user);
 
-    /* Treatment depending of the option */
-    if (!strcmp("helloInterval", option)) {
-        discover->options.hello_interval = *((int *)value);
-        ret                              = 0;
-    } else if (!strcmp("checkInterval", option)) {
-        int tmp = *((int *)value);
-        if (tmp <= discover->options.node_timeout) {
-            discover->options.check_interval = tmp;
-            ret                              = 0;
-        }
-    } else if (!strcmp("nodeTimeout", option)) {
-        int tmp = *((int *)value);
-        if ((tmp >= discover->options.check_interval) && (tmp <= discover->options.master_timeout)) {
-            discover->options.node_timeout = tmp;
-            ret                            = 0;
-        }
-    } else if (!strcmp("masterTimeout", option)) {
-        int tmp = *((int *)value);
-        if (tmp >= discover->options.node_timeout) {
-            discover->options.master_timeout = tmp;
-            ret                              = 0;
-        }
-    } else if (!strcmp("address", option)) {
-        if (NULL != discover->options.address) {
-            free(discover->options.address);
-        }
-        discover->options.address = strdup((char *)value);
-        if (NULL != discover->options.address) {
-            ret = 0;
-        }
-    } else if (!strcmp("port", option)) {
-        discover->options.port = *((uint16_t *)value);
-        ret                    = 0;
-    } else if (!strcmp("broadcast", option)) {
-        if (NULL != discover->options.broadcast) {
+/**
+ * @brief Invoke the callbacks of the channels matching the event of a message
+ * @param discover Discover instance
+ * @param event Event of the message
+ * @param json Message
+ * @param received Time the message has been read, monotonic clock in microseconds
+ */
+static void discover_dispatch_channels(discover_t *discover, char *event, cJSON *json, uint64_t received);
+
+/**
+ * @brief Compute the bloom filter of the channels joined and store it for the hello message, channels semaphore must be taken
+ * @param discover Discover instance
+ * @return true if the channels joined are advertised, false otherwise
+ */
+static bool discover_update_channels(discover_t *discover);
+
+/**
+ * @brief Add a channel to a bloom filter of channels
+ * @param filter Bloom filter, DISCOVER_CHANNELS_FILTER_SIZE bytes
+ * @param channel Event of the channel
+ * @param length Length of the event
+ */
+static void discover_add_channel(uint8_t *filter, const char *channel, size_t length);
+
+/**
+ * @brief Check if a bloom filter of channels may contain a channel matching an event, literal channels match the events containing them
+ * @param filter Bloom filter, DISCOVER_CHANNELS_FILTER_SIZE bytes
+ * @param event Event
+ * @return true if a channel may match the event, false if no channel matches it
+ */
+static bool discover_match_channels(const uint8_t *filter, const char *event);
+
+/**
+ * @brief Check if an event is reserved by the library
+ * @param event Event
+ * @return true if the event starts with the reserved prefix, false otherwise
+ */
+static bool discover_is_reserved(const char *event);
+
+/**
+ * @brief Compute the bits of the bloom filter of the channels set by each substring of an event, a channel contained in the event sets the ones of a substring
+ * @param event Event
+ * @param bits Union of the bits set by the substrings, DISCOVER_CHANNELS_FILTER_SIZE bytes
+ * @param count Number of substrings
+ * @return Bits set by the substrings, DISCOVER_CHANNELS_FILTER_HASHES per substring, NULL if the function failed, it must be released by the caller
+ */
+static uint16_t *discover_hash_event(const char *event, uint8_t *bits, size_t *count);
+
+/**
+ * @brief Check if a channel of a bloom filter may match an event, using the bits set by the substrings of the event
+ * @param filter Bloom filter of the channels, DISCOVER_CHANNELS_FILTER_SIZE bytes
+ * @param bits Union of the bits set by the substrings, DISCOVER_CHANNELS_FILTER_SIZE bytes
+ * @param hashes Bits set by the substrings, DISCOVER_CHANNELS_FILTER_HASHES per substring
+ * @param count Number of substrings
+ * @return true if a channel may match the event, false if no channel matches it
+ */
+static bool discover_match_hashes(const uint8_t *filter, const uint8_t *bits, const uint16_t *hashes, size_t count);
+
+/**
+ * @brief Decode a bloom filter of channels from its hexadecimal representation
+ * @param str Hexadecimal representation, 2 * DISCOVER_CHANNELS_FILTER_SIZE digits
+ * @param filter Bloom filter, DISCOVER_CHANNELS_FILTER_SIZE bytes
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int discover_decode_channels(const char *str, uint8_t *filter);
+
+/**
+ * @brief Handle the destination of a message, acknowledge it if it is requested
+ * @param discover Discover instance
+ * @param ip IP address of the sender
+ * @param port Port of the sender
+ * @param json Message
+ * @param pid Process UUID of the sender
+ * @param iid Instance UUID of the sender
+ * @return true if the message must be handled, false if it is directed to another instance or if it has already been received
+ */
+static bool discover_receive_directed(discover_t *discover, char *ip, uint16_t port, cJSON *json, char *pid, char *iid);
+
+/**
+ * @brief Scan JSON string without parsing it
+ * @param pos Position of the opening quote, updated to the position following the closing quote
+ * @param end End of the buffer
+ * @param start Start of the string content
+ * @param length Length of the string content
+ * @param escaped true if the string contains escape sequences, false otherwise
+ * @return 0 if the function succeeded, -1 if the string is not terminated
+ */
+static int discover_scan_string(char **pos, char *end, char **start, size_t *length, bool *escaped);
+
+/**
+ * @brief Scan JSON message and retrieve its Process and Instance UUIDs without parsing it, used to drop messages before allocating memory
+ * @param buffer Message
+ * @param size Size of the message
+ * @param pid Process UUID of the sender, WIRE_UUID_STR_SIZE bytes, empty if it can't be retrieved without parsing the message
+ * @param iid Instance UUID of the sender, WIRE_UUID_STR_SIZE bytes, empty if it can't be retrieved without parsing the message
+ * @return 0 if the function succeeded, -1 if the message is malformed or has no Process or Instance UUIDs
+ */
+static int discover_scan_message(char *buffer, size_t size, char *pid, char *iid);
+
+/**
+ * @brief Check if a message should be ignored because it is sent by myself
+ * @param discover Discover instance
+ * @param pid Process UUID of the sender
+ * @param iid Instance UUID of the sender
+ * @return true if the message should be ignored, false otherwise
+ */
+static bool discover_ignore_message(discover_t *discover, char *pid, char *iid);
+
+/**
+ * @brief Handle binary message
+ * @param discover Discover instance
+ * @param ip IP address of the sender
+ * @param port Port of the sender
+ * @param buffer Data received
+ * @param size Size of data received
+ * @param received Time the data has been received, monotonic clock in microseconds
+ */
+static void discover_receive_binary(discover_t *discover, char *ip, uint16_t port, void *buffer, size_t size, uint64_t received);
+
+/**
+ * @brief Handle hello message, add or update the node
+ * @param discover Discover instance
+ * @param ip IP address of the sender
+ * @param port Port of the sender
+ * @param pid Process UUID of the sender
+ * @param iid Instance UUID of the sender
+ * @param hello Hello message
+ * @param advertisement Advertisement of the sender, owned by the function, NULL if there is no advertisement or if it is serialized in the hello message
+ * @param received Time the hello message has been received, monotonic clock in microseconds
+ */
+static void discover_receive_hello(
+    discover_t *discover, char *ip, uint16_t port, char *pid, char *iid, wire_hello_t *hello, cJSON *advertisement, uint64_t received);
+
+/**
+ * @brief Update the advertisement of a node, nodes semaphore must be taken
+ * @param node Node
+ * @param hello Hello message
+ * @param advertisement Advertisement of the sender, set to NULL once moved to the node, NULL if there is none or if it is serialized in the hello message
+ * @return true if the advertisement has been omitted and is unknown, false otherwise
+ */
+static bool discover_update_advertisement(discover_node_t *node, wire_hello_t *hello, cJSON **advertisement);
+
+/**
+ * @brief Request the advertisement of a node, which sends it with its next hello messages
+ * @param discover Discover instance
+ * @param pid Process UUID of the node
+ * @param iid Instance UUID of the node
+ */
+static void discover_request_advertisement(discover_t *discover, char *pid, char *iid);
+
+/**
+ * @brief Send a message of a reserved channel to all destinations, the message is never batched nor filtered so that all the receivers handle it
+ * @param discover Discover instance
+ * @param event Event
+ * @param data Data to send
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int discover_send_reserved(discover_t *discover, char *event, cJSON *data);
+
+/**
+ * @brief Send message, encrypted if a key is set
+ * @param discover Discover instance
+ * @param buffer Message, released by the function in all cases
+ * @param size Size of the message
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int discover_transmit(discover_t *discover, void *buffer, size_t size);
+
+/**
+ * @brief Send message to a single destination, or to all destinations, encrypted if a key is set
+ * @param discover Discover instance
+ * @param ip IP address of the destination, NULL to send the message to all destinations
+ * @param port Port of the destination
+ * @param buffer Message, released by the function in all cases
+ * @param size Size of the message
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int discover_transmit_to(discover_t *discover, char *ip, uint16_t port, void *buffer, size_t size);
+
+/**
+ * @brief Split the unicast addresses, options semaphore must be taken
+ * @param discover Discover instance
+ * @param unicast Comma separated string of unicast addresses
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int discover_parse_unicast(discover_t *discover, char *unicast);
+
+/**
+ * @brief Send message to the unicast addresses, skipping the ones of the nodes which have not joined the channel of the message
+ * @param discover Discover instance
+ * @param event Event of the message
+ * @param port Port of the destinations
+ * @param buffer Message, released by the function in all cases
+ * @param size Size of the message
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int discover_transmit_unicast(discover_t *discover, char *event, uint16_t port, void *buffer, size_t size);
+
+/**
+ * @brief Load the nodes of the cache file, they are stale until they are seen, options semaphore must be taken
+ * @param discover Discover instance
+ */
+static void discover_load_cache(discover_t *discover);
+
+/**
+ * @brief Add the addresses of the nodes to the unicast addresses, options semaphore must be taken
+ * @param discover Discover instance
+ * @return Comma separated string of unicast addresses if the function succeeded, NULL otherwise, it must be released by the caller
+ */
+static char *discover_seed_unicast(discover_t *discover);
+
+/**
+ * @brief Write the cache file if the nodes have changed since it has been written
+ * @param discover Discover instance
+ */
+static void discover_save_cache(discover_t *discover);
+
+/**
+ * @brief Callback function called to handle error from sock instance
+ * @param sock Sock instance
+ * @param err Error as string
+ * @param user User data
+ */
+static void discover_error_cb(sock_t *sock, char *err, void *user);
+
+/**
+ * @brief Generate UUID V4
+ * @param buf Buffer to store UUID
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int discover_generate_uuid(char **buf);
+
+/**
+ * @brief Retrieve the current time of the monotonic clock
+ * @return Time in milliseconds
+ */
+static uint64_t discover_get_time(void);
+
+/**
+ * @brief Retrieve the current time of the monotonic clock
+ * @return Time in microseconds
+ */
+static uint64_t discover_get_time_us(void);
+
+/**
+ * @brief Wait a semaphore, the time spent waiting is measured only if it is already taken
+ * @param sem Semaphore
+ * @param stats Lock statistics
+ */
+static void discover_lock(sem_t *sem, discover_lock_stats_t *stats);
+
+/**
+ * @brief Add a sample to a latency histogram
+ * @param histogram Latency histogram
+ * @param value Latency in microseconds
+ */
+static void discover_record_latency(discover_histogram_t *histogram, uint64_t value);
+
+/**
+ * @brief Read a latency histogram
+ * @param histogram Latency histogram
+ * @param copy Copy of the histogram
+ */
+static void discover_read_histogram(discover_histogram_t *histogram, discover_histogram_t *copy);
+
+/**
+ * @brief Compute the hash of the Process and Instance UUIDs of a node
+ * @param pid Process UUID
+ * @param iid Instance UUID
+ * @return Hash value
+ */
+static uint64_t discover_hash_node(const char *pid, const char *iid);
+
+/**
+ * @brief Search a node in the index, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @param pid Process UUID
+ * @param iid Instance UUID
+ * @return Node if it is found, NULL otherwise
+ */
+static discover_node_t *discover_lookup_node(discover_t *discover, const char *pid, const char *iid);
+
+/**
+ * @brief Add a node at the end of the list and in the index, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @param node Node
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int discover_insert_node(discover_t *discover, discover_node_t *node);
+
+/**
+ * @brief Remove a node from the list and from the index, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @param node Node
+ */
+static void discover_remove_node(discover_t *discover, discover_node_t *node);
+
+/**
+ * @brief Move a node in the expiry heap after its deadline has changed, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @param node Node
+ */
+static void discover_update_node(discover_t *discover, discover_node_t *node);
+
+/**
+ * @brief Add or remove a node from the master election counters, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @param node Node
+ * @param delta 1 to add the node, -1 to remove it
+ */
+static void discover_count_node(discover_t *discover, discover_node_t *node, int delta);
+
+/**
+ * @brief Add or remove a node from the channels joined by the nodes of its unicast address, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @param node Node
+ * @param delta 1 to add the node, -1 to remove it
+ */
+static void discover_filter_node(discover_t *discover, discover_node_t *node, int delta);
+
+/**
+ * @brief Add or remove a node from the indexes of the master and master eligible nodes, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @param node Node
+ * @param add true to add the node, false to remove it
+ */
+static void discover_index_node(discover_t *discover, discover_node_t *node, bool add);
+
+/**
+ * @brief Copy the content of a node, nodes semaphore must be taken
+ * @param copy Copy of the node
+ * @param node Node
+ */
+static void discover_copy_node(discover_node_t *copy, discover_node_t *node);
+
+/**
+ * @brief Duplicate a node, nodes semaphore must be taken
+ * @param node Node
+ * @return Copy of the node if the function succeeded, NULL otherwise, the copy must be released using discover_node_release
+ */
+static discover_node_t *discover_duplicate_node(discover_node_t *node);
+
+/**
+ * @brief Release the content of a node
+ * @param node Node
+ */
+static void discover_clear_node(discover_node_t *node);
+
+/**
+ * @brief Replace a string if its value has changed
+ * @param str String to be replaced
+ * @param value New value
+ * @return true if the string has changed, false otherwise
+ */
+static bool discover_update_string(char **str, const char *value);
+
+/**
+ * @brief Replace the content of a fixed size string if its value has changed, the value is truncated if it is too long
+ * @param str String to be replaced
+ * @param size Size of the string, including the null character
+ * @param value New value
+ * @return true if the string has changed, false otherwise
+ */
+static bool discover_update_buffer(char *str, size_t size, const char *value);
+
+/**
+ * @brief Allocate a node record from the slabs, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @return Node record cleared if the function succeeded, NULL otherwise
+ */
+static discover_node_t *discover_alloc_node(discover_t *discover);
+
+/**
+ * @brief Release the content of a node and give its record back to the slabs, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @param node Node
+ */
+static void discover_free_node(discover_t *discover, discover_node_t *node);
+
+/**
+ * @brief Release a snapshot once its last reference is dropped
+ * @param snapshot Snapshot
+ */
+static void discover_unref_snapshot(discover_nodes_snapshot_t *snapshot);
+
+/**
+ * @brief Allocate a snapshot of nodes
+ * @param capacity Maximum number of nodes of the snapshot
+ * @return Snapshot referenced once if the function succeeded, NULL otherwise
+ */
+static discover_nodes_snapshot_t *discover_create_snapshot(size_t capacity);
+
+/**
+ * @brief Add the copy of a node at the end of a snapshot, nodes semaphore must be taken
+ * @param snapshot Snapshot
+ * @param node Node
+ */
+static void discover_append_snapshot(discover_nodes_snapshot_t *snapshot, discover_node_t *node);
+
+/******************************************************************************/
+/* Functions                                                                  */
+/******************************************************************************/
+
+/**
+ * @brief Function used to create discover instance
+ * @return Discover instance if the function succeeded, NULL otherwise
+ */
+discover_t *
+discover_create(void) {
+
+    /* Create discover instance */
+    discover_t *discover = (discover_t *)malloc(sizeof(discover_t));
+    if (NULL == discover) {
+        /* Unable to allocate memory */
+        return NULL;
+    }
+    memset(discover, 0, sizeof(discover_t));
+
+    /* Create sock instance */
+    if (NULL == (discover->sock = sock_create())) {
+        /* Unable to allocate memory */
+        free(discover);
+        return NULL;
+    }
+
+    /* Set default options */
+    discover->options.hello_interval = 1000;
+    discover->options.check_interval = 2000;
+    discover->options.node_timeout   = 2000;
+    discover->options.master_timeout = 2000;
+    discover->options.hello_jitter   = 10;
+    discover->options.hello_nodes    = 0;
+    discover->options.address        = strdup("0.0.0.0");
+    if (NULL == discover->options.address) {
+        /* Unable to allocate memory */
+        sock_release(discover->sock);
+        free(discover);
+        return NULL;
+    }
+    discover->options.port      = 12345;
+    discover->options.broadcast = strdup("255.255.255.255");
+    if (NULL == discover->options.broadcast) {
+        /* Unable to allocate memory */
+        sock_release(discover->sock);
+        free(discover->options.address);
+        free(discover);
+        return NULL;
+    }
+    discover->options.multicast           = NULL;
+    discover->options.multicast_ttl       = 1;
+    discover->options.interfaces          = NULL;
+    discover->options.unicast             = NULL;
+    discover->options.key                 = NULL;
+    discover->options.masters_required    = 1;
+    discover->options.client              = false;
+    discover->options.reuse_addr          = true;
+    discover->options.ignore_process      = true;
+    discover->options.ignore_instance     = true;
+    discover->options.advertisement       = NULL;
+    discover->options.receive_workers     = 4;
+    discover->options.receive_queue_depth = 128;
+    discover->options.receive_shards      = 1;
+    discover->options.send_queue_depth    = 128;
+    discover->options.max_datagram_size   = SOCK_DATAGRAM_SIZE_MAX;
+    discover->options.batch_size          = 0;
+    discover->options.batch_delay         = 1;
+    discover->options.ack_timeout         = 0;
+    discover->options.ack_retries         = 3;
+    discover->options.channels_filter     = false;
+    discover->options.poll_events         = false;
+    discover->options.event_queue_depth   = 1024;
+    discover->options.threaded            = true;
+    discover->options.stats_interval      = 0;
+    discover->options.cache_file          = NULL;
+
+    /* Get hostname */
+    if (NULL == (discover->options.hostname = (char *)malloc(128 + 1))) {
+        /* Unable to allocate memory */
+        sock_release(discover->sock);
+        free(discover->options.address);
+        free(discover->options.broadcast);
+        free(discover);
+        return NULL;
+    }
+    memset(discover->options.hostname, 0, 128);
+    if (0 > gethostname(discover->options.hostname, 128)) {
+        /* Unable to get hostname */
+        sock_release(discover->sock);
+        free(discover->options.address);
+        free(discover->options.broadcast);
+        free(discover->options.hostname);
+        free(discover);
+        return NULL;
+    }
+
+    /* Compute weight */
+    discover->options.weight = (double)time(NULL);
+    while (1 < discover->options.weight) {
+        discover->options.weight /= 10;
+    }
+    discover->options.weight *= -1;
+
+    /* Generate Process UUID */
+    if (0 > discover_generate_uuid(&discover->pid)) {
+        /* Unable to generate Process UUID */
+        sock_release(discover->sock);
+        free(discover->options.address);
+        free(discover->options.broadcast);
+        free(discover->options.hostname);
+        free(discover);
+        return NULL;
+    }
+
+    /* Generate Instance UUID */
+    if (0 > discover_generate_uuid(&discover->iid)) {
+        /* Unable to generate Instance UUID */
+        sock_release(discover->sock);
+        free(discover->options.address);
+        free(discover->options.broadcast);
+        free(discover->options.hostname);
+        free(discover->pid);
+        free(discover);
+        return NULL;
+    }
+
+    /* Eligible as master by default */
+    discover->is_master_eligible = true;
+
+    /* Initialize semaphore used to access nodes */
+    sem_init(&discover->nodes.sem, 0, 1);
+
+    /* Initialize semaphore used to access the latest snapshot of the nodes */
+    sem_init(&discover->snapshot.sem, 0, 1);
+
+    /* Initialize semaphores used to access the events */
+    sem_init(&discover->events.sem, 0, 1);
+    sem_init(&discover->events.pending, 0, 0);
+
+    /* Initialize semaphore used to access the batch of messages */
+    sem_init(&discover->batch.sem, 0, 1);
+
+    /* Initialize semaphore used to access the directed messages */
+    sem_init(&discover->directed.sem, 0, 1);
+
+    /* Initialize semaphore used to wake up the send thread */
+    sem_init(&discover->sender.wakeup, 0, 0);
+
+    /* Initialize semaphore used to access channels, no channel is joined yet */
+    sem_init(&discover->channels.sem, 0, 1);
+    discover->hello.filtered = true;
+
+    /* Initialize semaphore used to access options */
+    sem_init(&discover->options.sem, 0, 1);
+
+    /* Initialize semaphore used to wake up the hello thread */
+    sem_init(&discover->hello.wakeup, 0, 0);
+
+    /* Initialize semaphore used to wake up the check thread */
+    sem_init(&discover->check.wakeup, 0, 0);
+
+    /* Register message and error callbacks */
+    sock_on(discover->sock, "message", &discover_message_cb, discover);
+    sock_on(discover->sock, "error", &discover_error_cb, discover);
+
+    return discover;
+}
+
+/**
+ * @brief Set discover options
+ * @param discover Discover instance
+ * @param option Option by name
+ * @param value New value of the option
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+discover_set_option(discover_t *discover, char *option, void *value) {
+
+    assert(NULL != discover);
+    assert(NULL != option);
+    assert(NULL != value);
+
+    int ret = -1;
+
+    /* Wait options semaphore */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+
+    /* Treatment depending of the option */
+    if (!strcmp("helloInterval", option)) {
+        discover->options.hello_interval = *((int *)value);
+        ret                              = 0;
+    } else if (!strcmp("helloJitter", option)) {
+        int tmp = *((int *)value);
+        if ((0 <= tmp) && (100 >= tmp)) {
+            discover->options.hello_jitter = tmp;
+            ret                            = 0;
+        }
+    } else if (!strcmp("helloNodes", option)) {
+        int tmp = *((int *)value);
+        if (0 <= tmp) {
+            discover->options.hello_nodes = tmp;
+            ret                           = 0;
+        }
+    } else if (!strcmp("checkInterval", option)) {
+        int tmp = *((int *)value);
+        if (tmp <= discover->options.node_timeout) {
+            discover->options.check_interval = tmp;
+            ret                              = 0;
+        }
+    } else if (!strcmp("nodeTimeout", option)) {
+        int tmp = *((int *)value);
+        if ((tmp >= discover->options.check_interval) && (tmp <= discover->options.master_timeout)) {
+            discover->options.node_timeout = tmp;
+            ret                            = 0;
+        }
+    } else if (!strcmp("masterTimeout", option)) {
+        int tmp = *((int *)value);
+        if (tmp >= discover->options.node_timeout) {
+            discover->options.master_timeout = tmp;
+            ret                              = 0;
+        }
+    } else if (!strcmp("address", option)) {
+        if (NULL != discover->options.address) {
+            free(discover->options.address);
+        }
+        discover->options.address = strdup((char *)value);
+        if (NULL != discover->options.address) {
+            ret = 0;
+        }
+    } else if (!strcmp("port", option)) {
+        discover->options.port = *((uint16_t *)value);
+        ret                    = 0;
+    } else if (!strcmp("broadcast", option)) {
+        if (NULL != discover->options.broadcast) {
+            free(discover->options.broadcast);
+        }
+        discover->options.broadcast = strdup((char *)value);
+        if (NULL != discover->options.broadcast) {
+            ret = 0;
+        }
+    } else if (!strcmp("multicast", option)) {
+        if (NULL != discover->options.multicast) {
+            free(discover->options.multicast);
+        }
+        discover->options.multicast = strdup((char *)value);
+        if (NULL != discover->options.multicast) {
+            ret = 0;
+        }
+    } else if (!strcmp("multicastTTL", option)) {
+        discover->options.multicast_ttl = *((unsigned char *)value);
+        ret                             = 0;
+    } else if (!strcmp("interfaces", option)) {
+        if (NULL != discover->options.interfaces) {
+            free(discover->options.interfaces);
+        }
+        discover->options.interfaces = strdup((char *)value);
+        if (NULL != discover->options.interfaces) {
+            ret = 0;
+        }
+    } else if (!strcmp("unicast", option)) {
+        if (NULL != discover->options.unicast) {
+            free(discover->options.unicast);
+        }
+        discover->options.unicast = strdup((char *)value);
+        if (NULL != discover->options.unicast) {
+            ret = 0;
+        }
+    } else if (!strcmp("key", option)) {
+        if (NULL != discover->options.key) {
+            free(discover->options.key);
+        }
+        discover->options.key = strdup((char *)value);
+        if (NULL != discover->options.key) {
+            ret = 0;
+        }
+    } else if (!strcmp("mastersRequired", option)) {
+        discover->options.masters_required = *((int *)value);
+        ret                                = 0;
+    } else if (!strcmp("weight", option)) {
+        discover->options.weight = *((double *)value);
+        ret                      = 0;
+    } else if (!strcmp("client", option)) {
+        discover->options.client = *((bool *)value);
+        ret                      = 0;
+    } else if (!strcmp("reuseAddr", option)) {
+        discover->options.reuse_addr = *((bool *)value);
+        ret                          = 0;
+    } else if (!strcmp("ignoreProcess", option)) {
+        discover->options.ignore_process = *((bool *)value);
+        ret                              = 0;
+    } else if (!strcmp("ignoreInstance", option)) {
+        discover->options.ignore_instance = *((bool *)value);
+        ret                               = 0;
+    } else if (!strcmp("advertisement", option)) {
+        if (NULL != discover->options.advertisement) {
+            cJSON_Delete(discover->options.advertisement);
+        }
+        discover->options.advertisement = (NULL != value) ? cJSON_Duplicate((cJSON *)value, 1) : NULL;
+        ret                             = 0;
+    } else if (!strcmp("hostname", option)) {
+        if (NULL != discover->options.hostname) {
+            free(discover->options.hostname);
+        }
+        discover->options.hostname = strdup((char *)value);
+        if (NULL != discover->options.hostname) {
+            ret = 0;
+        }
+    } else if (!strcmp("receiveWorkers", option)) {
+        int tmp = *((int *)value);
+        if (0 < tmp) {
+            discover->options.receive_workers = tmp;
+            ret                               = 0;
+        }
+    } else if (!strcmp("receiveQueueDepth", option)) {
+        int tmp = *((int *)value);
+        if (0 < tmp) {
+            discover->options.receive_queue_depth = tmp;
+            ret                                   = 0;
+        }
+    } else if (!strcmp("receiveShards", option)) {
+        int tmp = *((int *)value);
+        if ((0 < tmp) && (SOCK_RECEIVE_SHARDS_MAX >= tmp)) {
+            discover->options.receive_shards = tmp;
+            ret                              = 0;
+        }
+    } else if (!strcmp("sendQueueDepth", option)) {
+        int tmp = *((int *)value);
+        if (0 < tmp) {
+            discover->options.send_queue_depth = tmp;
+            ret                                = 0;
+        }
+    } else if (!strcmp("batchSize", option)) {
+        int tmp = *((int *)value);
+        if ((0 <= tmp) && (SOCK_DATAGRAM_SIZE_MAX >= tmp)) {
+            discover->options.batch_size = tmp;
+            ret                          = 0;
+        }
+    } else if (!strcmp("batchDelay", option)) {
+        int tmp = *((int *)value);
+        if (0 < tmp) {
+            discover->options.batch_delay = tmp;
+            ret                           = 0;
+        }
+    } else if (!strcmp("ackTimeout", option)) {
+        int tmp = *((int *)value);
+        if (0 <= tmp) {
+            discover->options.ack_timeout = tmp;
+            ret                           = 0;
+        }
+    } else if (!strcmp("ackRetries", option)) {
+        int tmp = *((int *)value);
+        if (0 <= tmp) {
+            discover->options.ack_retries = tmp;
+            ret                           = 0;
+        }
+    } else if (!strcmp("maxDatagramSize", option)) {
+        int tmp = *((int *)value);
+        if ((0 < tmp) && (SOCK_DATAGRAM_SIZE_MAX >= tmp)) {
+            discover->options.max_datagram_size = tmp;
+            ret                                 = 0;
+        }
+    } else if (!strcmp("binaryHello", option)) {
+        discover->options.binary_hello = *((bool *)value);
+        ret                            = 0;
+    } else if (!strcmp("channelsFilter", option)) {
+        discover->options.channels_filter = *((bool *)value);
+        ret                               = 0;
+    } else if (!strcmp("advertisementRounds", option)) {
+        int tmp = *((int *)value);
+        if (0 <= tmp) {
+            discover->options.advertisement_rounds = tmp;
+            ret                                    = 0;
+        }
+    } else if (!strcmp("pollEvents", option)) {
+        discover->options.poll_events = *((bool *)value);
+        ret                           = 0;
+    } else if (!strcmp("statsInterval", option)) {
+        int tmp = *((int *)value);
+        if (0 <= tmp) {
+            discover->options.stats_interval = tmp;
+            ret                              = 0;
+        }
+    } else if (!strcmp("cacheFile", option)) {
+        if (NULL != discover->options.cache_file) {
+            free(discover->options.cache_file);
+        }
+        /* An empty string disables the cache file */
+        discover->options.cache_file = ('\0' != *((char *)value)) ? strdup((char *)value) : NULL;
+        if (('\0' == *((char *)value)) || (NULL != discover->options.cache_file)) {
+            ret = 0;
+        }
+    } else if (!strcmp("threaded", option)) {
+        discover->options.threaded = *((bool *)value);
+        ret                        = 0;
+    } else if (!strcmp("eventQueueDepth", option)) {
+        int tmp = *((int *)value);
+        if (0 < tmp) {
+            discover->options.event_queue_depth = tmp;
+            ret                                 = 0;
+        }
+    }
+
+    /* Hello message must be serialized again */
+    if (0 == ret) {
+        discover->hello.dirty = true;
+    }
+
+    /* Release options semaphore */
+    sem_post(&discover->options.sem);
+
+    return ret;
+}
+
+/**
+ * @brief Start discovering
+ * @param discover Discover instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+discover_start(discover_t *discover) {
+
+    assert(NULL != discover);
+
+    /* Wait options semaphore */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+
+    /* Configure reception */
+    sock_set_option(discover->sock, "receiveWorkers", &discover->options.receive_workers);
+    sock_set_option(discover->sock, "receiveQueueDepth", &discover->options.receive_queue_depth);
+    sock_set_option(discover->sock, "receiveShards", &discover->options.receive_shards);
+    sock_set_option(discover->sock, "sendQueueDepth", &discover->options.send_queue_depth);
+    sock_set_option(discover->sock, "maxDatagramSize", &discover->options.max_datagram_size);
+    sock_set_option(discover->sock, "threaded", &discover->options.threaded);
+    if (NULL != discover->options.interfaces) {
+        sock_set_option(discover->sock, "interfaces", discover->options.interfaces);
+    }
+
+    /* Derive the encryption key once for all the messages */
+    if ((NULL != discover->options.key) && (NULL == discover->aead)) {
+        if (NULL == (discover->aead = aead_create(discover->options.key))) {
+            /* Unable to create encryption instance */
+            sem_post(&discover->options.sem);
+            return -1;
+        }
+    }
+
+    /* Load the nodes of the cache file, so that they are known before their first hello messages */
+    if (NULL != discover->options.cache_file) {
+        discover_load_cache(discover);
+    }
+
+    /* Add the addresses of the nodes loaded to the unicast addresses */
+    char *unicast = NULL;
+    if ((NULL != discover->options.unicast) && (NULL == (unicast = discover_seed_unicast(discover)))) {
+        /* Unable to allocate memory */
+        sem_post(&discover->options.sem);
+        return -1;
+    }
+
+    /* Bind socket */
+    int ret;
+    if (NULL != unicast) {
+        ret = sock_bind_unicast(discover->sock, discover->options.address, discover->options.port, discover->options.reuse_addr, unicast);
+    } else if (NULL != discover->options.multicast) {
+        ret = sock_bind_multicast(discover->sock,
+                                  discover->options.address,
+                                  discover->options.port,
+                                  discover->options.reuse_addr,
+                                  discover->options.multicast,
+                                  discover->options.multicast_ttl);
+    } else {
+        ret = sock_bind_broadcast(discover->sock, discover->options.address, discover->options.port, discover->options.reuse_addr, discover->options.broadcast);
+    }
+    if (0 != ret) {
+        /* Unable to bind socket */
+        free(unicast);
+        sem_post(&discover->options.sem);
+        return -1;
+    }
+
+    /* Split the unicast addresses, the ones of the nodes which have not joined the channel of a message are skipped */
+    if ((NULL != unicast) && (0 != discover_parse_unicast(discover, unicast))) {
+        /* Unable to allocate memory */
+        free(unicast);
+        sem_post(&discover->options.sem);
+        return -1;
+    }
+    free(unicast);
+
+    /* Prepare the batches of messages, the beginning of the batches is the envelope of a batch with an empty array of messages */
+    if ((0 < discover->options.batch_size) && (NULL == discover->batch.buffer)) {
+        if (0 != discover_prepare_batch(discover)) {
+            /* Unable to allocate memory */
+            sem_post(&discover->options.sem);
+            return -1;
+        }
+    }
+
+    /* Record the maximum number of events queued */
+    sem_wait(&discover->events.sem);
+    discover->events.depth = discover->options.event_queue_depth;
+    sem_post(&discover->events.sem);
+
+    /* The first hello messages are sent at the hello interval so that the other nodes see the instance quickly, the first one is sent immediately */
+    discover->hello.seed  = (unsigned int)(discover_get_time_us() ^ discover_hash_node(discover->pid, discover->iid));
+    discover->hello.burst = DISCOVER_HELLO_BURST;
+    discover->next_hello  = discover_get_time();
+
+    /* No thread is created, the application calls discover_process which sends the first hello message and checks the nodes immediately */
+    if (false == discover->options.threaded) {
+        discover->next_check = discover->next_hello;
+        sem_post(&discover->options.sem);
+        return 0;
+    }
+
+    /* Start the thread invoking the callbacks depending of the option */
+    if ((false == discover->options.poll_events) && (false == discover->events.running)) {
+        if (0 != discover_start_dispatch(discover)) {
+            /* Unable to start task */
+            sem_post(&discover->options.sem);
+            return -1;
+        }
+    }
+
+    /* Start the thread sending the batches of messages and retransmitting the directed messages depending of the options */
+    if (((NULL != discover->batch.buffer) || (0 < discover->options.ack_timeout)) && (false == discover->sender.running)) {
+        if (0 != discover_start_send(discover)) {
+            /* Unable to start task */
+            sem_post(&discover->options.sem);
+            return -1;
+        }
+    }
+
+    /* Start periodic "check" task */
+    if (0 != discover_start_check(discover)) {
+        /* Unable to start task */
+        sem_post(&discover->options.sem);
+        return -1;
+    }
+
+    /* Start periodic "hello" task depending of the option */
+    if (false == discover->options.client) {
+        if (0 != discover_start_hello(discover)) {
+            /* Unable to start task */
+            sem_post(&discover->options.sem);
+            return -1;
+        }
+    }
+
+    /* Release options semaphore */
+    sem_post(&discover->options.sem);
+
+    return 0;
+}
+
+/**
+ * @brief Register callbacks
+ * @param discover Discover instance
+ * @param topic Topic
+ * @param fct Callback funtion
+ * @param user User data
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+discover_on(discover_t *discover, char *topic, void *fct, void *user) {
+
+    assert(NULL != discover);
+    assert(NULL != topic);
+
+    /* Record callback depending of the topic */
+    if (!strcmp(topic, "helloReceived")) {
+        discover->cb.hello_received.fct  = fct;
+        discover->cb.hello_received.user = user;
+    } else if (!strcmp(topic, "helloEmitted")) {
+        discover->cb.hello_emitted.fct  = fct;
+        discover->cb.hello_emitted.user = user;
+    } else if (!strcmp(topic, "promotion")) {
+        discover->cb.promotion.fct  = fct;
+        discover->cb.promotion.user = user;
+    } else if (!strcmp(topic, "demotion")) {
+        discover->cb.demotion.fct  = fct;
+        discover->cb.demotion.user = user;
+    } else if (!strcmp(topic, "check")) {
+        discover->cb.check.fct  = fct;
+        discover->cb.check.user = user;
+    } else if (!strcmp(topic, "added")) {
+        discover->cb.added.fct  = fct;
+        discover->cb.added.user = user;
+    } else if (!strcmp(topic, "master")) {
+        discover->cb.master.fct  = fct;
+        discover->cb.master.user = user;
+    } else if (!strcmp(topic, "removed")) {
+        discover->cb.removed.fct  = fct;
+        discover->cb.removed.user = user;
+    } else if (!strcmp(topic, "error")) {
+        discover->cb.error.fct  = fct;
+        discover->cb.error.user = user;
+    } else if (!strcmp(topic, "stats")) {
+        discover->cb.stats.fct  = fct;
+        discover->cb.stats.user = user;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Function used to set advertisement
+ * @param discover Discover instance
+ * @param advertisement Advestisement object
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+discover_advertise(discover_t *discover, cJSON *advertisement) {
+
+    assert(NULL != discover);
+
+    /* Wait options semaphore */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+
+    /* Set advertisement */
+    if (NULL != discover->options.advertisement) {
+        cJSON_Delete(discover->options.advertisement);
+    }
+    discover->options.advertisement = (NULL != advertisement) ? cJSON_Duplicate(advertisement, 1) : NULL;
+
+    /* Hello message must be serialized again, with the advertisement */
+    discover->hello.dirty  = true;
+    discover->hello.rounds = 0;
+
+    /* Release options semaphore */
+    sem_post(&discover->options.sem);
+
+    /* Send the new advertisement soon */
+    discover_request_hellos(discover);
+
+    return 0;
+}
+
+/**
+ * @brief Promote the instance to master
+ * @param discover Discover instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+discover_promote(discover_t *discover) {
+
+    assert(NULL != discover);
+
+    discover->is_master          = true;
+    discover->is_master_eligible = true;
+
+    /* Send the new state soon */
+    discover_request_hellos(discover);
+
+    return 0;
+}
+
+/**
+ * @brief Demote the instance from being a master
+ * @param discover Discover instance
+ * @param permanent true to specify that this should not automatically become master again, false otherwise
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+discover_demote(discover_t *discover, bool permanent) {
+
+    assert(NULL != discover);
+
+    discover->is_master          = false;
+    discover->is_master_eligible = !permanent;
+
+    /* Send the new state soon */
+    discover_request_hellos(discover);
+
+    return 0;
+}
+
+/**
+ * @brief Subscribe to wanted event
+ * @param discover Discover instance
+ * @param event Event
+ * @param fct Callback funtion
+ * @param user User data
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+discover_join(discover_t *discover, char *event, void *fct, void *user) {
+
+    assert(NULL != discover);
+    assert(NULL != event);
+
+    int                 ret          = 0;
+    bool                changed      = false;
+    discover_channel_t *last_channel = NULL;
+
+    /* Check the event, the reserved events are handled by the library */
+    if (true == discover_is_reserved(event)) {
+        return -1;
+    }
+
+    /* Wait semaphore */
+    sem_wait(&discover->channels.sem);
+
+    /* Parse channels, update callback and user data if event is found */
+    discover_channel_t *curr_channel = discover->channels.first;
+    while (NULL != curr_channel) {
+        if (!strcmp(event, curr_channel->event)) {
+            curr_channel->fct  = fct;
+            curr_channel->user = user;
+            goto LEAVE;
+        }
+        last_channel = curr_channel;
+        curr_channel = curr_channel->next;
+    }
+
+    /* Channel not found, add a new one */
+    discover_channel_t *new_channel = (discover_channel_t *)malloc(sizeof(discover_channel_t));
+    if (NULL == new_channel) {
+        /* Unable to allocate memory */
+        ret = -1;
+        goto LEAVE;
+    }
+    memset(new_channel, 0, sizeof(discover_channel_t));
+    new_channel->event = strdup(event);
+    if (NULL == new_channel->event) {
+        /* Unable to allocate memory */
+        free(new_channel);
+        ret = -1;
+        goto LEAVE;
+    }
+
+    /* Compile the regular expression once, unless the event is a literal string */
+    new_channel->literal = (NULL == strpbrk(event, ".[]()*+?{}|^$\\")) ? true : false;
+    if ((false == new_channel->literal) && (0 != regcomp(&new_channel->regex, event, REG_NOSUB | REG_EXTENDED))) {
+        /* Invalid regular expression */
+        free(new_channel->event);
+        free(new_channel);
+        ret = -1;
+        goto LEAVE;
+    }
+    new_channel->fct  = fct;
+    new_channel->user = user;
+    if (NULL != last_channel) {
+        last_channel->next = new_channel;
+    } else {
+        discover->channels.first = new_channel;
+    }
+
+    /* Advertise the new channel */
+    changed = discover_update_channels(discover);
+
+LEAVE:
+
+    /* Release semaphore */
+    sem_post(&discover->channels.sem);
+
+    /* Send the channels joined soon if they are advertised */
+    if (true == changed) {
+        discover_request_hellos(discover);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Leave channel
+ * @param discover Discover instance
+ * @param event Event
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+discover_leave(discover_t *discover, char *event) {
+
+    assert(NULL != discover);
+    assert(NULL != event);
+
+    bool                changed      = false;
+    discover_channel_t *last_channel = NULL;
+
+    /* Wait semaphore */
+    sem_wait(&discover->channels.sem);
+
+    /* Parse channels, remove channel if event is found */
+    discover_channel_t *curr_channel = discover->channels.first;
+    while (NULL != curr_channel) {
+        if (!strcmp(event, curr_channel->event)) {
+            if (discover->channels.first == curr_channel) {
+                discover->channels.first = curr_channel->next;
+            } else {
+                last_channel->next = curr_channel->next;
+            }
+            if (false == curr_channel->literal) {
+                regfree(&curr_channel->regex);
+            }
+            free(curr_channel->event);
+            free(curr_channel);
+            changed = discover_update_channels(discover);
+            goto LEAVE;
+        }
+        last_channel = curr_channel;
+        curr_channel = curr_channel->next;
+    }
+
+LEAVE:
+
+    /* Release semaphore */
+    sem_post(&discover->channels.sem);
+
+    /* Send the channels joined soon if they are advertised */
+    if (true == changed) {
+        discover_request_hellos(discover);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Function used to send event data
+ * @param discover Discover instance
+ * @param event Event
+ * @param data Data to send
+ * @return 0 if the function succeeded, -1 otherwise (the send queue is full when sending faster than the network)
+ */
+int
+discover_send(discover_t *discover, char *event, cJSON *data) {
+
+    assert(NULL != discover);
+    assert(NULL != event);
+    assert(NULL != data);
+
+    /* Check the event, the reserved events are sent by the library */
+    if (true == discover_is_reserved(event)) {
+        return -1;
+    }
+
+    /* Wait options semaphore */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+
+    /* Serialize message, only the event and the data are serialized if the message is batched */
+    bool     batched = (NULL != discover->batch.buffer) ? true : false;
+    int      delay   = discover->options.batch_delay;
+    bool     unicast = (NULL != discover->unicast.addresses) ? true : false;
+    uint16_t port    = discover->options.port;
+    char *   str     = (true == batched) ? discover_serialize_batched(event, data) : discover_serialize_message(discover, event, data);
+
+    /* Release options semaphore */
+    sem_post(&discover->options.sem);
+
+    /* Check if the message has been serialized */
+    if (NULL == str) {
+        return -1;
+    }
+
+    /* Add the message to the batch pending */
+    if (true == batched) {
+        return discover_batch_message(discover, str, delay);
+    }
+
+    /* Send to the unicast addresses of the nodes which may have joined the channel, the string is released once sent */
+    if (true == unicast) {
+        return discover_transmit_unicast(discover, event, port, str, strlen(str));
+    }
+
+    /* Send, the string is released once sent */
+    return discover_transmit(discover, str, strlen(str));
+}
+
+/**
+ * @brief Function used to send event data to a single node, using the address and port learned from its hello messages
+ * @param discover Discover instance
+ * @param node Node to which the message is sent
+ * @param event Event
+ * @param data Data to send
+ * @return 0 if the function succeeded, or if the node has not joined the channel and the acknowledgement is not requested, -1 otherwise
+ */
+int
+discover_send_to(discover_t *discover, discover_node_t *node, char *event, cJSON *data) {
+
+    assert(NULL != discover);
+    assert(NULL != node);
+    assert(NULL != event);
+    assert(NULL != data);
+
+    /* Check the event, the reserved events are sent by the library */
+    if (true == discover_is_reserved(event)) {
+        return -1;
+    }
+
+    /* Wait options semaphore */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+    int timeout = discover->options.ack_timeout;
+    int retries = discover->options.ack_retries;
+
+    /* Skip the node if it has not joined the channel of the message, unless the acknowledgement is requested so that the node reports it */
+    if ((0 == timeout) && (true == node->data.filtered) && (false == discover_match_channels(node->data.channels, event))) {
+        sem_post(&discover->options.sem);
+        __atomic_add_fetch(&discover->stats.tx_filtered, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    /* Start the thread retransmitting the directed messages if the acknowledgement has been requested after starting */
+    if ((0 < timeout) && (true == discover->options.threaded) && (false == discover->sender.running) && (0 != discover_start_send(discover))) {
+        /* Unable to start task */
+        sem_post(&discover->options.sem);
+        return -1;
+    }
+
+    /* Serialize message, a sequence number is added if the acknowledgement is requested, 0 is never used */
+    uint32_t sequence = 0;
+    while ((0 < timeout) && (0 == sequence)) {
+        sequence = __atomic_add_fetch(&discover->directed.sequence, 1, __ATOMIC_RELAXED);
+    }
+    char *str = discover_serialize_directed(discover, event, data, node->pid, node->iid, sequence);
+
+    /* Release options semaphore */
+    sem_post(&discover->options.sem);
+
+    /* Check if the message has been serialized */
+    if (NULL == str) {
+        return -1;
+    }
+    size_t size = strlen(str);
+
+    /* Keep a copy of the message until it is acknowledged, it is retransmitted if the acknowledgement is not received in time */
+    if (0 != sequence) {
+        discover_directed_t *directed = (discover_directed_t *)malloc(sizeof(discover_directed_t));
+        if (NULL == directed) {
+            /* Unable to allocate memory */
+            free(str);
+            return -1;
+        }
+        memset(directed, 0, sizeof(discover_directed_t));
+        if (NULL == (directed->buffer = (char *)malloc(size))) {
+            /* Unable to allocate memory */
+            free(directed);
+            free(str);
+            return -1;
+        }
+        memcpy(directed->buffer, str, size);
+        directed->size     = size;
+        directed->sequence = sequence;
+        directed->port     = node->port;
+        directed->retries  = retries;
+        directed->timeout  = timeout;
+        directed->deadline = discover_get_time() + timeout;
+        strcpy(directed->pid, node->pid);
+        strcpy(directed->iid, node->iid);
+        strcpy(directed->address, node->address);
+        sem_wait(&discover->directed.sem);
+        directed->next           = discover->directed.first;
+        discover->directed.first = directed;
+        sem_post(&discover->directed.sem);
+        if (true == __atomic_load_n(&discover->sender.running, __ATOMIC_ACQUIRE)) {
+            sem_post(&discover->sender.wakeup);
+        }
+    }
+
+    /* Send, the string is released once sent */
+    if (0 != discover_transmit_to(discover, node->address, node->port, str, size)) {
+        if (0 != sequence) {
+            discover_remove_directed(discover, sequence, node->pid, node->iid);
+        }
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Find a node using its Process and Instance UUIDs
+ * @param discover Discover instance
+ * @param pid Process UUID of the node
+ * @param iid Instance UUID of the node
+ * @return Copy of the node if it is found, NULL otherwise, the copy must be released using discover_node_release
+ */
+discover_node_t *
+discover_find_node(discover_t *discover, char *pid, char *iid) {
+
+    assert(NULL != discover);
+    assert(NULL != pid);
+    assert(NULL != iid);
+
+    /* Wait semaphore */
+    discover_lock(&discover->nodes.sem, &discover->stats.nodes_lock);
+
+    /* Search node in the index */
+    discover_node_t *node = discover_lookup_node(discover, pid, iid);
+    if (NULL == node) {
+        /* Node not found */
+        sem_post(&discover->nodes.sem);
+        return NULL;
+    }
+
+    /* Copy the node, the original one may be removed as soon as the semaphore is released */
+    discover_node_t *copy = discover_duplicate_node(node);
+
+    /* Release semaphore */
+    sem_post(&discover->nodes.sem);
+
+    return copy;
+}
+
+/**
+ * @brief Release a node returned by discover_find_node
+ * @param node Node
+ */
+void
+discover_node_release(discover_node_t *node) {
+
+    /* Release node */
+    if (NULL != node) {
+        discover_clear_node(node);
+        free(node);
+    }
+}
+
+/**
+ * @brief Retrieve a snapshot of the nodes, the same snapshot is shared by the readers as long as the nodes don't change
+ * @param discover Discover instance
+ * @return Snapshot if the function succeeded, NULL otherwise, the snapshot must be released using discover_nodes_release
+ */
+discover_nodes_snapshot_t *
+discover_nodes_snapshot(discover_t *discover) {
+
+    assert(NULL != discover);
+
+    /* Return the latest snapshot if the nodes have not changed since it has been taken, the nodes semaphore is not needed */
+    sem_wait(&discover->snapshot.sem);
+    discover_nodes_snapshot_t *snapshot = discover->snapshot.current;
+    if ((NULL != snapshot) && (snapshot->version == __atomic_load_n(&discover->nodes.version, __ATOMIC_ACQUIRE))) {
+        __atomic_add_fetch(&snapshot->refs, 1, __ATOMIC_RELAXED);
+        sem_post(&discover->snapshot.sem);
+        return snapshot;
+    }
+    sem_post(&discover->snapshot.sem);
+
+    /* Wait semaphore */
+    discover_lock(&discover->nodes.sem, &discover->stats.nodes_lock);
+
+    /* Create a new snapshot and copy the nodes */
+    if (NULL == (snapshot = discover_create_snapshot(discover->nodes.count))) {
+        /* Unable to allocate memory */
+        sem_post(&discover->nodes.sem);
+        return NULL;
+    }
+    for (discover_node_t *node = discover->nodes.first; NULL != node; node = node->next) {
+        discover_append_snapshot(snapshot, node);
+    }
+    snapshot->version = discover->nodes.version;
+
+    /* Release semaphore */
+    sem_post(&discover->nodes.sem);
+
+    /* Publish the new snapshot, it is referenced by the instance and by the caller */
+    snapshot->refs = 2;
+    sem_wait(&discover->snapshot.sem);
+    discover_nodes_snapshot_t *previous = discover->snapshot.current;
+    discover->snapshot.current          = snapshot;
+    sem_post(&discover->snapshot.sem);
+    if (NULL != previous) {
+        discover_unref_snapshot(previous);
+    }
+
+    return snapshot;
+}
+
+/**
+ * @brief Release a snapshot returned by discover_nodes_snapshot
+ * @param snapshot Snapshot
+ */
+void
+discover_nodes_release(discover_nodes_snapshot_t *snapshot) {
+
+    /* Release snapshot */
+    if (NULL != snapshot) {
+        discover_unref_snapshot(snapshot);
+    }
+}
+
+/**
+ * @brief Retrieve the number of nodes
+ * @param discover Discover instance
+ * @return Number of nodes
+ */
+size_t
+discover_nodes_count(discover_t *discover) {
+
+    assert(NULL != discover);
+
+    /* The counter is read without locking */
+    return __atomic_load_n(&discover->nodes.count, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Retrieve the master nodes, ordered by decreasing weight
+ * @param discover Discover instance
+ * @return Snapshot of the master nodes if the function succeeded, NULL otherwise, the snapshot must be released using discover_nodes_release
+ */
+discover_nodes_snapshot_t *
+discover_get_masters(discover_t *discover) {
+
+    assert(NULL != discover);
+
+    /* Wait semaphore */
+    discover_lock(&discover->nodes.sem, &discover->stats.nodes_lock);
+
+    /* Copy the master nodes from their index */
+    discover_nodes_snapshot_t *snapshot = discover_create_snapshot(discover->nodes.master_count);
+    if (NULL != snapshot) {
+        for (discover_node_t *node = discover->nodes.master_first; NULL != node; node = DISCOVER_RECORD(node)->mnext) {
+            discover_append_snapshot(snapshot, node);
+        }
+        snapshot->version = discover->nodes.version;
+    }
+
+    /* Release semaphore */
+    sem_post(&discover->nodes.sem);
+
+    return snapshot;
+}
+
+/**
+ * @brief Retrieve the master eligible nodes with the highest weights, ordered by decreasing weight
+ * @param discover Discover instance
+ * @param max Maximum number of nodes, 0 to retrieve all the master eligible nodes
+ * @return Snapshot of the master eligible nodes if the function succeeded, NULL otherwise, the snapshot must be released using discover_nodes_release
+ */
+discover_nodes_snapshot_t *
+discover_get_eligibles(discover_t *discover, size_t max) {
+
+    assert(NULL != discover);
+
+    /* Wait semaphore */
+    discover_lock(&discover->nodes.sem, &discover->stats.nodes_lock);
+
+    /* Copy the first master eligible nodes from their index */
+    size_t count = discover->nodes.eligible_count;
+    if ((0 < max) && (max < count)) {
+        count = max;
+    }
+    discover_nodes_snapshot_t *snapshot = discover_create_snapshot(count);
+    if (NULL != snapshot) {
+        for (discover_node_t *node = discover->nodes.eligible_first; (NULL != node) && (snapshot->count < count); node = DISCOVER_RECORD(node)->enext) {
+            discover_append_snapshot(snapshot, node);
+        }
+        snapshot->version = discover->nodes.version;
+    }
+
+    /* Release semaphore */
+    sem_post(&discover->nodes.sem);
+
+    return snapshot;
+}
+
+/**
+ * @brief Retrieve the nodes with a field of their advertisement matching a value
+ * @param discover Discover instance
+ * @param field Name of the member of the advertisement object
+ * @param value Value of the member, NULL to retrieve the nodes with the member whatever its value
+ * @return Snapshot of the nodes matching if the function succeeded, NULL otherwise, the snapshot must be released using discover_nodes_release
+ */
+discover_nodes_snapshot_t *
+discover_filter_nodes(discover_t *discover, char *field, cJSON *value) {
+
+    assert(NULL != discover);
+    assert(NULL != field);
+
+    /* Wait semaphore */
+    discover_lock(&discover->nodes.sem, &discover->stats.nodes_lock);
+
+    /* Copy the nodes matching, the other ones are not copied */
+    discover_nodes_snapshot_t *snapshot = discover_create_snapshot(discover->nodes.count);
+    if (NULL != snapshot) {
+        for (discover_node_t *node = discover->nodes.first; NULL != node; node = node->next) {
+            cJSON *item = (NULL != node->data.advertisement) ? cJSON_GetObjectItemCaseSensitive(node->data.advertisement, field) : NULL;
+            if ((NULL != item) && ((NULL == value) || (cJSON_Compare(item, value, true)))) {
+                discover_append_snapshot(snapshot, node);
+            }
+        }
+        snapshot->version = discover->nodes.version;
+    }
+
+    /* Release semaphore */
+    sem_post(&discover->nodes.sem);
+
+    return snapshot;
+}
+
+/**
+ * @brief Invoke the callbacks of the events pending, when the callbacks are not invoked by a dedicated thread
+ * @param discover Discover instance
+ * @return Number of events handled if the function succeeded, -1 if the pollEvents option is not set
+ */
+int
+discover_poll_events(discover_t *discover) {
+
+    assert(NULL != discover);
+
+    /* Check the options, the events are also polled when no thread is created */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+    bool poll_events = ((true == discover->options.poll_events) || (false == discover->options.threaded)) ? true : false;
+    sem_post(&discover->options.sem);
+    if (false == poll_events) {
+        /* Events are handled by the dispatch thread */
+        return -1;
+    }
+
+    /* Invoke the callbacks */
+    return discover_dispatch_events(discover);
+}
+
+/**
+ * @brief Retrieve the sockets the application must watch for input when no thread is created
+ * @param discover Discover instance
+ * @param fds Sockets
+ * @param max Maximum number of sockets
+ * @return Number of sockets if the function succeeded, -1 if the threaded option is set
+ */
+int
+discover_get_fds(discover_t *discover, int *fds, int max) {
+
+    assert(NULL != discover);
+    assert((NULL != fds) || (0 == max));
+
+    /* Check the option */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+    bool threaded = discover->options.threaded;
+    sem_post(&discover->options.sem);
+    if (true == threaded) {
+        /* The sockets are watched by the threads */
+        return -1;
+    }
+
+    /* Retrieve the sockets */
+    return sock_get_fds(discover->sock, fds, max);
+}
+
+/**
+ * @brief Receive the messages pending, send the hello message and check the nodes when they are due, and invoke the callbacks, when no thread is created
+ * @param discover Discover instance
+ * @param now_ms Current time, monotonic clock in milliseconds
+ * @return 0 if the function succeeded, -1 otherwise or if the threaded option is set
+ */
+int
+discover_process(discover_t *discover, uint64_t now_ms) {
+
+    assert(NULL != discover);
+
+    /* Retrieve options values */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+    bool     threaded       = discover->options.threaded;
+    bool     client         = discover->options.client;
+    int      check_interval = discover->options.check_interval;
+    uint64_t next_hello     = discover->next_hello;
+    bool     batched        = (NULL != discover->batch.buffer) ? true : false;
+    sem_post(&discover->options.sem);
+    if (true == threaded) {
+        /* Everything is handled by the threads */
+        return -1;
+    }
+
+    /* Receive the messages pending */
+    if (0 > sock_process(discover->sock)) {
+        /* Unable to receive the messages */
+        return -1;
+    }
+
+    /* Send the hello message if it is due */
+    if ((false == client) && (next_hello <= now_ms)) {
+        discover_emit_hello(discover);
+        discover_schedule_hello(discover, now_ms);
+    }
+
+    /* Send the batch of messages if it is due */
+    if (true == batched) {
+        discover_check_batch(discover, now_ms);
+    }
+
+    /* Retransmit the directed messages not acknowledged in time */
+    discover_check_directed(discover, now_ms);
+
+    /* Check the nodes if it is due */
+    if (discover->next_check <= now_ms) {
+        discover_check_nodes(discover, now_ms);
+        discover->next_check = now_ms + check_interval;
+    }
+
+    /* Invoke the callbacks */
+    discover_dispatch_events(discover);
+
+    return 0;
+}
+
+/**
+ * @brief Retrieve the time until discover_process must be called again, when no thread is created
+ * @param discover Discover instance
+ * @return Time in milliseconds, 0 if discover_process must be called now, -1 if the threaded option is set
+ */
+int
+discover_next_timeout(discover_t *discover) {
+
+    assert(NULL != discover);
+
+    /* Retrieve options values */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+    bool     threaded   = discover->options.threaded;
+    bool     client     = discover->options.client;
+    uint64_t next_hello = discover->next_hello;
+    sem_post(&discover->options.sem);
+    if (true == threaded) {
+        /* Everything is handled by the threads */
+        return -1;
+    }
+
+    /* Events are pending */
+    sem_wait(&discover->events.sem);
+    int count = discover->events.count;
+    sem_post(&discover->events.sem);
+    if (0 < count) {
+        return 0;
+    }
+
+    /* Compute the time until the next hello message, batch of messages, retransmission or check */
+    uint64_t next = discover->next_check;
+    if ((false == client) && (next_hello < next)) {
+        next = next_hello;
+    }
+    sem_wait(&discover->batch.sem);
+    if ((0 < discover->batch.count) && (discover->batch.deadline < next)) {
+        next = discover->batch.deadline;
+    }
+    sem_post(&discover->batch.sem);
+    sem_wait(&discover->directed.sem);
+    for (discover_directed_t *directed = discover->directed.first; NULL != directed; directed = directed->next) {
+        if (directed->deadline < next) {
+            next = directed->deadline;
+        }
+    }
+    sem_post(&discover->directed.sem);
+    uint64_t now = discover_get_time();
+
+    return (next <= now) ? 0 : (int)(next - now);
+}
+
+/**
+ * @brief Retrieve discover statistics
+ * @param discover Discover instance
+ * @param stats Statistics
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+discover_get_stats(discover_t *discover, discover_stats_t *stats) {
+
+    assert(NULL != discover);
+    assert(NULL != stats);
+
+    /* Retrieve sock statistics */
+    sock_stats_t sock_stats;
+    if (0 != sock_get_stats(discover->sock, &sock_stats)) {
+        /* Unable to retrieve sock statistics */
+        return -1;
+    }
+
+    /* Fill statistics, the counters are read without locking so they may be slightly inconsistent */
+    memset(stats, 0, sizeof(discover_stats_t));
+    stats->rx_packets             = sock_stats.rx_packets;
+    stats->rx_dropped             = sock_stats.rx_dropped;
+    stats->rx_oversized           = sock_stats.rx_oversized;
+    stats->rx_short               = sock_stats.rx_short;
+    stats->rx_invalid             = __atomic_load_n(&discover->stats.rx_invalid, __ATOMIC_RELAXED);
+    stats->tx_packets             = sock_stats.tx_packets;
+    stats->tx_rejected            = sock_stats.tx_rejected;
+    stats->tx_errors              = sock_stats.tx_errors;
+    stats->tx_batched             = __atomic_load_n(&discover->stats.tx_batched, __ATOMIC_RELAXED);
+    stats->tx_retransmitted       = __atomic_load_n(&discover->stats.tx_retransmitted, __ATOMIC_RELAXED);
+    stats->tx_unacknowledged      = __atomic_load_n(&discover->stats.tx_unacknowledged, __ATOMIC_RELAXED);
+    stats->tx_filtered            = __atomic_load_n(&discover->stats.tx_filtered, __ATOMIC_RELAXED);
+    stats->nodes_added            = __atomic_load_n(&discover->stats.nodes_added, __ATOMIC_RELAXED);
+    stats->nodes_removed          = __atomic_load_n(&discover->stats.nodes_removed, __ATOMIC_RELAXED);
+    stats->nodes_count            = __atomic_load_n(&discover->nodes.count, __ATOMIC_RELAXED);
+    stats->events_dispatched      = __atomic_load_n(&discover->stats.events_dispatched, __ATOMIC_RELAXED);
+    stats->events_dropped         = __atomic_load_n(&discover->events.dropped, __ATOMIC_RELAXED);
+    stats->receive_threads        = sock_stats.receive_threads;
+    stats->send_threads           = sock_stats.send_threads;
+    stats->nodes_lock.contended   = __atomic_load_n(&discover->stats.nodes_lock.contended, __ATOMIC_RELAXED);
+    stats->nodes_lock.wait        = __atomic_load_n(&discover->stats.nodes_lock.wait, __ATOMIC_RELAXED);
+    stats->options_lock.contended = __atomic_load_n(&discover->stats.options_lock.contended, __ATOMIC_RELAXED);
+    stats->options_lock.wait      = __atomic_load_n(&discover->stats.options_lock.wait, __ATOMIC_RELAXED);
+    discover_read_histogram(&discover->stats.receive_latency, &stats->receive_latency);
+    discover_read_histogram(&discover->stats.callback_duration, &stats->callback_duration);
+
+    return 0;
+}
+
+/**
+ * @brief Release discover instance
+ * @param discover Discover instance
+ */
+void
+discover_release(discover_t *discover) {
+
+    /* Release discover instance */
+    if (NULL != discover) {
+
+        /* Stop hello thread */
+        if ((true == discover->options.threaded) && (false == discover->options.client)) {
+            __atomic_store_n(&discover->hello.stop, true, __ATOMIC_RELEASE);
+            sem_post(&discover->hello.wakeup);
+            pthread_join(discover->thread_hello, NULL);
+        }
+
+        /* Stop check thread, it is woken up and stops once the current check is done, so that it is never stopped while writing the cache file */
+        if (true == discover->options.threaded) {
+            __atomic_store_n(&discover->check.stop, true, __ATOMIC_RELEASE);
+            sem_post(&discover->check.wakeup);
+            pthread_join(discover->thread_check, NULL);
+        }
+        sem_close(&discover->check.wakeup);
+
+        /* Stop send thread, the messages of the batch pending and the directed messages not acknowledged are dropped */
+        if (true == discover->sender.running) {
+            __atomic_store_n(&discover->sender.stop, true, __ATOMIC_RELEASE);
+            sem_post(&discover->sender.wakeup);
+            pthread_join(discover->thread_send, NULL);
+        }
+
+        /* Release sock instance, once the threads using it are stopped */
+        sock_release(discover->sock);
+
+        /* Write the cache file a last time, once the threads updating the nodes are stopped */
+        discover_save_cache(discover);
+
+        /* Release encryption instance */
+        aead_release(discover->aead);
+
+        /* Stop dispatch thread, once the threads queuing events are stopped, the events pending are dropped */
+        if (true == discover->events.running) {
+            __atomic_store_n(&discover->events.stop, true, __ATOMIC_RELEASE);
+            sem_post(&discover->events.pending);
+            pthread_join(discover->thread_dispatch, NULL);
+        }
+        discover_event_t *event;
+        while (NULL != (event = discover_pop_event(discover))) {
+            discover_node_release(event->node);
+            free(event->stats);
+            free(event);
+        }
+        sem_close(&discover->events.pending);
+        sem_close(&discover->events.sem);
+
+        /* Release batch of messages */
+        if (NULL != discover->batch.header) {
+            free(discover->batch.header);
+        }
+        if (NULL != discover->batch.buffer) {
+            free(discover->batch.buffer);
+        }
+        sem_close(&discover->batch.sem);
+
+        /* Release directed messages */
+        while (NULL != discover->directed.first) {
+            discover_directed_t *tmp = discover->directed.first;
+            discover->directed.first = tmp->next;
+            free(tmp->buffer);
+            free(tmp);
+        }
+        sem_close(&discover->directed.sem);
+        sem_close(&discover->sender.wakeup);
+
+        /* Release unicast addresses */
+        if (NULL != discover->unicast.addresses) {
+            free(discover->unicast.addresses);
+            free(discover->unicast.buffer);
+            free(discover->unicast.filters);
+        }
+
+        /* Release channels */
+        sem_wait(&discover->channels.sem);
+        discover_channel_t *curr_channel = discover->channels.first;
+        while (NULL != curr_channel) {
+            discover_channel_t *tmp = curr_channel;
+            curr_channel            = curr_channel->next;
+            if (false == tmp->literal) {
+                regfree(&tmp->regex);
+            }
+            if (NULL != tmp->event) {
+                free(tmp->event);
+            }
+            free(tmp);
+        }
+        sem_post(&discover->channels.sem);
+        sem_close(&discover->channels.sem);
+
+        /* Release nodes */
+        discover_lock(&discover->nodes.sem, &discover->stats.nodes_lock);
+        discover_node_t *node = discover->nodes.first;
+        while (NULL != node) {
+            discover_clear_node(node);
+            node = node->next;
+        }
+        while (NULL != discover->nodes.slabs) {
+            discover_nodes_slab_t *tmp = discover->nodes.slabs;
+            discover->nodes.slabs      = tmp->next;
+            free(tmp);
+        }
+        if (NULL != discover->nodes.buckets) {
+            free(discover->nodes.buckets);
+        }
+        if (NULL != discover->nodes.heap) {
+            free(discover->nodes.heap);
+        }
+        sem_post(&discover->nodes.sem);
+        sem_close(&discover->nodes.sem);
+
+        /* Release the latest snapshot, the snapshots still used by the application are released by their last reader */
+        sem_wait(&discover->snapshot.sem);
+        if (NULL != discover->snapshot.current) {
+            discover_unref_snapshot(discover->snapshot.current);
+        }
+        sem_post(&discover->snapshot.sem);
+        sem_close(&discover->snapshot.sem);
+
+        /* Release hello message */
+        if (NULL != discover->hello.buffer) {
+            free(discover->hello.buffer);
+        }
+        sem_close(&discover->hello.wakeup);
+
+        /* Release UUIDs */
+        if (NULL != discover->pid) {
+            free(discover->pid);
+        }
+        if (NULL != discover->iid) {
+            free(discover->iid);
+        }
+
+        /* Release options */
+        discover_lock(&discover->options.sem, &discover->stats.options_lock);
+        if (NULL != discover->options.address) {
+            free(discover->options.address);
+        }
+        if (NULL != discover->options.broadcast) {
             free(discover->options.broadcast);
         }
-        discover->options.broadcast = strdup((char *)value);
-        if (NULL != discover->options.broadcast) {
-            ret = 0;
+        if (NULL != discover->options.multicast) {
+            free(discover->options.multicast);
+        }
+        if (NULL != discover->options.interfaces) {
+            free(discover->options.interfaces);
+        }
+        if (NULL != discover->options.unicast) {
+            free(discover->options.unicast);
+        }
+        if (NULL != discover->options.key) {
+            free(discover->options.key);
+        }
+        if (NULL != discover->options.advertisement) {
+            cJSON_Delete(discover->options.advertisement);
+        }
+        if (NULL != discover->options.hostname) {
+            free(discover->options.hostname);
+        }
+        if (NULL != discover->options.cache_file) {
+            free(discover->options.cache_file);
+        }
+        sem_post(&discover->options.sem);
+        sem_close(&discover->options.sem);
+
+        /* Release discover instance */
+        free(discover);
+    }
+}
+
+/**
+ * @brief Start hello thread
+ * @param discover Discover instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+discover_start_hello(discover_t *discover) {
+
+    /* Initialize attributes of the thread */
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+    /* Start thread */
+    if (0 != pthread_create(&discover->thread_hello, &attr, discover_thread_hello, (void *)discover)) {
+        /* Unable to start the thread */
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Thread used to periodically send the hello message
+ * @param arg Discover instance
+ * @return Always returns NULL
+ */
+static void *
+discover_thread_hello(void *arg) {
+
+    assert(NULL != arg);
+
+    /* Retrieve discover */
+    discover_t *discover = (discover_t *)arg;
+
+    /* Loop until the thread is stopped */
+    while (false == __atomic_load_n(&discover->hello.stop, __ATOMIC_ACQUIRE)) {
+
+        /* Retrieve the time of the next hello message */
+        discover_lock(&discover->options.sem, &discover->stats.options_lock);
+        uint64_t next_hello = discover->next_hello;
+        sem_post(&discover->options.sem);
+
+        /* Send the hello message if it is due */
+        uint64_t now = discover_get_time();
+        if (next_hello <= now) {
+            discover_emit_hello(discover);
+            discover_schedule_hello(discover, now);
+            continue;
+        }
+
+        /* Sleep until the next hello message, or until it is due sooner */
+        discover_wait_until(&discover->hello.wakeup, next_hello);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Send the hello message
+ * @param discover Discover instance
+ */
+static void
+discover_emit_hello(discover_t *discover) {
+
+    assert(NULL != discover);
+
+    /* Wait options semaphore */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+
+    /* Omit the advertisement once it has been sent enough times */
+    bool omit = ((0 < discover->options.advertisement_rounds) && (discover->options.advertisement_rounds <= discover->hello.rounds)) ? true : false;
+
+    /* Serialize the hello message again only if the state of the instance has changed */
+    if ((NULL == discover->hello.buffer) || (true == discover->hello.dirty) || (discover->is_master != discover->hello.is_master)
+        || (discover->is_master_eligible != discover->hello.is_master_eligible) || (omit != discover->hello.omitted)) {
+        discover_serialize_hello(discover, omit);
+    }
+    if (INT_MAX > discover->hello.rounds) {
+        discover->hello.rounds++;
+    }
+
+    /* Copy the hello message, the copy is released by the sock instance once sent */
+    char * str  = NULL;
+    size_t size = discover->hello.size;
+    if ((NULL != discover->hello.buffer) && (NULL != (str = (char *)malloc(size)))) {
+        memcpy(str, discover->hello.buffer, size);
+    }
+
+    /* Release options semaphore */
+    sem_post(&discover->options.sem);
+
+    if (NULL != str) {
+
+        /* Send message */
+        discover_transmit(discover, str, size);
+
+        /* Invoke helloEmitted callback if defined */
+        if (NULL != discover->cb.hello_emitted.fct) {
+            discover->cb.hello_emitted.fct(discover, discover->cb.hello_emitted.user);
+        }
+    }
+}
+
+/**
+ * @brief Compute the time of the next hello message, depending of the number of nodes
+ * @param discover Discover instance
+ * @param now Current time, monotonic clock in milliseconds
+ */
+static void
+discover_schedule_hello(discover_t *discover, uint64_t now) {
+
+    assert(NULL != discover);
+
+    /* Retrieve the number of nodes */
+    discover_lock(&discover->nodes.sem, &discover->stats.nodes_lock);
+    size_t count = discover->nodes.count;
+    sem_post(&discover->nodes.sem);
+
+    /* Wait options semaphore */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+
+    /* The interval grows with the number of nodes when the state is stable, so that each node receives about the same number of hello messages */
+    uint64_t interval = (uint64_t)discover->options.hello_interval;
+    if (0 < discover->hello.burst) {
+        discover->hello.burst--;
+    } else if ((0 < discover->options.hello_nodes) && ((size_t)discover->options.hello_nodes < count)) {
+        /* The interval remains short enough for the other nodes to receive several hello messages before they consider the instance dead */
+        uint64_t scaled  = interval * count / discover->options.hello_nodes;
+        uint64_t maximum = (uint64_t)((true == discover->is_master) ? discover->options.master_timeout : discover->options.node_timeout) / 3;
+        if (scaled > maximum) {
+            scaled = maximum;
+        }
+        if (scaled > interval) {
+            interval = scaled;
+        }
+    }
+
+    /* Random variation of the interval, so that the nodes started together don't send their hello messages together */
+    uint64_t range = interval * discover->options.hello_jitter / 100;
+    if (0 < range) {
+        interval = interval - range + (uint64_t)rand_r(&discover->hello.seed) % (2 * range + 1);
+    }
+    discover->next_hello = now + interval;
+
+    /* Release options semaphore */
+    sem_post(&discover->options.sem);
+}
+
+/**
+ * @brief Send the next hello messages sooner, at the hello interval, because the state of the instance has changed
+ * @param discover Discover instance
+ */
+static void
+discover_request_hellos(discover_t *discover) {
+
+    assert(NULL != discover);
+
+    /* Wait options semaphore */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+
+    /* The next hello message is sent within the random variation of the interval, so that the nodes changing together don't send it together */
+    uint64_t range = (uint64_t)discover->options.hello_interval * discover->options.hello_jitter / 100;
+    uint64_t next  = discover_get_time() + ((0 < range) ? (uint64_t)rand_r(&discover->hello.seed) % (range + 1) : 0);
+    bool     wake  = (next < discover->next_hello) ? true : false;
+    if (true == wake) {
+        discover->next_hello = next;
+    }
+    discover->hello.burst = DISCOVER_HELLO_BURST;
+    bool threaded         = discover->options.threaded;
+
+    /* Release options semaphore */
+    sem_post(&discover->options.sem);
+
+    /* Wake up the hello thread so that it sleeps until the new time */
+    if ((true == threaded) && (true == wake)) {
+        sem_post(&discover->hello.wakeup);
+    }
+}
+
+/**
+ * @brief Wait until a time or until the semaphore is posted
+ * @param sem Semaphore
+ * @param time Time, monotonic clock in milliseconds
+ */
+static void
+discover_wait_until(sem_t *sem, uint64_t time) {
+
+    assert(NULL != sem);
+
+    /* Compute the time to wait */
+    uint64_t now = discover_get_time();
+    if (time <= now) {
+        return;
+    }
+    uint64_t delay = time - now;
+
+#if defined(__GLIBC__) && ((2 < __GLIBC__) || ((2 == __GLIBC__) && (30 <= __GLIBC_MINOR__)))
+
+    /* The monotonic clock is not affected by the changes of the system time */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += delay / 1000;
+    ts.tv_nsec += (delay % 1000) * 1000000;
+    if (1000000000 <= ts.tv_nsec) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    sem_clockwait(sem, CLOCK_MONOTONIC, &ts);
+
+#else
+
+    /* The realtime clock is the only one supported */
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += delay / 1000;
+    ts.tv_nsec += (delay % 1000) * 1000000;
+    if (1000000000 <= ts.tv_nsec) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    sem_timedwait(sem, &ts);
+
+#endif
+}
+
+/**
+ * @brief Start check thread
+ * @param discover Discover instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+discover_start_check(discover_t *discover) {
+
+    /* Initialize attributes of the thread */
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+    /* Start thread */
+    if (0 != pthread_create(&discover->thread_check, &attr, discover_thread_check, (void *)discover)) {
+        /* Unable to start the thread */
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Thread used to periodically refresh the presence of other nodes
+ * @param arg Discover instance
+ * @return Always returns NULL
+ */
+static void *
+discover_thread_check(void *arg) {
+
+    assert(NULL != arg);
+
+    /* Retrieve discover */
+    discover_t *discover = (discover_t *)arg;
+
+    /* Loop until the thread is stopped */
+    while (false == __atomic_load_n(&discover->check.stop, __ATOMIC_ACQUIRE)) {
+
+        /* Check the nodes */
+        discover_check_nodes(discover, discover_get_time());
+
+        /* Retrieve check interval value */
+        discover_lock(&discover->options.sem, &discover->stats.options_lock);
+        int check_interval = discover->options.check_interval;
+        sem_post(&discover->options.sem);
+
+        /* Sleep until the next check, or until the thread is stopped */
+        discover_wait_until(&discover->check.wakeup, discover_get_time() + check_interval);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Remove the nodes which are no more alive and elect the masters
+ * @param discover Discover instance
+ * @param now Current time, monotonic clock in milliseconds
+ */
+static void
+discover_check_nodes(discover_t *discover, uint64_t now) {
+
+    assert(NULL != discover);
+
+    /* Retrieve options values */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+    double weight           = discover->options.weight;
+    int    masters_required = discover->options.masters_required;
+    int    stats_interval   = discover->options.stats_interval;
+    sem_post(&discover->options.sem);
+
+    /* Wait semaphore */
+    discover_lock(&discover->nodes.sem, &discover->stats.nodes_lock);
+
+    /* Compute the counters again if my weight has changed */
+    if (weight != discover->nodes.weight) {
+        discover->nodes.weight                  = weight;
+        discover->nodes.masters                 = 0;
+        discover->nodes.masters_higher_weight   = 0;
+        discover->nodes.eligibles_higher_weight = 0;
+        for (discover_node_t *node = discover->nodes.first; NULL != node; node = node->next) {
+            discover_count_node(discover, node, 1);
+        }
+    }
+
+    /* Remove the nodes which are no more alive, the first node of the heap is the next one to expire */
+    while (0 < discover->nodes.count) {
+        discover_node_t *tmp = discover->nodes.heap[0];
+        if (now <= DISCOVER_RECORD(tmp)->deadline) {
+            /* The node is alive, so are all the others */
+            break;
+        }
+        /* Node is no more alive, remove it from the list, the nodes loaded from the cache and never seen are removed silently */
+        discover_remove_node(discover, tmp);
+        __atomic_add_fetch(&discover->nodes.version, 1, __ATOMIC_RELEASE);
+        if (false == tmp->data.stale) {
+            __atomic_add_fetch(&discover->stats.nodes_removed, 1, __ATOMIC_RELAXED);
+        }
+        /* Queue removed event if the callback is defined, the content of the node is moved to a copy owned by the event */
+        if ((false == tmp->data.stale) && (NULL != discover->cb.removed.fct)) {
+            discover_node_t *copy = (discover_node_t *)malloc(sizeof(discover_node_t));
+            if (NULL != copy) {
+                memcpy(copy, tmp, sizeof(discover_node_t));
+                copy->prev              = NULL;
+                copy->next              = NULL;
+                tmp->hostname           = NULL;
+                tmp->data.advertisement = NULL;
+                discover_queue_event(discover, DISCOVER_EVENT_REMOVED, copy, 0);
+            }
+        }
+        discover_free_node(discover, tmp);
+    }
+
+    /* Flags */
+    int  masters_higher_weight_found          = discover->nodes.masters_higher_weight;
+    bool masters_eligible_higher_weight_found = (0 < discover->nodes.eligibles_higher_weight) ? true : false;
+    bool demoted                              = false;
+    bool promoted                             = false;
+
+    /* Check if I need to demote myself */
+    bool was_master = discover->is_master;
+    if ((true == was_master) && (masters_required <= masters_higher_weight_found)) {
+        discover->is_master = false;
+        demoted             = true;
+    }
+
+    /* Check if I need to promote myself */
+    if ((false == was_master) && (true == discover->is_master_eligible) && (masters_required > masters_higher_weight_found)
+        && (false == masters_eligible_higher_weight_found)) {
+        discover->is_master = true;
+        promoted            = true;
+    }
+
+    /* Release semaphore */
+    sem_post(&discover->nodes.sem);
+
+    /* Send the new state soon */
+    if ((true == demoted) || (true == promoted)) {
+        discover_request_hellos(discover);
+    }
+
+    /* Queue demotion event if the callback is defined */
+    if ((true == demoted) && (NULL != discover->cb.demotion.fct)) {
+        discover_queue_event(discover, DISCOVER_EVENT_DEMOTION, NULL, 0);
+    }
+
+    /* Queue promotion event if the callback is defined */
+    if ((true == promoted) && (NULL != discover->cb.promotion.fct)) {
+        discover_queue_event(discover, DISCOVER_EVENT_PROMOTION, NULL, 0);
+    }
+
+    /* Queue check event if the callback is defined */
+    if (NULL != discover->cb.check.fct) {
+        discover_queue_event(discover, DISCOVER_EVENT_CHECK, NULL, 0);
+    }
+
+    /* Queue stats event if the callback is defined and if it is due, the period is rounded to the check interval */
+    if ((0 < stats_interval) && (NULL != discover->cb.stats.fct) && (discover->stats.next <= now)) {
+        discover_queue_stats(discover);
+        discover->stats.next = now + stats_interval;
+    }
+
+    /* Write the cache file if the nodes have changed */
+    discover_save_cache(discover);
+}
+
+/**
+ * @brief Start dispatch thread
+ * @param discover Discover instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+discover_start_dispatch(discover_t *discover) {
+
+    /* Initialize attributes of the thread */
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+    /* Start thread */
+    if (0 != pthread_create(&discover->thread_dispatch, &attr, discover_thread_dispatch, (void *)discover)) {
+        /* Unable to start the thread */
+        pthread_attr_destroy(&attr);
+        return -1;
+    }
+    pthread_attr_destroy(&attr);
+    discover->events.running = true;
+
+    return 0;
+}
+
+/**
+ * @brief Thread used to invoke the callbacks of the events queued
+ * @param arg Discover instance
+ * @return Always returns NULL
+ */
+static void *
+discover_thread_dispatch(void *arg) {
+
+    assert(NULL != arg);
+
+    /* Retrieve discover */
+    discover_t *discover = (discover_t *)arg;
+
+    /* Loop until the thread is stopped */
+    while (1) {
+
+        /* Wait for an event */
+        if (0 != sem_wait(&discover->events.pending)) {
+            /* Interrupted, wait again */
+            continue;
+        }
+
+        /* Check if the thread must be stopped */
+        if (true == __atomic_load_n(&discover->events.stop, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+
+        /* Invoke the callback of the event */
+        discover_event_t *event = discover_pop_event(discover);
+        if (NULL != event) {
+            discover_dispatch_event(discover, event);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Queue an event, its callback is invoked later by the dispatch thread or by discover_poll_events
+ * @param discover Discover instance
+ * @param type Type of the event
+ * @param node Copy of the node, owned by the event, NULL if the event is not related to a node
+ * @param received Time the message causing the event has been received, monotonic clock in microseconds, 0 if not caused by a message
+ */
+static void
+discover_queue_event(discover_t *discover, discover_event_type_t type, discover_node_t *node, uint64_t received) {
+
+    assert(NULL != discover);
+
+    /* Events related to a node are dropped if the node can't be copied */
+    if ((NULL == node) && (DISCOVER_EVENT_PROMOTION > type)) {
+        __atomic_add_fetch(&discover->events.dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    /* Create event */
+    discover_event_t *event = (discover_event_t *)malloc(sizeof(discover_event_t));
+    if (NULL == event) {
+        /* Unable to allocate memory */
+        __atomic_add_fetch(&discover->events.dropped, 1, __ATOMIC_RELAXED);
+        discover_node_release(node);
+        return;
+    }
+    event->next  = NULL;
+    event->type  = type;
+    event->node  = node;
+    event->stats = NULL;
+    event->time  = received;
+
+    /* Add the event to the queue */
+    discover_push_event(discover, event);
+}
+
+/**
+ * @brief Queue a statistics event with a copy of the current statistics, its callback is invoked later by the dispatch thread or by discover_poll_events
+ * @param discover Discover instance
+ */
+static void
+discover_queue_stats(discover_t *discover) {
+
+    assert(NULL != discover);
+
+    /* Create event and copy the statistics */
+    discover_event_t *event = (discover_event_t *)malloc(sizeof(discover_event_t));
+    discover_stats_t *stats = (discover_stats_t *)malloc(sizeof(discover_stats_t));
+    if ((NULL == event) || (NULL == stats) || (0 != discover_get_stats(discover, stats))) {
+        /* Unable to allocate memory */
+        __atomic_add_fetch(&discover->events.dropped, 1, __ATOMIC_RELAXED);
+        free(event);
+        free(stats);
+        return;
+    }
+    event->next  = NULL;
+    event->type  = DISCOVER_EVENT_STATS;
+    event->node  = NULL;
+    event->stats = stats;
+    event->time  = 0;
+
+    /* Add the event to the queue */
+    discover_push_event(discover, event);
+}
+
+/**
+ * @brief Add an event at the end of the queue, it is released if the queue is full
+ * @param discover Discover instance
+ * @param event Event
+ */
+static void
+discover_push_event(discover_t *discover, discover_event_t *event) {
+
+    assert(NULL != discover);
+    assert(NULL != event);
+
+    /* Wait semaphore */
+    sem_wait(&discover->events.sem);
+
+    /* Drop the event if the queue is full */
+    if (discover->events.depth <= discover->events.count) {
+        sem_post(&discover->events.sem);
+        __atomic_add_fetch(&discover->events.dropped, 1, __ATOMIC_RELAXED);
+        discover_node_release(event->node);
+        free(event->stats);
+        free(event);
+        return;
+    }
+
+    /* Add the event at the end of the queue */
+    if (NULL == discover->events.last) {
+        discover->events.first = event;
+    } else {
+        discover->events.last->next = event;
+    }
+    discover->events.last = event;
+    discover->events.count++;
+
+    /* Release semaphore */
+    sem_post(&discover->events.sem);
+
+    /* Signal the pending event */
+    sem_post(&discover->events.pending);
+}
+
+/**
+ * @brief Remove the first event of the queue
+ * @param discover Discover instance
+ * @return Event if the queue is not empty, NULL otherwise
+ */
+static discover_event_t *
+discover_pop_event(discover_t *discover) {
+
+    assert(NULL != discover);
+
+    /* Wait semaphore */
+    sem_wait(&discover->events.sem);
+
+    /* Remove the first event */
+    discover_event_t *event = discover->events.first;
+    if (NULL != event) {
+        discover->events.first = event->next;
+        if (NULL == discover->events.first) {
+            discover->events.last = NULL;
+        }
+        discover->events.count--;
+    }
+
+    /* Release semaphore */
+    sem_post(&discover->events.sem);
+
+    return event;
+}
+
+/**
+ * @brief Invoke the callback of an event and release it
+ * @param discover Discover instance
+ * @param event Event
+ */
+static void
+discover_dispatch_event(discover_t *discover, discover_event_t *event) {
+
+    assert(NULL != discover);
+    assert(NULL != event);
+
+    /* Measure the time from the reception of the message causing the event */
+    uint64_t start = discover_get_time_us();
+    if (0 != event->time) {
+        discover_record_latency(&discover->stats.receive_latency, start - event->time);
+    }
+
+    /* Invoke the callback depending of the event type, if it is still defined */
+    switch (event->type) {
+        case DISCOVER_EVENT_HELLO_RECEIVED:
+            if (NULL != discover->cb.hello_received.fct) {
+                discover->cb.hello_received.fct(discover, event->node, discover->cb.hello_received.user);
+            }
+            break;
+        case DISCOVER_EVENT_ADDED:
+            if (NULL != discover->cb.added.fct) {
+                discover->cb.added.fct(discover, event->node, discover->cb.added.user);
+            }
+            break;
+        case DISCOVER_EVENT_MASTER:
+            if (NULL != discover->cb.master.fct) {
+                discover->cb.master.fct(discover, event->node, discover->cb.master.user);
+            }
+            break;
+        case DISCOVER_EVENT_REMOVED:
+            if (NULL != discover->cb.removed.fct) {
+                discover->cb.removed.fct(discover, event->node, discover->cb.removed.user);
+            }
+            break;
+        case DISCOVER_EVENT_PROMOTION:
+            if (NULL != discover->cb.promotion.fct) {
+                discover->cb.promotion.fct(discover, discover->cb.promotion.user);
+            }
+            break;
+        case DISCOVER_EVENT_DEMOTION:
+            if (NULL != discover->cb.demotion.fct) {
+                discover->cb.demotion.fct(discover, discover->cb.demotion.user);
+            }
+            break;
+        case DISCOVER_EVENT_CHECK:
+            if (NULL != discover->cb.check.fct) {
+                discover->cb.check.fct(discover, discover->cb.check.user);
+            }
+            break;
+        case DISCOVER_EVENT_STATS:
+            if (NULL != discover->cb.stats.fct) {
+                discover->cb.stats.fct(discover, event->stats, discover->cb.stats.user);
+            }
+            break;
+        default:
+            break;
+    }
+
+    /* Measure the time spent in the callback */
+    discover_record_latency(&discover->stats.callback_duration, discover_get_time_us() - start);
+    __atomic_add_fetch(&discover->stats.events_dispatched, 1, __ATOMIC_RELAXED);
+
+    /* Release event */
+    discover_node_release(event->node);
+    free(event->stats);
+    free(event);
+}
+
+/**
+ * @brief Invoke the callbacks of the events already queued
+ * @param discover Discover instance
+ * @return Number of events handled
+ */
+static int
+discover_dispatch_events(discover_t *discover) {
+
+    assert(NULL != discover);
+
+    /* Only handle the events already queued, so that the caller is not blocked if new events are continuously queued */
+    sem_wait(&discover->events.sem);
+    int count = discover->events.count;
+    sem_post(&discover->events.sem);
+
+    /* Invoke the callbacks */
+    int handled = 0;
+    while ((handled < count) && (0 == sem_trywait(&discover->events.pending))) {
+        discover_event_t *event = discover_pop_event(discover);
+        if (NULL == event) {
+            break;
+        }
+        discover_dispatch_event(discover, event);
+        handled++;
+    }
+
+    return handled;
+}
+
+/**
+ * @brief Build the beginning of the batches of messages and allocate the batch, options semaphore must be taken
+ * @param discover Discover instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+discover_prepare_batch(discover_t *discover) {
+
+    assert(NULL != discover);
+
+    /* Serialize a batch with an empty array of messages, the beginning of the batches is the batch without the closing brackets */
+    cJSON *messages = cJSON_CreateArray();
+    if (NULL == messages) {
+        /* Unable to allocate memory */
+        return -1;
+    }
+    char *header = discover_serialize_message(discover, DISCOVER_RESERVED_BATCH, messages);
+    cJSON_Delete(messages);
+    if (NULL == header) {
+        /* Unable to allocate memory */
+        return -1;
+    }
+    size_t length = strlen(header);
+    if ((2 > length) || (0 != strcmp(header + length - 2, "]}"))) {
+        /* Unexpected serialization */
+        free(header);
+        return -1;
+    }
+    length -= 2;
+    header[length] = '\0';
+
+    /* Allocate the batch, the encryption overhead is not counted in its maximum size */
+    size_t capacity = (size_t)discover->options.batch_size;
+    if ((NULL != discover->aead) && (AEAD_OVERHEAD < capacity)) {
+        capacity -= AEAD_OVERHEAD;
+    }
+    char *buffer = (char *)malloc(capacity);
+    if (NULL == buffer) {
+        /* Unable to allocate memory */
+        free(header);
+        return -1;
+    }
+
+    /* Store the batch */
+    sem_wait(&discover->batch.sem);
+    discover->batch.header   = header;
+    discover->batch.length   = length;
+    discover->batch.buffer   = buffer;
+    discover->batch.capacity = capacity;
+    sem_post(&discover->batch.sem);
+
+    return 0;
+}
+
+/**
+ * @brief Start send thread
+ * @param discover Discover instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+discover_start_send(discover_t *discover) {
+
+    /* Initialize attributes of the thread */
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+    /* Start thread */
+    if (0 != pthread_create(&discover->thread_send, &attr, discover_thread_send, (void *)discover)) {
+        /* Unable to start the thread */
+        return -1;
+    }
+    __atomic_store_n(&discover->sender.running, true, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+/**
+ * @brief Thread used to send the batches of messages and to retransmit the directed messages when they are due
+ * @param arg Discover instance
+ * @return Always returns NULL
+ */
+static void *
+discover_thread_send(void *arg) {
+
+    assert(NULL != arg);
+
+    /* Retrieve discover */
+    discover_t *discover = (discover_t *)arg;
+
+    /* Loop until the thread is stopped */
+    while (false == __atomic_load_n(&discover->sender.stop, __ATOMIC_ACQUIRE)) {
+
+        /* Send the batch pending and retransmit the directed messages if they are due */
+        uint64_t now        = discover_get_time();
+        uint64_t deadline   = discover_check_batch(discover, now);
+        uint64_t retransmit = discover_check_directed(discover, now);
+        if ((0 != retransmit) && ((0 == deadline) || (retransmit < deadline))) {
+            deadline = retransmit;
+        }
+
+        /* Sleep until the next one is due, or until a batch is started or a directed message is sent if none is pending */
+        if (0 == deadline) {
+            sem_wait(&discover->sender.wakeup);
+        } else {
+            discover_wait_until(&discover->sender.wakeup, deadline);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Add a message to the batch pending, the batch is sent first if the message doesn't fit in it
+ * @param discover Discover instance
+ * @param str Message serialized without its envelope, released by the function
+ * @param delay Maximum time the message waits in the batch in milliseconds
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+discover_batch_message(discover_t *discover, char *str, int delay) {
+
+    assert(NULL != discover);
+    assert(NULL != str);
+
+    int    ret    = 0;
+    bool   wake   = false;
+    size_t length = strlen(str);
+
+    /* Wait batch semaphore */
+    sem_wait(&discover->batch.sem);
+
+    /* Send the batch pending if the message doesn't fit in it, the beginning, the separator and the end of the batch are counted */
+    if ((0 < discover->batch.count) && (discover->batch.length + discover->batch.size + 1 + length + 2 > discover->batch.capacity)) {
+        ret = discover_transmit_batch(discover, discover->batch.buffer, discover->batch.size, discover->batch.count);
+        discover->batch.size  = 0;
+        discover->batch.count = 0;
+    }
+
+    /* Add the message to the batch, a message too large is sent alone in its own batch after the batch pending so that the order is kept */
+    if (discover->batch.length + length + 2 > discover->batch.capacity) {
+        if (0 != discover_transmit_batch(discover, str, length, 1)) {
+            ret = -1;
+        }
+    } else {
+        if (0 < discover->batch.count) {
+            discover->batch.buffer[discover->batch.size++] = ',';
+        }
+        memcpy(discover->batch.buffer + discover->batch.size, str, length);
+        discover->batch.size += length;
+        if (1 == ++discover->batch.count) {
+            discover->batch.deadline = discover_get_time() + delay;
+            wake                     = __atomic_load_n(&discover->sender.running, __ATOMIC_ACQUIRE);
+        }
+    }
+
+    /* Release batch semaphore */
+    sem_post(&discover->batch.sem);
+
+    /* Wake up the send thread so that it sleeps until the batch is due */
+    if (true == wake) {
+        sem_post(&discover->sender.wakeup);
+    }
+
+    /* Release memory */
+    free(str);
+
+    return ret;
+}
+
+/**
+ * @brief Send the batch pending if it is due
+ * @param discover Discover instance
+ * @param now Current time, monotonic clock in milliseconds
+ * @return Time the batch pending must be sent if it is not due, 0 if no batch is pending
+ */
+static uint64_t
+discover_check_batch(discover_t *discover, uint64_t now) {
+
+    assert(NULL != discover);
+
+    uint64_t deadline = 0;
+
+    /* Wait batch semaphore */
+    sem_wait(&discover->batch.sem);
+
+    /* Send the batch pending if it is due */
+    if (0 < discover->batch.count) {
+        if (discover->batch.deadline <= now) {
+            discover_transmit_batch(discover, discover->batch.buffer, discover->batch.size, discover->batch.count);
+            discover->batch.size  = 0;
+            discover->batch.count = 0;
+        } else {
+            deadline = discover->batch.deadline;
+        }
+    }
+
+    /* Release batch semaphore */
+    sem_post(&discover->batch.sem);
+
+    return deadline;
+}
+
+/**
+ * @brief Send a batch of messages, batch semaphore must be taken
+ * @param discover Discover instance
+ * @param messages Messages serialized without their envelope, separated by commas
+ * @param size Size of the messages
+ * @param count Number of messages
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+discover_transmit_batch(discover_t *discover, char *messages, size_t size, int count) {
+
+    assert(NULL != discover);
+    assert(NULL != messages);
+
+    /* Build the batch, the messages follow the envelope and close the array */
+    size_t total = discover->batch.length + size + 2;
+    char * str   = (char *)malloc(total + 1);
+    if (NULL == str) {
+        /* Unable to allocate memory */
+        return -1;
+    }
+    memcpy(str, discover->batch.header, discover->batch.length);
+    memcpy(str + discover->batch.length, messages, size);
+    memcpy(str + discover->batch.length + size, "]}", 3);
+
+    /* Send, the string is released once sent */
+    if (0 != discover_transmit(discover, str, total)) {
+        return -1;
+    }
+    __atomic_add_fetch(&discover->stats.tx_batched, count, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+/**
+ * @brief Retransmit the directed messages not acknowledged in time, the ones without retransmissions remaining are reported and removed
+ * @param discover Discover instance
+ * @param now Current time, monotonic clock in milliseconds
+ * @return Time of the next retransmission, 0 if no directed message is waiting for its acknowledgement
+ */
+static uint64_t
+discover_check_directed(discover_t *discover, uint64_t now) {
+
+    assert(NULL != discover);
+
+    discover_directed_t *lost     = NULL;
+    uint64_t             deadline = 0;
+
+    /* Wait directed messages semaphore */
+    sem_wait(&discover->directed.sem);
+
+    /* Parse all directed messages waiting for their acknowledgement */
+    discover_directed_t **curr = &discover->directed.first;
+    while (NULL != *curr) {
+        discover_directed_t *directed = *curr;
+        if (directed->deadline <= now) {
+            if (0 >= directed->retries) {
+                /* No retransmission remaining, the message is reported once the semaphore is released */
+                *curr          = directed->next;
+                directed->next = lost;
+                lost           = directed;
+                continue;
+            }
+            /* Retransmit a copy of the message, the buffer sent is released once sent */
+            char *copy = (char *)malloc(directed->size);
+            if (NULL != copy) {
+                memcpy(copy, directed->buffer, directed->size);
+                discover_transmit_to(discover, directed->address, directed->port, copy, directed->size);
+            }
+            __atomic_add_fetch(&discover->stats.tx_retransmitted, 1, __ATOMIC_RELAXED);
+            directed->retries--;
+            directed->deadline = now + directed->timeout;
+        }
+        if ((0 == deadline) || (directed->deadline < deadline)) {
+            deadline = directed->deadline;
+        }
+        curr = &directed->next;
+    }
+
+    /* Release directed messages semaphore */
+    sem_post(&discover->directed.sem);
+
+    /* Report the messages never acknowledged */
+    while (NULL != lost) {
+        discover_directed_t *tmp = lost;
+        lost                     = lost->next;
+        __atomic_add_fetch(&discover->stats.tx_unacknowledged, 1, __ATOMIC_RELAXED);
+        if (NULL != discover->cb.error.fct) {
+            discover->cb.error.fct(discover, "discover: directed message not acknowledged", discover->cb.error.user);
+        }
+        free(tmp->buffer);
+        free(tmp);
+    }
+
+    return deadline;
+}
+
+/**
+ * @brief Remove a directed message waiting for its acknowledgement
+ * @param discover Discover instance
+ * @param sequence Sequence number of the message
+ * @param pid Process UUID of the destination of the message
+ * @param iid Instance UUID of the destination of the message
+ * @return 0 if the function succeeded, -1 if the message is not found
+ */
+static int
+discover_remove_directed(discover_t *discover, uint32_t sequence, char *pid, char *iid) {
+
+    assert(NULL != discover);
+    assert(NULL != pid);
+    assert(NULL != iid);
+
+    discover_directed_t *found = NULL;
+
+    /* Wait directed messages semaphore */
+    sem_wait(&discover->directed.sem);
+
+    /* Search and unlink the message, the destination is checked so that a node can't acknowledge the messages sent to the other nodes */
+    discover_directed_t **curr = &discover->directed.first;
+    while (NULL != *curr) {
+        if ((sequence == (*curr)->sequence) && (!strcmp(pid, (*curr)->pid)) && (!strcmp(iid, (*curr)->iid))) {
+            found = *curr;
+            *curr = found->next;
+            break;
+        }
+        curr = &(*curr)->next;
+    }
+
+    /* Release directed messages semaphore */
+    sem_post(&discover->directed.sem);
+
+    /* Check if the message has been found */
+    if (NULL == found) {
+        return -1;
+    }
+
+    /* Release memory */
+    free(found->buffer);
+    free(found);
+
+    return 0;
+}
+
+/**
+ * @brief Serialize a message, options semaphore must be taken
+ * @param discover Discover instance
+ * @param event Event name
+ * @param data Data of the message
+ * @return Message serialized if the function succeeded, NULL otherwise
+ */
+static char *
+discover_serialize_message(discover_t *discover, char *event, cJSON *data) {
+
+    /* Create message */
+    cJSON *msg = cJSON_CreateObject();
+    if (NULL == msg) {
+        /* Unable to allocate memory */
+        return NULL;
+    }
+
+    /* Add fields to the message, data is added as a reference to avoid duplicating it */
+    cJSON_AddStringToObject(msg, "event", event);
+    cJSON_AddStringToObject(msg, "pid", discover->pid);
+    cJSON_AddStringToObject(msg, "iid", discover->iid);
+    cJSON_AddStringToObject(msg, "hostName", discover->options.hostname);
+    cJSON_AddItemReferenceToObject(msg, "data", data);
+
+    /* Print to string */
+    char *str = cJSON_PrintUnformatted(msg);
+
+    /* Release memory */
+    cJSON_Delete(msg);
+
+    return str;
+}
+
+/**
+ * @brief Serialize a message without its envelope, to be sent in a batch
+ * @param event Event name
+ * @param data Data of the message
+ * @return Message serialized if the function succeeded, NULL otherwise
+ */
+static char *
+discover_serialize_batched(char *event, cJSON *data) {
+
+    /* Create message */
+    cJSON *msg = cJSON_CreateObject();
+    if (NULL == msg) {
+        /* Unable to allocate memory */
+        return NULL;
+    }
+
+    /* Add fields to the message, data is added as a reference to avoid duplicating it */
+    cJSON_AddStringToObject(msg, "event", event);
+    cJSON_AddItemReferenceToObject(msg, "data", data);
+
+    /* Print to string */
+    char *str = cJSON_PrintUnformatted(msg);
+
+    /* Release memory */
+    cJSON_Delete(msg);
+
+    return str;
+}
+
+/**
+ * @brief Serialize a message directed to a single node, options semaphore must be taken
+ * @param discover Discover instance
+ * @param event Event name
+ * @param data Data of the message
+ * @param pid Process UUID of the destination
+ * @param iid Instance UUID of the destination
+ * @param sequence Sequence number of the message, 0 if no acknowledgement is requested
+ * @return Message serialized if the function succeeded, NULL otherwise
+ */
+static char *
+discover_serialize_directed(discover_t *discover, char *event, cJSON *data, char *pid, char *iid, uint32_t sequence) {
+
+    /* Create message */
+    cJSON *msg = cJSON_CreateObject();
+    if (NULL == msg) {
+        /* Unable to allocate memory */
+        return NULL;
+    }
+
+    /* Add fields to the message, data is added as a reference to avoid duplicating it */
+    cJSON_AddStringToObject(msg, "event", event);
+    cJSON_AddStringToObject(msg, "pid", discover->pid);
+    cJSON_AddStringToObject(msg, "iid", discover->iid);
+    cJSON_AddStringToObject(msg, "hostName", discover->options.hostname);
+    cJSON_AddItemReferenceToObject(msg, "data", data);
+
+    /* Add the destination, other instances sharing the port of the destination drop the message */
+    cJSON *to = cJSON_AddObjectToObject(msg, "to");
+    if (NULL == to) {
+        /* Unable to allocate memory */
+        cJSON_Delete(msg);
+        return NULL;
+    }
+    cJSON_AddStringToObject(to, "pid", pid);
+    cJSON_AddStringToObject(to, "iid", iid);
+    if (0 != sequence) {
+        cJSON_AddNumberToObject(msg, "sequence", sequence);
+    }
+
+    /* Print to string */
+    char *str = cJSON_PrintUnformatted(msg);
+
+    /* Release memory */
+    cJSON_Delete(msg);
+
+    return str;
+}
+
+/**
+ * @brief Serialize the hello message and store it, options semaphore must be taken
+ * @param discover Discover instance
+ * @param omit true to omit the advertisement, only its hash is sent
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+discover_serialize_hello(discover_t *discover, bool omit) {
+
+    /* Serialize the advertisement to compute its hash, it allows the receivers to skip unchanged advertisements */
+    char *   advertisement = NULL;
+    uint32_t hash          = 0;
+    if (NULL != discover->options.advertisement) {
+        if (NULL == (advertisement = cJSON_PrintUnformatted(discover->options.advertisement))) {
+            /* Unable to allocate memory */
+            return -1;
+        }
+        hash = discover_hash_advertisement(advertisement);
+    }
+
+    /* Create data object to be transmitted in the "hello" message */
+    cJSON *data = cJSON_CreateObject();
+    if (NULL == data) {
+        /* Unable to allocate memory */
+        free(advertisement);
+        return -1;
+    }
+    bool is_master          = discover->is_master;
+    bool is_master_eligible = discover->is_master_eligible;
+    cJSON_AddBoolToObject(data, "isMaster", is_master);
+    cJSON_AddBoolToObject(data, "isMasterEligible", is_master_eligible);
+    cJSON_AddNumberToObject(data, "weight", discover->options.weight);
+    if (NULL != discover->options.address) {
+        cJSON_AddStringToObject(data, "address", discover->options.address);
+    }
+    if (NULL != discover->options.advertisement) {
+        cJSON_AddNumberToObject(data, "advertisementHash", hash);
+        if (false == omit) {
+            cJSON_AddItemReferenceToObject(data, "advertisement", discover->options.advertisement);
+        }
+    }
+    if ((true == discover->options.channels_filter) && (true == discover->hello.filtered)) {
+        char channels[2 * DISCOVER_CHANNELS_FILTER_SIZE + 1];
+        for (int index = 0; index < DISCOVER_CHANNELS_FILTER_SIZE; index++) {
+            snprintf(channels + 2 * index, 3, "%02x", discover->hello.channels[index]);
+        }
+        cJSON_AddStringToObject(data, "channels", channels);
+    }
+
+    /* Serialize message, using the binary encoding if it is enabled and possible */
+    char * str  = NULL;
+    size_t size = 0;
+    if (true == discover->options.binary_hello) {
+        str = discover_serialize_binary_hello(discover, (false == omit) ? advertisement : NULL, hash, &size);
+    }
+    if (NULL == str) {
+        str  = discover_serialize_message(discover, "hello", data);
+        size = (NULL != str) ? strlen(str) : 0;
+    }
+    cJSON_Delete(data);
+    if (NULL != advertisement) {
+        free(advertisement);
+    }
+    if (NULL == str) {
+        /* Unable to allocate memory */
+        return -1;
+    }
+
+    /* Store the hello message */
+    if (NULL != discover->hello.buffer) {
+        free(discover->hello.buffer);
+    }
+    discover->hello.buffer             = str;
+    discover->hello.size               = size;
+    discover->hello.dirty              = false;
+    discover->hello.is_master          = is_master;
+    discover->hello.is_master_eligible = is_master_eligible;
+    discover->hello.omitted            = omit;
+
+    return 0;
+}
+
+/**
+ * @brief Serialize the hello message using the binary encoding, options semaphore must be taken
+ * @param discover Discover instance
+ * @param advertisement Advertisement serialized, NULL if there is no advertisement or if it is omitted
+ * @param hash Hash of the advertisement, 0 if there is no advertisement
+ * @param size Size of the message serialized
+ * @return Message serialized if the function succeeded, NULL otherwise
+ */
+static char *
+discover_serialize_binary_hello(discover_t *discover, char *advertisement, uint32_t hash, size_t *size) {
+
+    /* The binary encoding requires UUIDs */
+    if ((WIRE_UUID_STR_SIZE - 1 != strlen(discover->pid)) || (WIRE_UUID_STR_SIZE - 1 != strlen(discover->iid))) {
+        return NULL;
+    }
+
+    /* Fill the hello message */
+    wire_hello_t hello;
+    memset(&hello, 0, sizeof(wire_hello_t));
+    strcpy(hello.pid, discover->pid);
+    strcpy(hello.iid, discover->iid);
+    hello.hostname           = discover->options.hostname;
+    hello.is_master          = discover->is_master;
+    hello.is_master_eligible = discover->is_master_eligible;
+    hello.weight             = discover->options.weight;
+    hello.address            = discover->options.address;
+
+    hello.advertisement_hash = hash;
+    if ((true == discover->options.channels_filter) && (true == discover->hello.filtered)) {
+        hello.channels = discover->hello.channels;
+    }
+    if (NULL != advertisement) {
+        if (UINT16_MAX < strlen(advertisement)) {
+            /* Advertisement is too large for the binary encoding */
+            return NULL;
+        }
+        hello.advertisement      = advertisement;
+        hello.advertisement_size = (uint16_t)strlen(advertisement);
+    }
+
+    /* Encode the hello message */
+    return (char *)wire_encode_hello(&hello, size);
+}
+
+/**
+ * @brief Compute the hash of a serialized advertisement
+ * @param advertisement Advertisement serialized
+ * @return Hash value, never 0
+ */
+static uint32_t
+discover_hash_advertisement(const char *advertisement) {
+
+    /* FNV-1a hash, 0 is reserved to indicate there is no advertisement */
+    uint32_t hash = 2166136261U;
+    for (const char *pch = advertisement; '\0' != *pch; pch++) {
+        hash = (hash ^ (unsigned char)*pch) * 16777619U;
+    }
+
+    return (0 != hash) ? hash : 1;
+}
+
+/**
+ * @brief Callback function called to handle received data
+ * @param sock Sock instance
+ * @param ip IP address of the sender
+ * @param port Port of the sender
+ * @param buffer Data received
+ * @param size Size of data received
+ * @param received Time the data has been received, monotonic clock in microseconds
+ * @param user User data
+ */
+static void
+discover_message_cb(sock_t *sock, char *ip, uint16_t port, void *buffer, size_t size, uint64_t received, void *user) {
+
+    (void)sock;
+    assert(NULL != ip);
+    assert(NULL != buffer);
+    assert(NULL != user);
+
+    /* Retrieve discover instance using user data */
+    discover_t *discover = (discover_t *)user;
+
+    /* Authenticate and decrypt message if a key is set, unauthenticated messages are dropped before being parsed */
+    if (NULL != discover->aead) {
+        if (0 != aead_decrypt(discover->aead, buffer, size, &buffer, &size)) {
+            /* Invalid message */
+            __atomic_add_fetch(&discover->stats.rx_invalid, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        ((char *)buffer)[size] = '\0';
+    }
+
+    /* Binary message, identified by its magic byte */
+    if (true == wire_is_binary(buffer, size)) {
+        discover_receive_binary(discover, ip, port, buffer, size, received);
+        return;
+    }
+
+    /* Retrieve the UUIDs of the sender without parsing the message, malformed and self-originated messages are dropped before allocating memory */
+    char sender_pid[WIRE_UUID_STR_SIZE];
+    char sender_iid[WIRE_UUID_STR_SIZE];
+    if (0 != discover_scan_message(buffer, size, sender_pid, sender_iid)) {
+        /* Invalid message, ignore */
+        __atomic_add_fetch(&discover->stats.rx_invalid, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    bool checked = (('\0' != sender_pid[0]) && ('\0' != sender_iid[0])) ? true : false;
+    if ((true == checked) && (true == discover_ignore_message(discover, sender_pid, sender_iid))) {
+        /* Ignore this message */
+        return;
+    }
+
+    /* Parse JSON string in place in the datagram buffer, its size is already known */
+    cJSON *json = cJSON_ParseWithLength(buffer, size);
+    if (NULL == json) {
+        /* Unable to parse JSON string */
+        __atomic_add_fetch(&discover->stats.rx_invalid, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    /* Flag set when the message is invalid */
+    bool invalid = false;
+
+    /* Check Process UUID */
+    cJSON *pid = cJSON_GetObjectItemCaseSensitive(json, "pid");
+    if ((NULL == pid) || (!cJSON_IsString(pid))) {
+        /* No Process UUID, ignore message */
+        invalid = true;
+        goto END;
+    }
+
+    /* Check Instance UUID */
+    cJSON *iid = cJSON_GetObjectItemCaseSensitive(json, "iid");
+    if ((NULL == iid) || (!cJSON_IsString(iid))) {
+        /* No Instance UUID, ignore message */
+        invalid = true;
+        goto END;
+    }
+
+    /* Check if the message should be ignored, if it has not been done before parsing it */
+    if ((false == checked) && (true == discover_ignore_message(discover, cJSON_GetStringValue(pid), cJSON_GetStringValue(iid)))) {
+        /* Ignore this message */
+        goto END;
+    }
+
+    /* Check the destination of the message if it is directed to a single node */
+    if (false == discover_receive_directed(discover, ip, port, json, cJSON_GetStringValue(pid), cJSON_GetStringValue(iid))) {
+        /* Ignore this message */
+        goto END;
+    }
+
+    /* Retrieve event */
+    cJSON *event = cJSON_GetObjectItemCaseSensitive(json, "event");
+    if ((NULL != event) && (cJSON_IsString(event))) {
+
+        /* Treatment depending of the event type */
+        if (!strcmp(cJSON_GetStringValue(event), "hello")) {
+
+            /* Hello event, retrieve data */
+            cJSON *data = cJSON_GetObjectItemCaseSensitive(json, "data");
+            if ((NULL != data) && (cJSON_IsObject(data))) {
+
+                /* Retrieve event fields */
+                cJSON *hostname = cJSON_GetObjectItemCaseSensitive(json, "hostName");
+                if ((NULL == hostname) || (!cJSON_IsString(hostname))) {
+                    /* Invalid message, ignore */
+                    invalid = true;
+                    goto END;
+                }
+
+                /* Retrieve data fields */
+                cJSON *is_master = cJSON_GetObjectItemCaseSensitive(data, "isMaster");
+                if ((NULL == is_master) || (!cJSON_IsBool(is_master))) {
+                    /* Invalid message, ignore */
+                    invalid = true;
+                    goto END;
+                }
+                cJSON *is_master_eligible = cJSON_GetObjectItemCaseSensitive(data, "isMasterEligible");
+                if ((NULL == is_master_eligible) || (!cJSON_IsBool(is_master_eligible))) {
+                    /* Invalid message, ignore */
+                    invalid = true;
+                    goto END;
+                }
+                cJSON *weight = cJSON_GetObjectItemCaseSensitive(data, "weight");
+                if ((NULL == weight) || (!cJSON_IsNumber(weight))) {
+                    /* Invalid message, ignore */
+                    invalid = true;
+                    goto END;
+                }
+                cJSON *address = cJSON_GetObjectItemCaseSensitive(data, "address");
+                if ((NULL == address) || (!cJSON_IsString(address))) {
+                    /* Invalid message, ignore */
+                    invalid = true;
+                    goto END;
+                }
+                cJSON *advertisement_hash = cJSON_GetObjectItemCaseSensitive(data, "advertisementHash");
+
+                /* Handle the hello message */
+                wire_hello_t hello;
+                memset(&hello, 0, sizeof(wire_hello_t));
+                hello.hostname           = cJSON_GetStringValue(hostname);
+                hello.is_master          = cJSON_IsTrue(is_master) ? true : false;
+                hello.is_master_eligible = cJSON_IsTrue(is_master_eligible) ? true : false;
+                hello.weight             = cJSON_GetNumberValue(weight);
+                hello.address            = cJSON_GetStringValue(address);
+                if ((NULL != advertisement_hash) && (cJSON_IsNumber(advertisement_hash))) {
+                    hello.advertisement_hash = (uint32_t)cJSON_GetNumberValue(advertisement_hash);
+                }
+                /* The channels are ignored if they can't be decoded, the node is then considered to have joined all channels */
+                uint8_t filter[DISCOVER_CHANNELS_FILTER_SIZE];
+                cJSON * channels = cJSON_GetObjectItemCaseSensitive(data, "channels");
+                if ((NULL != channels) && (cJSON_IsString(channels)) && (0 == discover_decode_channels(cJSON_GetStringValue(channels), filter))) {
+                    hello.channels = filter;
+                }
+                /* The advertisement is detached from the message so that it is moved to the node instead of being copied */
+                cJSON *advertisement = cJSON_DetachItemFromObjectCaseSensitive(data, "advertisement");
+                discover_receive_hello(discover, ip, port, cJSON_GetStringValue(pid), cJSON_GetStringValue(iid), &hello, advertisement, received);
+            }
+
+        } else if (!strcmp(cJSON_GetStringValue(event), DISCOVER_RESERVED_ADVERTISEMENT_REQUEST)) {
+
+            /* Advertisement request event, send the advertisement with the next hello messages if it is requested to me */
+            cJSON *data = cJSON_GetObjectItemCaseSensitive(json, "data");
+            if ((NULL != data) && (cJSON_IsObject(data))) {
+                cJSON *target_pid = cJSON_GetObjectItemCaseSensitive(data, "pid");
+                cJSON *target_iid = cJSON_GetObjectItemCaseSensitive(data, "iid");
+                if ((NULL != target_pid) && (cJSON_IsString(target_pid)) && (NULL != target_iid) && (cJSON_IsString(target_iid))
+                    && (!strcmp(cJSON_GetStringValue(target_pid), discover->pid)) && (!strcmp(cJSON_GetStringValue(target_iid), discover->iid))) {
+                    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+                    discover->hello.rounds = 0;
+                    sem_post(&discover->options.sem);
+                    discover_request_hellos(discover);
+                }
+            }
+
+        } else if (!strcmp(cJSON_GetStringValue(event), DISCOVER_RESERVED_ACK)) {
+
+            /* Acknowledgement of a directed message, it is not retransmitted anymore */
+            cJSON *data = cJSON_GetObjectItemCaseSensitive(json, "data");
+            if ((NULL != data) && (cJSON_IsObject(data))) {
+                cJSON *sequence = cJSON_GetObjectItemCaseSensitive(data, "sequence");
+                if ((NULL != sequence) && (cJSON_IsNumber(sequence))) {
+                    discover_remove_directed(discover, (uint32_t)cJSON_GetNumberValue(sequence), cJSON_GetStringValue(pid), cJSON_GetStringValue(iid));
+                }
+            }
+
+        } else if (!strcmp(cJSON_GetStringValue(event), DISCOVER_RESERVED_BATCH)) {
+
+            /* Batch of messages, each message is dispatched to the channels as if it had been received alone */
+            cJSON *messages = cJSON_GetObjectItemCaseSensitive(json, "data");
+            if ((NULL == messages) || (!cJSON_IsArray(messages))) {
+                /* Invalid message, ignore */
+                invalid = true;
+                goto END;
+            }
+            cJSON *item;
+            cJSON_ArrayForEach(item, messages) {
+                cJSON *item_event = cJSON_GetObjectItemCaseSensitive(item, "event");
+                if ((NULL == item_event) || (!cJSON_IsString(item_event)) || (true == discover_is_reserved(cJSON_GetStringValue(item_event)))) {
+                    /* Invalid message, the other messages of the batch are still dispatched */
+                    invalid = true;
+                    continue;
+                }
+                /* The message is rebuilt using references to the envelope of the batch and to the message so that nothing is copied */
+                cJSON *msg = cJSON_CreateObject();
+                if (NULL == msg) {
+                    /* Unable to allocate memory */
+                    break;
+                }
+                cJSON_AddItemReferenceToObject(msg, "event", item_event);
+                cJSON_AddItemReferenceToObject(msg, "pid", pid);
+                cJSON_AddItemReferenceToObject(msg, "iid", iid);
+                cJSON *hostname = cJSON_GetObjectItemCaseSensitive(json, "hostName");
+                if (NULL != hostname) {
+                    cJSON_AddItemReferenceToObject(msg, "hostName", hostname);
+                }
+                cJSON *data = cJSON_GetObjectItemCaseSensitive(item, "data");
+                if (NULL != data) {
+                    cJSON_AddItemReferenceToObject(msg, "data", data);
+                }
+                discover_dispatch_channels(discover, cJSON_GetStringValue(item_event), msg, received);
+                cJSON_Delete(msg);
+            }
+
+        } else if (true == discover_is_reserved(cJSON_GetStringValue(event))) {
+
+            /* Reserved event unknown, sent by a newer version of the library, ignore */
+
+        } else {
+
+            /* Other event, check channels */
+            discover_dispatch_channels(discover, cJSON_GetStringValue(event), json, received);
+        }
+    }
+
+END:
+
+    /* Count the invalid message */
+    if (true == invalid) {
+        __atomic_add_fetch(&discover->stats.rx_invalid, 1, __ATOMIC_RELAXED);
+    }
+
+    /* Release memory */
+    cJSON_Delete(json);
+}
+
+/**
+ * @brief Invoke the callbacks of the channels matching the event of a message
+ * @param discover Discover instance
+ * @param event Event of the message
+ * @param json Message
+ * @param received Time the message has been read, monotonic clock in microseconds
+ */
+static void
+discover_dispatch_channels(discover_t *discover, char *event, cJSON *json, uint64_t received) {
+
+    assert(NULL != discover);
+    assert(NULL != event);
+    assert(NULL != json);
+
+    /* Wait channels semaphore */
+    sem_wait(&discover->channels.sem);
+
+    /* Parse all channels, literal events match when they are found in the event received */
+    discover_channel_t *curr_channel = discover->channels.first;
+    while (NULL != curr_channel) {
+        if (NULL != curr_channel->fct) {
+            bool match = false;
+            if (true == curr_channel->literal) {
+                match = (NULL != strstr(event, curr_channel->event)) ? true : false;
+            } else {
+                match = (0 == regexec(&curr_channel->regex, event, 0, NULL, 0)) ? true : false;
+            }
+            if (true == match) {
+                /* Invoke channels callback */
+                uint64_t start = discover_get_time_us();
+                curr_channel->fct(discover, event, json, curr_channel->user);
+                discover_record_latency(&discover->stats.receive_latency, start - received);
+                discover_record_latency(&discover->stats.callback_duration, discover_get_time_us() - start);
+            }
+        }
+        curr_channel = curr_channel->next;
+    }
+
+    /* Release channels semaphore */
+    sem_post(&discover->channels.sem);
+}
+
+/**
+ * @brief Compute the bloom filter of the channels joined and store it for the hello message, channels semaphore must be taken
+ * @param discover Discover instance
+ * @return true if the channels joined are advertised, false otherwise
+ */
+static bool
+discover_update_channels(discover_t *discover) {
+
+    assert(NULL != discover);
+
+    uint8_t channels[DISCOVER_CHANNELS_FILTER_SIZE];
+    bool    filtered = true;
+
+    /* Add the literal channels to the filter, a regular expression or an empty event may match any event so the filter is not advertised */
+    memset(channels, 0, sizeof(channels));
+    for (discover_channel_t *curr_channel = discover->channels.first; NULL != curr_channel; curr_channel = curr_channel->next) {
+        if ((false == curr_channel->literal) || ('\0' == curr_channel->event[0])) {
+            filtered = false;
+            break;
         }
-    } else if (!strcmp("multicast", option)) {
-        if (NULL != discover->options.multicast) {
-            free(discover->options.multicast);
+        discover_add_channel(channels, curr_channel->event, strlen(curr_channel->event));
+    }
+
+    /* Wait options semaphore */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+
+    /* Store the filter, the hello message must be serialized again */
+    memcpy(discover->hello.channels, channels, sizeof(channels));
+    discover->hello.filtered = filtered;
+    discover->hello.dirty    = true;
+    bool advertised          = discover->options.channels_filter;
+
+    /* Release options semaphore */
+    sem_post(&discover->options.sem);
+
+    return advertised;
+}
+
+/**
+ * @brief Add a channel to a bloom filter of channels
+ * @param filter Bloom filter, DISCOVER_CHANNELS_FILTER_SIZE bytes
+ * @param channel Event of the channel
+ * @param length Length of the event
+ */
+static void
+discover_add_channel(uint8_t *filter, const char *channel, size_t length) {
+
+    /* FNV-1a hash of the event */
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t index = 0; index < length; index++) {
+        hash = (hash ^ (unsigned char)channel[index]) * 1099511628211ULL;
+    }
+
+    /* Set the bits, each one is taken from a different part of the hash */
+    for (int index = 0; index < DISCOVER_CHANNELS_FILTER_HASHES; index++) {
+        size_t bit = (size_t)(hash >> (21 * index)) % (8 * DISCOVER_CHANNELS_FILTER_SIZE);
+        filter[bit / 8] |= (uint8_t)(1 << (bit % 8));
+    }
+}
+
+/**
+ * @brief Check if a bloom filter of channels may contain a channel matching an event, literal channels match the events containing them
+ * @param filter Bloom filter, DISCOVER_CHANNELS_FILTER_SIZE bytes
+ * @param event Event
+ * @return true if a channel may match the event, false if no channel matches it
+ */
+static bool
+discover_match_channels(const uint8_t *filter, const char *event) {
+
+    /* Check all the substrings of the event, the hashes of the substrings starting at the same position are computed incrementally */
+    size_t length = strlen(event);
+    for (size_t start = 0; start < length; start++) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t end = start; end < length; end++) {
+            hash       = (hash ^ (unsigned char)event[end]) * 1099511628211ULL;
+            bool match = true;
+            for (int index = 0; (index < DISCOVER_CHANNELS_FILTER_HASHES) && (true == match); index++) {
+                size_t bit = (size_t)(hash >> (21 * index)) % (8 * DISCOVER_CHANNELS_FILTER_SIZE);
+                match      = (0 != (filter[bit / 8] & (1 << (bit % 8)))) ? true : false;
+            }
+            if (true == match) {
+                return true;
+            }
         }
-        discover->options.multicast = strdup((char *)value);
-        if (NULL != discover->options.multicast) {
-            ret = 0;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Check if an event is reserved by the library
+ * @param event Event
+ * @return true if the event starts with the reserved prefix, false otherwise
+ */
+static bool
+discover_is_reserved(const char *event) {
+
+    assert(NULL != event);
+
+    /* Compare the beginning of the event with the reserved prefix */
+    return (0 == strncmp(event, DISCOVER_RESERVED_PREFIX, strlen(DISCOVER_RESERVED_PREFIX))) ? true : false;
+}
+
+/**
+ * @brief Compute the bits of the bloom filter of the channels set by each substring of an event, a channel contained in the event sets the ones of a substring
+ * @param event Event
+ * @param bits Union of the bits set by the substrings, DISCOVER_CHANNELS_FILTER_SIZE bytes
+ * @param count Number of substrings
+ * @return Bits set by the substrings, DISCOVER_CHANNELS_FILTER_HASHES per substring, NULL if the function failed, it must be released by the caller
+ */
+static uint16_t *
+discover_hash_event(const char *event, uint8_t *bits, size_t *count) {
+
+    assert(NULL != event);
+    assert(NULL != bits);
+    assert(NULL != count);
+
+    /* Allocate memory, one entry per substring */
+    size_t    length = strlen(event);
+    *count           = length * (length + 1) / 2;
+    uint16_t *hashes = (uint16_t *)malloc((*count * DISCOVER_CHANNELS_FILTER_HASHES + 1) * sizeof(uint16_t));
+    if (NULL == hashes) {
+        /* Unable to allocate memory */
+        return NULL;
+    }
+    memset(bits, 0, DISCOVER_CHANNELS_FILTER_SIZE);
+
+    /* Compute the bits of all the substrings as when matching the channels, the hashes of the substrings starting at the same position are computed incrementally */
+    uint16_t *pos = hashes;
+    for (size_t start = 0; start < length; start++) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t end = start; end < length; end++) {
+            hash = (hash ^ (unsigned char)event[end]) * 1099511628211ULL;
+            for (int index = 0; index < DISCOVER_CHANNELS_FILTER_HASHES; index++) {
+                size_t bit = (size_t)(hash >> (21 * index)) % (8 * DISCOVER_CHANNELS_FILTER_SIZE);
+                *pos++     = (uint16_t)bit;
+                bits[bit / 8] |= (uint8_t)(1 << (bit % 8));
+            }
         }
-    } else if (!strcmp("multicastTTL", option)) {
-        discover->options.multicast_ttl = *((unsigned char *)value);
-        ret                             = 0;
-    } else if (!strcmp("unicast", option)) {
-        if (NULL != discover->options.unicast) {
-            free(discover->options.unicast);
+    }
+
+    return hashes;
+}
+
+/**
+ * @brief Check if a channel of a bloom filter may match an event, using the bits set by the substrings of the event
+ * @param filter Bloom filter of the channels, DISCOVER_CHANNELS_FILTER_SIZE bytes
+ * @param bits Union of the bits set by the substrings, DISCOVER_CHANNELS_FILTER_SIZE bytes
+ * @param hashes Bits set by the substrings, DISCOVER_CHANNELS_FILTER_HASHES per substring
+ * @param count Number of substrings
+ * @return true if a channel may match the event, false if no channel matches it
+ */
+static bool
+discover_match_hashes(const uint8_t *filter, const uint8_t *bits, const uint16_t *hashes, size_t count) {
+
+    assert(NULL != filter);
+    assert(NULL != bits);
+    assert(NULL != hashes);
+
+    /* No channel matches if the filter has no bit in common with the substrings, usually when the nodes have joined other channels */
+    uint8_t common = 0;
+    for (int index = 0; index < DISCOVER_CHANNELS_FILTER_SIZE; index++) {
+        common |= filter[index] & bits[index];
+    }
+    if (0 == common) {
+        return false;
+    }
+
+    /* Check the bits of each substring */
+    for (size_t substring = 0; substring < count; substring++) {
+        bool match = true;
+        for (int index = 0; (index < DISCOVER_CHANNELS_FILTER_HASHES) && (true == match); index++) {
+            uint16_t bit = hashes[substring * DISCOVER_CHANNELS_FILTER_HASHES + index];
+            match        = (0 != (filter[bit / 8] & (1 << (bit % 8)))) ? true : false;
         }
-        discover->options.unicast = strdup((char *)value);
-        if (NULL != discover->options.unicast) {
-            ret = 0;
+        if (true == match) {
+            return true;
         }
-    } else if (!strcmp("key", option)) {
-        if (NULL != discover->options.key) {
-            free(discover->options.key);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Decode a bloom filter of channels from its hexadecimal representation
+ * @param str Hexadecimal representation, 2 * DISCOVER_CHANNELS_FILTER_SIZE digits
+ * @param filter Bloom filter, DISCOVER_CHANNELS_FILTER_SIZE bytes
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+discover_decode_channels(const char *str, uint8_t *filter) {
+
+    /* Check the length of the representation */
+    if (2 * DISCOVER_CHANNELS_FILTER_SIZE != strlen(str)) {
+        /* Invalid representation */
+        return -1;
+    }
+
+    /* Parse the hexadecimal digits */
+    for (int index = 0; index < 2 * DISCOVER_CHANNELS_FILTER_SIZE; index++) {
+        char c = str[index];
+        int  digit;
+        if (('0' <= c) && ('9' >= c)) {
+            digit = c - '0';
+        } else if (('a' <= c) && ('f' >= c)) {
+            digit = c - 'a' + 10;
+        } else if (('A' <= c) && ('F' >= c)) {
+            digit = c - 'A' + 10;
+        } else {
+            /* Invalid representation */
+            return -1;
         }
-        discover->options.key = strdup((char *)value);
-        if (NULL != discover->options.key) {
-            ret = 0;
+        if (0 == (index % 2)) {
+            filter[index / 2] = (uint8_t)(digit << 4);
+        } else {
+            filter[index / 2] |= (uint8_t)digit;
         }
-    } else if (!strcmp("mastersRequired", option)) {
-        discover->options.masters_required = *((int *)value);
-        ret                                = 0;
-    } else if (!strcmp("weight", option)) {
-        discover->options.weight = *((double *)value);
-        ret                      = 0;
-    } else if (!strcmp("client", option)) {
-        discover->options.client = *((bool *)value);
-        ret                      = 0;
-    } else if (!strcmp("reuseAddr", option)) {
-        discover->options.reuse_addr = *((bool *)value);
-        ret                          = 0;
-    } else if (!strcmp("ignoreProcess", option)) {
-        discover->options.ignore_process = *((bool *)value);
-        ret                              = 0;
-    } else if (!strcmp("ignoreInstance", option)) {
-        discover->options.ignore_instance = *((bool *)value);
-        ret                               = 0;
-    } else if (!strcmp("advertisement", option)) {
-        if (NULL != discover->options.advertisement) {
-            cJSON_Delete(discover->options.advertisement);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Handle the destination of a message, acknowledge it if it is requested
+ * @param discover Discover instance
+ * @param ip IP address of the sender
+ * @param port Port of the sender
+ * @param json Message
+ * @param pid Process UUID of the sender
+ * @param iid Instance UUID of the sender
+ * @return true if the message must be handled, false if it is directed to another instance or if it has already been received
+ */
+static bool
+discover_receive_directed(discover_t *discover, char *ip, uint16_t port, cJSON *json, char *pid, char *iid) {
+
+    assert(NULL != discover);
+    assert(NULL != json);
+
+    /* Messages sent to all nodes have no destination */
+    cJSON *to = cJSON_GetObjectItemCaseSensitive(json, "to");
+    if (NULL == to) {
+        return true;
+    }
+
+    /* Check the destination, several instances may share the port of the destination */
+    cJSON *to_pid = cJSON_GetObjectItemCaseSensitive(to, "pid");
+    cJSON *to_iid = cJSON_GetObjectItemCaseSensitive(to, "iid");
+    if ((NULL == to_pid) || (!cJSON_IsString(to_pid)) || (NULL == to_iid) || (!cJSON_IsString(to_iid))
+        || (0 != strcmp(cJSON_GetStringValue(to_pid), discover->pid)) || (0 != strcmp(cJSON_GetStringValue(to_iid), discover->iid))) {
+        return false;
+    }
+
+    /* Check if the acknowledgement is requested */
+    cJSON *sequence = cJSON_GetObjectItemCaseSensitive(json, "sequence");
+    if ((NULL == sequence) || (!cJSON_IsNumber(sequence))) {
+        return true;
+    }
+    uint32_t value = (uint32_t)cJSON_GetNumberValue(sequence);
+
+    /* Acknowledge the message, also when it has already been received because the previous acknowledgement may have been lost */
+    cJSON *data = cJSON_CreateObject();
+    if (NULL != data) {
+        cJSON_AddNumberToObject(data, "sequence", value);
+        discover_lock(&discover->options.sem, &discover->stats.options_lock);
+        char *str = discover_serialize_directed(discover, DISCOVER_RESERVED_ACK, data, pid, iid, 0);
+        sem_post(&discover->options.sem);
+        if (NULL != str) {
+            discover_transmit_to(discover, ip, port, str, strlen(str));
+        }
+        cJSON_Delete(data);
+    }
+
+    /* Wait directed messages semaphore */
+    sem_wait(&discover->directed.sem);
+
+    /* Search the message in the history of the directed messages received, it is added if it is not found */
+    uint64_t node      = discover_hash_node(pid, iid);
+    bool     duplicate = false;
+    for (size_t index = 0; index < DISCOVER_DIRECTED_HISTORY; index++) {
+        if ((node == discover->directed.history[index].node) && (value == discover->directed.history[index].sequence)) {
+            duplicate = true;
+            break;
+        }
+    }
+    if (false == duplicate) {
+        discover->directed.history[discover->directed.next].node     = node;
+        discover->directed.history[discover->directed.next].sequence = value;
+        discover->directed.next                                      = (discover->directed.next + 1) % DISCOVER_DIRECTED_HISTORY;
+    }
+
+    /* Release directed messages semaphore */
+    sem_post(&discover->directed.sem);
+
+    return (false == duplicate) ? true : false;
+}
+
+/**
+ * @brief Scan JSON string without parsing it
+ * @param pos Position of the opening quote, updated to the position following the closing quote
+ * @param end End of the buffer
+ * @param start Start of the string content
+ * @param length Length of the string content
+ * @param escaped true if the string contains escape sequences, false otherwise
+ * @return 0 if the function succeeded, -1 if the string is not terminated
+ */
+static int
+discover_scan_string(char **pos, char *end, char **start, size_t *length, bool *escaped) {
+
+    assert(NULL != pos);
+    assert(NULL != end);
+    assert(NULL != start);
+    assert(NULL != length);
+    assert(NULL != escaped);
+
+    /* Search the closing quote, skipping escape sequences */
+    char *curr = *pos + 1;
+    *start     = curr;
+    *escaped   = false;
+    while ((curr < end) && ('"' != *curr)) {
+        if ('\\' == *curr) {
+            *escaped = true;
+            curr++;
+        }
+        curr++;
+    }
+    if (curr >= end) {
+        /* String is not terminated */
+        return -1;
+    }
+    *length = curr - *start;
+    *pos    = curr + 1;
+
+    return 0;
+}
+
+/**
+ * @brief Scan JSON message and retrieve its Process and Instance UUIDs without parsing it, used to drop messages before allocating memory
+ * @param buffer Message
+ * @param size Size of the message
+ * @param pid Process UUID of the sender, WIRE_UUID_STR_SIZE bytes, empty if it can't be retrieved without parsing the message
+ * @param iid Instance UUID of the sender, WIRE_UUID_STR_SIZE bytes, empty if it can't be retrieved without parsing the message
+ * @return 0 if the function succeeded, -1 if the message is malformed or has no Process or Instance UUIDs
+ */
+static int
+discover_scan_message(char *buffer, size_t size, char *pid, char *iid) {
+
+    assert(NULL != buffer);
+    assert(NULL != pid);
+    assert(NULL != iid);
+
+    char *pos          = buffer;
+    char *end          = buffer + size;
+    bool  found_pid    = false;
+    bool  found_iid    = false;
+    bool  escaped_keys = false;
+    bool  key          = false;
+    int   depth        = 0;
+
+    pid[0] = '\0';
+    iid[0] = '\0';
+
+    /* The message must be an object */
+    while ((pos < end) && ((' ' == *pos) || ('\t' == *pos) || ('\r' == *pos) || ('\n' == *pos))) {
+        pos++;
+    }
+    if ((pos >= end) || ('{' != *pos)) {
+        /* Not an object */
+        return -1;
+    }
+
+    /* Scan the members of the object, nested values are skipped, stop once both UUIDs are found */
+    while ((pos < end) && ((false == found_pid) || (false == found_iid))) {
+        if ('"' == *pos) {
+            char * start;
+            size_t length;
+            bool   escaped;
+            if (0 != discover_scan_string(&pos, end, &start, &length, &escaped)) {
+                /* String is not terminated */
+                return -1;
+            }
+            if (false == key) {
+                /* Value or nested string */
+                continue;
+            }
+            key = false;
+            if (true == escaped) {
+                /* Key can't be compared without parsing the message */
+                escaped_keys = true;
+                continue;
+            }
+            char *target = NULL;
+            if ((3 == length) && (!strncmp(start, "pid", 3)) && (false == found_pid)) {
+                target = pid;
+            } else if ((3 == length) && (!strncmp(start, "iid", 3)) && (false == found_iid)) {
+                target = iid;
+            } else {
+                /* Other member */
+                continue;
+            }
+
+            /* Retrieve the value, it must be a string */
+            while ((pos < end) && (':' != *pos) && ('"' != *pos)) {
+                pos++;
+            }
+            if ((pos < end) && (':' == *pos)) {
+                pos++;
+                while ((pos < end) && ((' ' == *pos) || ('\t' == *pos) || ('\r' == *pos) || ('\n' == *pos))) {
+                    pos++;
+                }
+            }
+            if ((pos >= end) || ('"' != *pos)) {
+                /* Not a string, the message is ignored */
+                return -1;
+            }
+            if (0 != discover_scan_string(&pos, end, &start, &length, &escaped)) {
+                /* String is not terminated */
+                return -1;
+            }
+            if (target == pid) {
+                found_pid = true;
+            } else {
+                found_iid = true;
+            }
+
+            /* Copy the value, UUIDs with escape sequences or with an unexpected length are left to the parser */
+            if ((false == escaped) && (WIRE_UUID_STR_SIZE - 1 == length)) {
+                memcpy(target, start, length);
+                target[length] = '\0';
+            }
+            continue;
+        }
+        if (('{' == *pos) || ('[' == *pos)) {
+            depth++;
+            key = (1 == depth) ? true : false;
+        } else if (('}' == *pos) || (']' == *pos)) {
+            depth--;
+            if (0 == depth) {
+                /* End of the object */
+                break;
+            }
+        } else if ((',' == *pos) && (1 == depth)) {
+            key = true;
+        }
+        pos++;
+    }
+
+    /* Both UUIDs are required, unless some keys can't be compared without parsing the message */
+    if (((false == found_pid) || (false == found_iid)) && (false == escaped_keys)) {
+        /* Missing UUIDs */
+        pid[0] = '\0';
+        iid[0] = '\0';
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Check if a message should be ignored because it is sent by myself
+ * @param discover Discover instance
+ * @param pid Process UUID of the sender
+ * @param iid Instance UUID of the sender
+ * @return true if the message should be ignored, false otherwise
+ */
+static bool
+discover_ignore_message(discover_t *discover, char *pid, char *iid) {
+
+    /* Wait options semaphore */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+
+    /* Check Process and Instance UUIDs */
+    bool ignore = false;
+    if ((true == discover->options.ignore_process) && (!strcmp(pid, discover->pid))) {
+        ignore = true;
+    } else if ((true == discover->options.ignore_instance) && (!strcmp(iid, discover->iid))) {
+        ignore = true;
+    }
+
+    /* Release options semaphore */
+    sem_post(&discover->options.sem);
+
+    return ignore;
+}
+
+/**
+ * @brief Handle binary message
+ * @param discover Discover instance
+ * @param ip IP address of the sender
+ * @param port Port of the sender
+ * @param buffer Data received
+ * @param size Size of data received
+ * @param received Time the data has been received, monotonic clock in microseconds
+ */
+static void
+discover_receive_binary(discover_t *discover, char *ip, uint16_t port, void *buffer, size_t size, uint64_t received) {
+
+    /* Decode hello message, this is the only binary message */
+    wire_hello_t hello;
+    if (0 != wire_decode_hello(buffer, size, &hello)) {
+        /* Invalid message, ignore */
+        __atomic_add_fetch(&discover->stats.rx_invalid, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    /* Check if the message should be ignored */
+    if (true == discover_ignore_message(discover, hello.pid, hello.iid)) {
+        /* Ignore this message */
+        return;
+    }
+
+    /* Handle the hello message, the advertisement is parsed only if it has changed */
+    discover_receive_hello(discover, ip, port, hello.pid, hello.iid, &hello, NULL, received);
+}
+
+/**
+ * @brief Handle hello message, add or update the node
+ * @param discover Discover instance
+ * @param ip IP address of the sender
+ * @param port Port of the sender
+ * @param pid Process UUID of the sender
+ * @param iid Instance UUID of the sender
+ * @param hello Hello message
+ * @param advertisement Advertisement of the sender, owned by the function, NULL if there is no advertisement or if it is serialized in the hello message
+ * @param received Time the hello message has been received, monotonic clock in microseconds
+ */
+static void
+discover_receive_hello(discover_t *discover, char *ip, uint16_t port, char *pid, char *iid, wire_hello_t *hello, cJSON *advertisement, uint64_t received) {
+
+    /* The UUIDs are stored in the node records, longer ones are invalid */
+    if ((DISCOVER_NODE_UUID_SIZE <= strlen(pid)) || (DISCOVER_NODE_UUID_SIZE <= strlen(iid))) {
+        /* Invalid message, ignore */
+        if (NULL != advertisement) {
+            cJSON_Delete(advertisement);
+        }
+        return;
+    }
+
+    /* Retrieve timeouts values */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+    int node_timeout   = discover->options.node_timeout;
+    int master_timeout = discover->options.master_timeout;
+    sem_post(&discover->options.sem);
+
+    /* Flags */
+    bool is_new     = false;
+    bool was_master = false;
+    bool request    = false;
+
+    /* Wait semaphore */
+    discover_lock(&discover->nodes.sem, &discover->stats.nodes_lock);
+
+    /* Search node in the index */
+    discover_node_t *node = discover_lookup_node(discover, pid, iid);
+    if (NULL != node) {
+        /* Node found, remove it from the counters before updating it, and from the indexes only if its master state or its weight change */
+        bool reindex = (hello->is_master != node->data.is_master) || (hello->is_master_eligible != node->data.is_master_eligible)
+                       || (hello->weight != node->data.weight);
+        discover_count_node(discover, node, -1);
+        discover_filter_node(discover, node, -1);
+        if (true == reindex) {
+            discover_index_node(discover, node, false);
+        }
+        /* Update the node, the strings are replaced only if they have changed */
+        bool changed = discover_update_string(&node->hostname, hello->hostname);
+        changed      = discover_update_buffer(node->address, sizeof(node->address), ip) || changed;
+        changed      = discover_update_buffer(node->data.address, sizeof(node->data.address), hello->address) || changed;
+        if ((port != node->port) || (hello->is_master != node->data.is_master) || (hello->is_master_eligible != node->data.is_master_eligible)
+            || (hello->weight != node->data.weight) || ((NULL != hello->channels) != node->data.filtered)
+            || ((NULL != hello->channels) && (0 != memcmp(hello->channels, node->data.channels, DISCOVER_CHANNELS_FILTER_SIZE)))) {
+            changed = true;
+        }
+        node->port                    = port;
+        node->last_seen               = time(NULL);
+        node->last_seen_ms            = discover_get_time();
+        was_master                    = node->data.is_master;
+        node->data.is_master          = hello->is_master;
+        node->data.is_master_eligible = hello->is_master_eligible;
+        node->data.weight             = hello->weight;
+        node->data.filtered           = (NULL != hello->channels) ? true : false;
+        if (NULL != hello->channels) {
+            memcpy(node->data.channels, hello->channels, DISCOVER_CHANNELS_FILTER_SIZE);
         }
-        discover->options.advertisement = (NULL != value) ? cJSON_Duplicate((cJSON *)value, 1) : NULL;
-        ret                             = 0;
-    } else if (!strcmp("hostname", option)) {
-        if (NULL != discover->options.hostname) {
-            free(discover->options.hostname);
+        /* The new advertisement is allocated before the previous one is released, so the pointers differ if it has been replaced */
+        cJSON *previous = node->data.advertisement;
+        request         = discover_update_advertisement(node, hello, &advertisement);
+        if (previous != node->data.advertisement) {
+            changed = true;
         }
-        discover->options.hostname = strdup((char *)value);
-        if (NULL != discover->options.hostname) {
-            ret = 0;
+        /* A node loaded from the cache is added once it is seen */
+        if (true == node->data.stale) {
+            node->data.stale = false;
+            changed          = true;
+            is_new           = true;
+            __atomic_add_fetch(&discover->stats.nodes_added, 1, __ATOMIC_RELAXED);
+        }
+        /* The snapshots become outdated when the data of the node change, not when it is only seen again */
+        if (true == changed) {
+            __atomic_add_fetch(&discover->nodes.version, 1, __ATOMIC_RELEASE);
+        }
+        /* Update its deadline and add it to the counters and to the indexes again */
+        DISCOVER_RECORD(node)->deadline = node->last_seen_ms + ((true == node->data.is_master) ? master_timeout : node_timeout);
+        discover_update_node(discover, node);
+        discover_count_node(discover, node, 1);
+        discover_filter_node(discover, node, 1);
+        if (true == reindex) {
+            discover_index_node(discover, node, true);
+        }
+    } else {
+        /* No node found, create a new one and add it at the end of the list */
+        is_new = true;
+        node   = discover_alloc_node(discover);
+        if (NULL != node) {
+            strcpy(node->pid, pid);
+            strcpy(node->iid, iid);
+            discover_update_buffer(node->address, sizeof(node->address), ip);
+            discover_update_buffer(node->data.address, sizeof(node->data.address), hello->address);
+            node->hostname                = strdup(hello->hostname);
+            node->port                    = port;
+            node->last_seen               = time(NULL);
+            node->last_seen_ms            = discover_get_time();
+            node->data.is_master          = hello->is_master;
+            node->data.is_master_eligible = hello->is_master_eligible;
+            node->data.weight             = hello->weight;
+            node->data.filtered           = (NULL != hello->channels) ? true : false;
+            if (NULL != hello->channels) {
+                memcpy(node->data.channels, hello->channels, DISCOVER_CHANNELS_FILTER_SIZE);
+            }
+            request                         = discover_update_advertisement(node, hello, &advertisement);
+            DISCOVER_RECORD(node)->deadline = node->last_seen_ms + ((true == node->data.is_master) ? master_timeout : node_timeout);
+            if (0 != discover_insert_node(discover, node)) {
+                /* Unable to add the node to the index */
+                discover_free_node(discover, node);
+                node = NULL;
+            } else {
+                __atomic_add_fetch(&discover->nodes.version, 1, __ATOMIC_RELEASE);
+                __atomic_add_fetch(&discover->stats.nodes_added, 1, __ATOMIC_RELAXED);
+            }
         }
     }
 
-    /* Release options semaphore */
-    sem_post(&discover->options.sem);
+    /* Check if the node is new */
+    if ((NULL != node) && (true == is_new)) {
+        /* Queue added event if the callback is defined, the node is copied because it may be updated or removed before the callback is invoked */
+        if (NULL != discover->cb.added.fct) {
+            discover_queue_event(discover, DISCOVER_EVENT_ADDED, discover_duplicate_node(node), received);
+        }
+    }
 
-    return ret;
+    /* Check if node is a new master */
+    if ((NULL != node) && (true == node->data.is_master) && ((true == is_new) || (false == was_master))) {
+        /* Queue master event if the callback is defined */
+        if (NULL != discover->cb.master.fct) {
+            discover_queue_event(discover, DISCOVER_EVENT_MASTER, discover_duplicate_node(node), received);
+        }
+    }
+
+    /* Queue helloReceived event if the callback is defined */
+    if ((NULL != node) && (NULL != discover->cb.hello_received.fct)) {
+        discover_queue_event(discover, DISCOVER_EVENT_HELLO_RECEIVED, discover_duplicate_node(node), received);
+    }
+
+    /* Release semaphore */
+    sem_post(&discover->nodes.sem);
+
+    /* Release the advertisement if it has not been moved to the node */
+    if (NULL != advertisement) {
+        cJSON_Delete(advertisement);
+    }
+
+    /* Request the advertisement if it has been omitted and it is unknown */
+    if (true == request) {
+        discover_request_advertisement(discover, pid, iid);
+    }
 }
 
 /**
- * @brief Start discovering
- * @param discover Discover instance
- * @return 0 if the function succeeded, -1 otherwise
+ * @brief Update the advertisement of a node, nodes semaphore must be taken
+ * @param node Node
+ * @param hello Hello message
+ * @param advertisement Advertisement of the sender, set to NULL once moved to the node, NULL if there is none or if it is serialized in the hello message
+ * @return true if the advertisement has been omitted and is unknown, false otherwise
  */
-int
-discover_start(discover_t *discover) {
+static bool
+discover_update_advertisement(discover_node_t *node, wire_hello_t *hello, cJSON **advertisement) {
 
-    assert(NULL != discover);
+    /* Nothing to do if the advertisement has not changed */
+    if ((0 != hello->advertisement_hash) && (hello->advertisement_hash == node->data.advertisement_hash)) {
+        return false;
+    }
 
-    /* Wait options semaphore */
-    sem_wait(&discover->options.sem);
+    /* Request the advertisement if it has been omitted */
+    if ((0 != hello->advertisement_hash) && (NULL == *advertisement) && (NULL == hello->advertisement)) {
+        return true;
+    }
 
-    /* Bind socket */
-    if (NULL != discover->options.unicast) {
-        sock_bind_unicast(discover->sock, discover->options.address, discover->options.port, discover->options.reuse_addr, discover->options.unicast);
-    } else if (NULL != discover->options.multicast) {
-        sock_bind_multicast(discover->sock,
-                            discover->options.address,
-                            discover->options.port,
-                            discover->options.reuse_addr,
-                            discover->options.multicast,
-                            discover->options.multicast_ttl);
-    } else {
-        sock_bind_broadcast(discover->sock, discover->options.address, discover->options.port, discover->options.reuse_addr, discover->options.broadcast);
+    /* Move the advertisement to the node, or parse it in place if it is serialized */
+    cJSON *tmp = NULL;
+    if (NULL != *advertisement) {
+        tmp            = *advertisement;
+        *advertisement = NULL;
+    } else if ((NULL != hello->advertisement) && (NULL == (tmp = cJSON_ParseWithLength(hello->advertisement, hello->advertisement_size)))) {
+        /* Invalid advertisement, keep the previous one */
+        return false;
     }
 
-    /* Start periodic "check" task */
-    if (0 != discover_start_check(discover)) {
-        /* Unable to start task */
-        sem_post(&discover->options.sem);
-        return -1;
+    /* Replace the advertisement */
+    if (NULL != node->data.advertisement) {
+        cJSON_Delete(node->data.advertisement);
     }
+    node->data.advertisement      = tmp;
+    node->data.advertisement_hash = hello->advertisement_hash;
 
-    /* Start periodic "hello" task depending of the option */
-    if (false == discover->options.client) {
-        if (0 != discover_start_hello(discover)) {
-            /* Unable to start task */
-            sem_post(&discover->options.sem);
-            return -1;
-        }
+    return false;
+}
+
+/**
+ * @brief Request the advertisement of a node, which sends it with its next hello messages
+ * @param discover Discover instance
+ * @param pid Process UUID of the node
+ * @param iid Instance UUID of the node
+ */
+static void
+discover_request_advertisement(discover_t *discover, char *pid, char *iid) {
+
+    /* Create data object to be transmitted in the advertisement request message */
+    cJSON *data = cJSON_CreateObject();
+    if (NULL == data) {
+        /* Unable to allocate memory */
+        return;
     }
+    cJSON_AddStringToObject(data, "pid", pid);
+    cJSON_AddStringToObject(data, "iid", iid);
 
-    /* Release options semaphore */
-    sem_post(&discover->options.sem);
+    /* Send message */
+    discover_send_reserved(discover, DISCOVER_RESERVED_ADVERTISEMENT_REQUEST, data);
 
-    return 0;
+    /* Release memory */
+    cJSON_Delete(data);
 }
 
 /**
- * @brief Register callbacks
+ * @brief Send a message of a reserved channel to all destinations, the message is never batched nor filtered so that all the receivers handle it
  * @param discover Discover instance
- * @param topic Topic
- * @param fct Callback funtion
- * @param user User data
+ * @param event Event
+ * @param data Data to send
  * @return 0 if the function succeeded, -1 otherwise
  */
-int
-discover_on(discover_t *discover, char *topic, void *fct, void *user) {
+static int
+discover_send_reserved(discover_t *discover, char *event, cJSON *data) {
 
     assert(NULL != discover);
-    assert(NULL != topic);
+    assert(NULL != event);
+    assert(NULL != data);
 
-    /* Record callback depending of the topic */
-    if (!strcmp(topic, "helloReceived")) {
-        discover->cb.hello_received.fct  = fct;
-        discover->cb.hello_received.user = user;
-    } else if (!strcmp(topic, "helloEmitted")) {
-        discover->cb.hello_emitted.fct  = fct;
-        discover->cb.hello_emitted.user = user;
-    } else if (!strcmp(topic, "promotion")) {
-        discover->cb.promotion.fct  = fct;
-        discover->cb.promotion.user = user;
-    } else if (!strcmp(topic, "demotion")) {
-        discover->cb.demotion.fct  = fct;
-        discover->cb.demotion.user = user;
-    } else if (!strcmp(topic, "check")) {
-        discover->cb.check.fct  = fct;
-        discover->cb.check.user = user;
-    } else if (!strcmp(topic, "added")) {
-        discover->cb.added.fct  = fct;
-        discover->cb.added.user = user;
-    } else if (!strcmp(topic, "master")) {
-        discover->cb.master.fct  = fct;
-        discover->cb.master.user = user;
-    } else if (!strcmp(topic, "removed")) {
-        discover->cb.removed.fct  = fct;
-        discover->cb.removed.user = user;
-    } else if (!strcmp(topic, "error")) {
-        discover->cb.error.fct  = fct;
-        discover->cb.error.user = user;
+    /* Wait options semaphore */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+
+    /* Serialize message */
+    char *str = discover_serialize_message(discover, event, data);
+
+    /* Release options semaphore */
+    sem_post(&discover->options.sem);
+
+    /* Check if the message has been serialized */
+    if (NULL == str) {
+        return -1;
     }
 
-    return 0;
+    /* Send to all destinations, the channels joined by the nodes don't apply to the reserved messages, the string is released once sent */
+    return discover_transmit(discover, str, strlen(str));
 }
 
 /**
- * @brief Function used to set advertisement
+ * @brief Send message, encrypted if a key is set
  * @param discover Discover instance
- * @param advertisement Advestisement object
+ * @param buffer Message, released by the function in all cases
+ * @param size Size of the message
  * @return 0 if the function succeeded, -1 otherwise
  */
-int
-discover_advertise(discover_t *discover, cJSON *advertisement) {
+static int
+discover_transmit(discover_t *discover, void *buffer, size_t size) {
 
     assert(NULL != discover);
+    assert(NULL != buffer);
 
-    /* Wait options semaphore */
-    sem_wait(&discover->options.sem);
+    /* Send message to all destinations */
+    return discover_transmit_to(discover, NULL, 0, buffer, size);
+}
 
-    /* Set advertisement */
-    if (NULL != discover->options.advertisement) {
-        cJSON_Delete(discover->options.advertisement);
+/**
+ * @brief Send message to a single destination, or to all destinations, encrypted if a key is set
+ * @param discover Discover instance
+ * @param ip IP address of the destination, NULL to send the message to all destinations
+ * @param port Port of the destination
+ * @param buffer Message, released by the function in all cases
+ * @param size Size of the message
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+discover_transmit_to(discover_t *discover, char *ip, uint16_t port, void *buffer, size_t size) {
+
+    assert(NULL != discover);
+    assert(NULL != buffer);
+
+    /* Encrypt message, a new nonce is used for each message */
+    if (NULL != discover->aead) {
+        void *encrypted = aead_encrypt(discover->aead, buffer, size, &size);
+        free(buffer);
+        if (NULL == encrypted) {
+            /* Unable to encrypt message */
+            return -1;
+        }
+        buffer = encrypted;
     }
-    discover->options.advertisement = (NULL != advertisement) ? cJSON_Duplicate(advertisement, 1) : NULL;
 
-    /* Release options semaphore */
-    sem_post(&discover->options.sem);
+    /* Send message, the buffer is released by the sock instance once sent */
+    int ret = (NULL != ip) ? sock_send_to(discover->sock, ip, port, buffer, size) : sock_send(discover->sock, buffer, size);
+    if (0 != ret) {
+        free(buffer);
+        return -1;
+    }
 
     return 0;
 }
 
 /**
- * @brief Promote the instance to master
+ * @brief Split the unicast addresses, options semaphore must be taken
  * @param discover Discover instance
+ * @param unicast Comma separated string of unicast addresses
  * @return 0 if the function succeeded, -1 otherwise
  */
-int
-discover_promote(discover_t *discover) {
+static int
+discover_parse_unicast(discover_t *discover, char *unicast) {
 
     assert(NULL != discover);
+    assert(NULL != unicast);
+
+    /* Wait nodes semaphore, the channels joined at the addresses are updated when the nodes change */
+    discover_lock(&discover->nodes.sem, &discover->stats.nodes_lock);
+
+    /* Release previous addresses */
+    if (NULL != discover->unicast.addresses) {
+        free(discover->unicast.addresses);
+        free(discover->unicast.buffer);
+        free(discover->unicast.filters);
+        discover->unicast.addresses = NULL;
+        discover->unicast.buffer    = NULL;
+        discover->unicast.filters   = NULL;
+        discover->unicast.count     = 0;
+    }
 
-    discover->is_master          = true;
-    discover->is_master_eligible = true;
+    /* Count the addresses, the messages are sent to all of them when there are too many to be checked */
+    int count = 1;
+    for (char *pch = unicast; '\0' != *pch; pch++) {
+        if (',' == *pch) {
+            count++;
+        }
+    }
+    if (DISCOVER_UNICAST_FILTER_MAX < count) {
+        sem_post(&discover->nodes.sem);
+        return 0;
+    }
+
+    /* Allocate the tables and a copy of the addresses */
+    char *                     buffer    = strdup(unicast);
+    char **                    addresses = (char **)malloc(count * sizeof(char *));
+    discover_unicast_filter_t *filters   = (discover_unicast_filter_t *)malloc(count * sizeof(discover_unicast_filter_t));
+    if ((NULL == buffer) || (NULL == addresses) || (NULL == filters)) {
+        /* Unable to allocate memory */
+        free(buffer);
+        free(addresses);
+        free(filters);
+        sem_post(&discover->nodes.sem);
+        return -1;
+    }
+    memset(filters, 0, count * sizeof(discover_unicast_filter_t));
+
+    /* Split the addresses in place */
+    char *saveptr = NULL;
+    char *pch     = strtok_r(buffer, ",", &saveptr);
+    count         = 0;
+    while (NULL != pch) {
+        addresses[count++] = pch;
+        pch                = strtok_r(NULL, ",", &saveptr);
+    }
+    discover->unicast.buffer    = buffer;
+    discover->unicast.addresses = addresses;
+    discover->unicast.filters   = filters;
+    discover->unicast.count     = count;
+
+    /* Add the nodes already known, loaded from the cache */
+    for (discover_node_t *node = discover->nodes.first; NULL != node; node = node->next) {
+        discover_filter_node(discover, node, 1);
+    }
+
+    /* Release nodes semaphore */
+    sem_post(&discover->nodes.sem);
 
     return 0;
 }
 
 /**
- * @brief Demote the instance from being a master
+ * @brief Send message to the unicast addresses, skipping the ones of the nodes which have not joined the channel of the message
  * @param discover Discover instance
- * @param permanent true to specify that this should not automatically become master again, false otherwise
+ * @param event Event of the message
+ * @param port Port of the destinations
+ * @param buffer Message, released by the function in all cases
+ * @param size Size of the message
  * @return 0 if the function succeeded, -1 otherwise
  */
-int
-discover_demote(discover_t *discover, bool permanent) {
+static int
+discover_transmit_unicast(discover_t *discover, char *event, uint16_t port, void *buffer, size_t size) {
 
     assert(NULL != discover);
+    assert(NULL != event);
+    assert(NULL != buffer);
 
-    discover->is_master          = false;
-    discover->is_master_eligible = !permanent;
+    uint64_t kept    = 0;
+    int      skipped = 0;
+    int      ret     = 0;
+
+    /* Compute the bits of the substrings of the event once for all the addresses */
+    uint8_t   bits[DISCOVER_CHANNELS_FILTER_SIZE];
+    size_t    count  = 0;
+    uint16_t *hashes = discover_hash_event(event, bits, &count);
+    if (NULL == hashes) {
+        /* Unable to allocate memory, send to all addresses */
+        return discover_transmit(discover, buffer, size);
+    }
 
-    return 0;
+    /* Wait nodes semaphore */
+    discover_lock(&discover->nodes.sem, &discover->stats.nodes_lock);
+
+    /* An address is kept if no node is known at this address, if one of its nodes doesn't advertise its channels, or if one of them may have joined the channel */
+    for (int index = 0; index < discover->unicast.count; index++) {
+        discover_unicast_filter_t *filter = &discover->unicast.filters[index];
+        if ((0 == filter->nodes) || (0 < filter->unfiltered) || (true == discover_match_hashes(filter->channels, bits, hashes, count))) {
+            kept |= (uint64_t)1 << index;
+        } else {
+            skipped++;
+        }
+    }
+
+    /* Release nodes semaphore */
+    sem_post(&discover->nodes.sem);
+
+    /* Release memory */
+    free(hashes);
+
+    /* Send to all addresses at once if none is skipped */
+    if (0 == skipped) {
+        return discover_transmit(discover, buffer, size);
+    }
+    __atomic_add_fetch(&discover->stats.tx_filtered, skipped, __ATOMIC_RELAXED);
+
+    /* Send a copy of the message to each address kept, the message itself is sent to the last one */
+    for (int index = 0; (index < discover->unicast.count) && (0 != kept); index++) {
+        if (0 == (kept & ((uint64_t)1 << index))) {
+            continue;
+        }
+        kept &= ~((uint64_t)1 << index);
+        void *copy = buffer;
+        if (0 != kept) {
+            if (NULL == (copy = malloc(size))) {
+                /* Unable to allocate memory */
+                ret = -1;
+                continue;
+            }
+            memcpy(copy, buffer, size);
+        } else {
+            buffer = NULL;
+        }
+        if (0 != discover_transmit_to(discover, discover->unicast.addresses[index], port, copy, size)) {
+            ret = -1;
+        }
+    }
+
+    /* Release memory if the message has not been sent */
+    if (NULL != buffer) {
+        free(buffer);
+    }
+
+    return ret;
 }
 
 /**
- * @brief Subscribe to wanted event
+ * @brief Load the nodes of the cache file, they are stale until they are seen, options semaphore must be taken
  * @param discover Discover instance
- * @param event Event
- * @param fct Callback funtion
- * @param user User data
- * @return 0 if the function succeeded, -1 otherwise
  */
-int
-discover_join(discover_t *discover, char *event, void *fct, void *user) {
+static void
+discover_load_cache(discover_t *discover) {
 
     assert(NULL != discover);
-    assert(NULL != event);
+    assert(NULL != discover->options.cache_file);
 
-    int                 ret          = 0;
-    discover_channel_t *last_channel = NULL;
+    /* Open the cache file, nothing is loaded if it doesn't exist or if it is invalid */
+    cache_t *cache = cache_open(discover->options.cache_file);
+    if (NULL == cache) {
+        return;
+    }
 
     /* Wait semaphore */
-    sem_wait(&discover->channels.sem);
-
-    /* Parse channels, update callback and user data if event is found */
-    discover_channel_t *curr_channel = discover->channels.first;
-    while (NULL != curr_channel) {
-        if (!strcmp(event, curr_channel->event)) {
-            curr_channel->fct  = fct;
-            curr_channel->user = user;
-            goto LEAVE;
+    discover_lock(&discover->nodes.sem, &discover->stats.nodes_lock);
+
+    /* Add the nodes, they are removed if they are not seen before their timeout */
+    uint64_t now   = discover_get_time();
+    size_t   count = cache_count(cache);
+    for (size_t index = 0; index < count; index++) {
+        cache_node_t entry;
+        /* Invalid nodes and nodes already known are skipped */
+        if ((0 != cache_read_node(cache, index, &entry)) || (NULL != discover_lookup_node(discover, entry.pid, entry.iid))) {
+            continue;
+        }
+        discover_node_t *node = discover_alloc_node(discover);
+        if (NULL == node) {
+            /* Unable to allocate memory */
+            break;
+        }
+        strcpy(node->pid, entry.pid);
+        strcpy(node->iid, entry.iid);
+        discover_update_buffer(node->address, sizeof(node->address), entry.address);
+        discover_update_buffer(node->data.address, sizeof(node->data.address), entry.bound_address);
+        node->hostname                = (NULL != entry.hostname) ? strdup(entry.hostname) : NULL;
+        node->port                    = entry.port;
+        node->last_seen               = entry.last_seen;
+        node->last_seen_ms            = now;
+        node->data.is_master          = entry.is_master;
+        node->data.is_master_eligible = entry.is_master_eligible;
+        node->data.weight             = entry.weight;
+        node->data.stale              = true;
+        /* The hash is kept only if the advertisement is valid, otherwise the advertisement is requested once the node is seen */
+        if ((NULL != entry.advertisement) && (NULL != (node->data.advertisement = cJSON_ParseWithLength(entry.advertisement, entry.advertisement_size)))) {
+            node->data.advertisement_hash = entry.advertisement_hash;
+        }
+        DISCOVER_RECORD(node)->deadline = now + ((true == node->data.is_master) ? discover->options.master_timeout : discover->options.node_timeout);
+        if (0 != discover_insert_node(discover, node)) {
+            /* Unable to add the node to the index */
+            discover_free_node(discover, node);
+            break;
         }
-        last_channel = curr_channel;
-        curr_channel = curr_channel->next;
     }
 
-    /* Channel not found, add a new one */
-    discover_channel_t *new_channel = (discover_channel_t *)malloc(sizeof(discover_channel_t));
-    if (NULL == new_channel) {
-        /* Unable to allocate memory */
-        ret = -1;
-        goto LEAVE;
+    /* The cache file is written again only once the nodes have changed */
+    __atomic_add_fetch(&discover->nodes.version, 1, __ATOMIC_RELEASE);
+    discover->cache.version = discover->nodes.version;
+
+    /* Release semaphore */
+    sem_post(&discover->nodes.sem);
+
+    /* Release cache instance */
+    cache_close(cache);
+}
+
+/**
+ * @brief Add the addresses of the nodes to the unicast addresses, options semaphore must be taken
+ * @param discover Discover instance
+ * @return Comma separated string of unicast addresses if the function succeeded, NULL otherwise, it must be released by the caller
+ */
+static char *
+discover_seed_unicast(discover_t *discover) {
+
+    assert(NULL != discover);
+    assert(NULL != discover->options.unicast);
+
+    /* Wait semaphore */
+    discover_lock(&discover->nodes.sem, &discover->stats.nodes_lock);
+
+    /* Allocate memory for the unicast addresses and the addresses of all the nodes */
+    size_t size = strlen(discover->options.unicast) + 1;
+    for (discover_node_t *node = discover->nodes.first; NULL != node; node = node->next) {
+        size += strlen(node->address) + 1;
     }
-    memset(new_channel, 0, sizeof(discover_channel_t));
-    new_channel->event = strdup(event);
-    if (NULL == new_channel->event) {
+    char *unicast = (char *)malloc(size);
+    if (NULL == unicast) {
         /* Unable to allocate memory */
-        free(new_channel);
-        ret = -1;
-        goto LEAVE;
+        sem_post(&discover->nodes.sem);
+        return NULL;
     }
-    new_channel->fct  = fct;
-    new_channel->user = user;
-    if (NULL != last_channel) {
-        last_channel->next = new_channel;
-    } else {
-        discover->channels.first = new_channel;
+    strcpy(unicast, discover->options.unicast);
+
+    /* Add the addresses of the nodes which are not already in the list */
+    for (discover_node_t *node = discover->nodes.first; NULL != node; node = node->next) {
+        size_t length = strlen(node->address);
+        bool   found  = (0 == length) ? true : false;
+        for (char *pch = unicast; (NULL != pch) && (false == found); pch = strchr(pch, ',')) {
+            pch += (',' == *pch) ? 1 : 0;
+            found = ((0 == strncmp(pch, node->address, length)) && ((',' == pch[length]) || ('\0' == pch[length]))) ? true : false;
+        }
+        if (false == found) {
+            strcat(unicast, ",");
+            strcat(unicast, node->address);
+        }
     }
 
-LEAVE:
-
     /* Release semaphore */
-    sem_post(&discover->channels.sem);
+    sem_post(&discover->nodes.sem);
 
-    return ret;
+    return unicast;
 }
 
 /**
- * @brief Leave channel
+ * @brief Write the cache file if the nodes have changed since it has been written
  * @param discover Discover instance
- * @param event Event
- * @return 0 if the function succeeded, -1 otherwise
  */
-int
-discover_leave(discover_t *discover, char *event) {
+static void
+discover_save_cache(discover_t *discover) {
 
     assert(NULL != discover);
-    assert(NULL != event);
 
-    discover_channel_t *last_channel = NULL;
+    /* Nothing to do if the nodes have not changed since the cache file has been written */
+    if (__atomic_load_n(&discover->nodes.version, __ATOMIC_ACQUIRE) == discover->cache.version) {
+        return;
+    }
 
-    /* Wait semaphore */
-    sem_wait(&discover->channels.sem);
+    /* Retrieve the path of the cache file */
+    discover_lock(&discover->options.sem, &discover->stats.options_lock);
+    char *path = (NULL != discover->options.cache_file) ? strdup(discover->options.cache_file) : NULL;
+    sem_post(&discover->options.sem);
+    if (NULL == path) {
+        return;
+    }
 
-    /* Parse channels, remove channel if event is found */
-    discover_channel_t *curr_channel = discover->channels.first;
-    while (NULL != curr_channel) {
-        if (!strcmp(event, curr_channel->event)) {
-            if (discover->channels.first == curr_channel) {
-                discover->channels.first = curr_channel->next;
-            } else {
-                last_channel->next = curr_channel->next;
+    /* Write the nodes of a snapshot, so that the nodes are not locked while writing the file */
+    discover_nodes_snapshot_t *snapshot = discover_nodes_snapshot(discover);
+    cache_node_t *             entries  = NULL;
+    if ((NULL != snapshot) && ((0 == snapshot->count) || (NULL != (entries = (cache_node_t *)malloc(snapshot->count * sizeof(cache_node_t)))))) {
+        for (size_t index = 0; index < snapshot->count; index++) {
+            discover_node_t *node  = &snapshot->nodes[index];
+            cache_node_t *   entry = &entries[index];
+            memset(entry, 0, sizeof(cache_node_t));
+            strcpy(entry->pid, node->pid);
+            strcpy(entry->iid, node->iid);
+            strcpy(entry->address, node->address);
+            strcpy(entry->bound_address, node->data.address);
+            entry->hostname           = node->hostname;
+            entry->port               = node->port;
+            entry->last_seen          = node->last_seen;
+            entry->is_master          = node->data.is_master;
+            entry->is_master_eligible = node->data.is_master_eligible;
+            entry->weight             = node->data.weight;
+            entry->advertisement_hash = node->data.advertisement_hash;
+            if ((NULL != node->data.advertisement) && (NULL != (entry->advertisement = cJSON_PrintUnformatted(node->data.advertisement)))) {
+                entry->advertisement_size = (uint32_t)strlen(entry->advertisement);
             }
-            free(curr_channel->event);
-            free(curr_channel);
-            goto LEAVE;
         }
-        last_channel = curr_channel;
-        curr_channel = curr_channel->next;
+        /* The file is written again at the next check if it fails */
+        if (0 == cache_write(path, entries, snapshot->count)) {
+            discover->cache.version = snapshot->version;
+        }
+        for (size_t index = 0; index < snapshot->count; index++) {
+            if (NULL != entries[index].advertisement) {
+                free(entries[index].advertisement);
+            }
+        }
+        free(entries);
     }
 
-LEAVE:
+    /* Release memory */
+    discover_nodes_release(snapshot);
+    free(path);
+}
 
-    /* Release semaphore */
-    sem_post(&discover->channels.sem);
+/**
+ * @brief Callback function called to handle error from sock instance
+ * @param sock Sock instance
+ * @param err Error as string
+ * @param user User data
+ */
+static void
+discover_error_cb(sock_t *sock, char *err, void *user) {
 
-    return 0;
+    (void)sock;
+    assert(NULL != err);
+    assert(NULL != user);
+
+    /* Retrieve discover instance using user data */
+    discover_t *discover = (discover_t *)user;
+
+    /* Invoke error callback if defined */
+    if (NULL != discover->cb.error.fct) {
+        discover->cb.error.fct(discover, err, discover->cb.error.user);
+    }
 }
 
 /**
- * @brief Function used to send event data
- * @param discover Discover instance
- * @param event Event
- * @param data Data to send
+ * @brief Generate UUID V4
+ * @param buf Buffer to store UUID
  * @return 0 if the function succeeded, -1 otherwise
  */
-int
-discover_send(discover_t *discover, char *event, cJSON *data) {
+static int
+discover_generate_uuid(char **buf) {
 
-    assert(NULL != discover);
-    assert(NULL != event);
-    assert(NULL != data);
+    assert(NULL != buf);
 
-    /* Create message */
-    cJSON *msg = cJSON_CreateObject();
-    if (NULL == msg) {
+    /* Generate new UUID */
+    UUID4_STATE_T state;
+    UUID4_T       uuid;
+    uuid4_seed(&state);
+    uuid4_gen(&state, &uuid);
+
+    /* Convert UUID to string */
+    if (NULL == (*buf = (char *)malloc(UUID4_STR_BUFFER_SIZE + 1))) {
         /* Unable to allocate memory */
         return -1;
     }
-
-    /* Wait options semaphore */
-    sem_wait(&discover->options.sem);
-
-    /* Add fields to the message */
-    cJSON_AddStringToObject(msg, "event", event);
-    cJSON_AddStringToObject(msg, "pid", discover->pid);
-    cJSON_AddStringToObject(msg, "iid", discover->iid);
-    cJSON_AddStringToObject(msg, "hostName", discover->options.hostname);
-    cJSON_AddItemToObject(msg, "data", cJSON_Duplicate(data, 1));
-
-    /* Release options semaphore */
-    sem_post(&discover->options.sem);
-
-    /* Print to string */
-    char *str = cJSON_PrintUnformatted(msg);
-    if (NULL != str) {
-        /* Send */
-        sock_send(discover->sock, str, strlen(str));
+    memset(*buf, 0, UUID4_STR_BUFFER_SIZE + 1);
+    if (false == uuid4_to_s(uuid, *buf, UUID4_STR_BUFFER_SIZE)) {
+        /* Unable to generate UUID */
+        return -1;
     }
 
-    /* Release memory */
-    cJSON_Delete(msg);
-
     return 0;
 }
 
 /**
- * @brief Release discover instance
- * @param discover Discover instance
+ * @brief Retrieve the current time of the monotonic clock
+ * @return Time in milliseconds
  */
-void
-discover_release(discover_t *discover) {
+static uint64_t
+discover_get_time(void) {
 
-    /* Release discover instance */
-    if (NULL != discover) {
-
-        /* Release sock instance */
-        sock_release(discover->sock);
+    /* The monotonic clock is not affected by the changes of the system time */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
 
-        /* Stop hello thread */
-        if (false == discover->options.client) {
-            pthread_cancel(discover->thread_hello);
-            pthread_join(discover->thread_hello, NULL);
-        }
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
 
-        /* Stop check thread */
-        pthread_cancel(discover->thread_check);
-        pthread_join(discover->thread_check, NULL);
+/**
+ * @brief Retrieve the current time of the monotonic clock
+ * @return Time in microseconds
+ */
+static uint64_t
+discover_get_time_us(void) {
 
-        /* Release channels */
-        sem_wait(&discover->channels.sem);
-        discover_channel_t *curr_channel = discover->channels.first;
-        while (NULL != curr_channel) {
-            discover_channel_t *tmp = curr_channel;
-            curr_channel            = curr_channel->next;
-            if (NULL != tmp->event) {
-                free(tmp->event);
-            }
-            free(tmp);
-        }
-        sem_post(&discover->channels.sem);
-        sem_close(&discover->channels.sem);
+    /* The monotonic clock is not affected by the changes of the system time */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
 
-        /* Release nodes */
-        sem_wait(&discover->nodes.sem);
-        discover_node_t *node = discover->nodes.first;
-        while (NULL != node) {
-            discover_node_t *tmp = node;
-            node                 = node->next;
-            if (NULL != tmp->pid) {
-                free(tmp->pid);
-            }
-            if (NULL != tmp->iid) {
-                free(tmp->iid);
-            }
-            if (NULL != tmp->hostname) {
-                free(tmp->hostname);
-            }
-            if (NULL != tmp->address) {
-                free(tmp->address);
-            }
-            if (NULL != tmp->data.address) {
-                free(tmp->data.address);
-            }
-            if (NULL != tmp->data.advertisement) {
-                cJSON_Delete(tmp->data.advertisement);
-            }
-            free(tmp);
-        }
-        sem_post(&discover->nodes.sem);
-        sem_close(&discover->nodes.sem);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
 
-        /* Release UUIDs */
-        if (NULL != discover->pid) {
-            free(discover->pid);
-        }
-        if (NULL != discover->iid) {
-            free(discover->iid);
-        }
+/**
+ * @brief Wait a semaphore, the time spent waiting is measured only if it is already taken
+ * @param sem Semaphore
+ * @param stats Lock statistics
+ */
+static void
+discover_lock(sem_t *sem, discover_lock_stats_t *stats) {
 
-        /* Release options */
-        sem_wait(&discover->options.sem);
-        if (NULL != discover->options.address) {
-            free(discover->options.address);
-        }
-        if (NULL != discover->options.broadcast) {
-            free(discover->options.broadcast);
-        }
-        if (NULL != discover->options.multicast) {
-            free(discover->options.multicast);
-        }
-        if (NULL != discover->options.unicast) {
-            free(discover->options.unicast);
-        }
-        if (NULL != discover->options.key) {
-            free(discover->options.key);
-        }
-        if (NULL != discover->options.advertisement) {
-            cJSON_Delete(discover->options.advertisement);
-        }
-        if (NULL != discover->options.hostname) {
-            free(discover->options.hostname);
-        }
-        sem_post(&discover->options.sem);
-        sem_close(&discover->options.sem);
+    assert(NULL != sem);
+    assert(NULL != stats);
 
-        /* Release discover instance */
-        free(discover);
+    /* Nothing to measure if the semaphore is available */
+    if (0 == sem_trywait(sem)) {
+        return;
     }
+
+    /* Wait the semaphore */
+    uint64_t start = discover_get_time_us();
+    sem_wait(sem);
+    __atomic_add_fetch(&stats->contended, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->wait, discover_get_time_us() - start, __ATOMIC_RELAXED);
 }
 
 /**
- * @brief Start hello thread
- * @param discover Discover instance
- * @return 0 if the function succeeded, -1 otherwise
+ * @brief Add a sample to a latency histogram
+ * @param histogram Latency histogram
+ * @param value Latency in microseconds
  */
-static int
-discover_start_hello(discover_t *discover) {
+static void
+discover_record_latency(discover_histogram_t *histogram, uint64_t value) {
 
-    /* Initialize attributes of the thread */
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    assert(NULL != histogram);
 
-    /* Start thread */
-    if (0 != pthread_create(&discover->thread_hello, &attr, discover_thread_hello, (void *)discover)) {
-        /* Unable to start the thread */
-        return -1;
+    /* The bucket is the number of significant bits of the value */
+    int bucket = (0 == value) ? 0 : 64 - __builtin_clzll(value);
+    if (DISCOVER_HISTOGRAM_SIZE <= bucket) {
+        bucket = DISCOVER_HISTOGRAM_SIZE - 1;
     }
 
-    return 0;
+    /* Update the counters, they are shared by the threads so they are updated atomically */
+    __atomic_add_fetch(&histogram->buckets[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&histogram->count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&histogram->sum, value, __ATOMIC_RELAXED);
 }
 
 /**
- * @brief Thread used to periodically send the hello message
- * @param arg Discover instance
- * @return Always returns NULL
+ * @brief Read a latency histogram
+ * @param histogram Latency histogram
+ * @param copy Copy of the histogram
  */
-static void *
-discover_thread_hello(void *arg) {
-
-    assert(NULL != arg);
-
-    /* Retrieve discover */
-    discover_t *discover = (discover_t *)arg;
-
-    /* Infinite loop */
-    while (1) {
+static void
+discover_read_histogram(discover_histogram_t *histogram, discover_histogram_t *copy) {
 
-        /* Create data object to be transmitted in the "hello" message */
-        cJSON *data = cJSON_CreateObject();
-        if (NULL != data) {
-            cJSON *is_master = cJSON_CreateBool(discover->is_master);
-            if (NULL != is_master) {
-                cJSON_AddItemToObject(data, "isMaster", is_master);
-            }
-            cJSON *is_master_eligible = cJSON_CreateBool(discover->is_master_eligible);
-            if (NULL != is_master_eligible) {
-                cJSON_AddItemToObject(data, "isMasterEligible", is_master_eligible);
-            }
-            sem_wait(&discover->options.sem);
-            cJSON_AddNumberToObject(data, "weight", discover->options.weight);
-            if (NULL != discover->options.address) {
-                cJSON_AddStringToObject(data, "address", discover->options.address);
-            }
-            if (NULL != discover->options.advertisement) {
-                cJSON_AddItemToObject(data, "advertisement", cJSON_Duplicate(discover->options.advertisement, 1));
-            }
-            sem_post(&discover->options.sem);
+    assert(NULL != histogram);
+    assert(NULL != copy);
 
-            /* Send message */
-            discover_send(discover, "hello", data);
+    /* Read the counters */
+    for (int bucket = 0; bucket < DISCOVER_HISTOGRAM_SIZE; bucket++) {
+        copy->buckets[bucket] = __atomic_load_n(&histogram->buckets[bucket], __ATOMIC_RELAXED);
+    }
+    copy->count = __atomic_load_n(&histogram->count, __ATOMIC_RELAXED);
+    copy->sum   = __atomic_load_n(&histogram->sum, __ATOMIC_RELAXED);
+}
 
-            /* Invoke helloEmitted callback if defined */
-            if (NULL != discover->cb.hello_emitted.fct) {
-                discover->cb.hello_emitted.fct(discover, discover->cb.hello_emitted.user);
-            }
+/**
+ * @brief Compute the hash of the Process and Instance UUIDs of a node
+ * @param pid Process UUID
+ * @param iid Instance UUID
+ * @return Hash value
+ */
+static uint64_t
+discover_hash_node(const char *pid, const char *iid) {
 
-            /* Release memory */
-            cJSON_Delete(data);
-        }
+    /* FNV-1a hash of both UUIDs, separated by a null character */
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char *pch = pid; '\0' != *pch; pch++) {
+        hash = (hash ^ (unsigned char)*pch) * 1099511628211ULL;
+    }
+    hash *= 1099511628211ULL;
+    for (const char *pch = iid; '\0' != *pch; pch++) {
+        hash = (hash ^ (unsigned char)*pch) * 1099511628211ULL;
+    }
 
-        /* Wait options semaphore */
-        sem_wait(&discover->options.sem);
+    return hash;
+}
 
-        /* Retrieve hello interval value */
-        int hello_interval = discover->options.hello_interval;
+/**
+ * @brief Search a node in the index, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @param pid Process UUID
+ * @param iid Instance UUID
+ * @return Node if it is found, NULL otherwise
+ */
+static discover_node_t *
+discover_lookup_node(discover_t *discover, const char *pid, const char *iid) {
 
-        /* Release options semaphore */
-        sem_post(&discover->options.sem);
+    /* Check if the index is empty */
+    if (NULL == discover->nodes.buckets) {
+        return NULL;
+    }
 
-        /* Sleep until the next loop */
-        usleep(hello_interval * 1000);
+    /* Parse the nodes of the bucket, the hash is compared first to avoid string comparisons */
+    uint64_t         hash = discover_hash_node(pid, iid);
+    discover_node_t *node = discover->nodes.buckets[hash & (discover->nodes.size - 1)];
+    while (NULL != node) {
+        if ((DISCOVER_RECORD(node)->hash == hash) && (!strcmp(pid, node->pid)) && (!strcmp(iid, node->iid))) {
+            return node;
+        }
+        node = DISCOVER_RECORD(node)->hnext;
     }
 
     return NULL;
 }
 
 /**
- * @brief Start check thread
+ * @brief Add a node at the end of the list and in the index, nodes semaphore must be taken
  * @param discover Discover instance
+ * @param node Node
  * @return 0 if the function succeeded, -1 otherwise
  */
 static int
-discover_start_check(discover_t *discover) {
+discover_insert_node(discover_t *discover, discover_node_t *node) {
+
+    /* Grow the index and the heap when there are more nodes than buckets */
+    if (discover->nodes.count >= discover->nodes.size) {
+        size_t            size = (0 == discover->nodes.size) ? 64 : 2 * discover->nodes.size;
+        discover_node_t **heap = (discover_node_t **)realloc(discover->nodes.heap, size * sizeof(discover_node_t *));
+        if (NULL == heap) {
+            /* Unable to allocate memory */
+            return -1;
+        }
+        discover->nodes.heap      = heap;
+        discover_node_t **buckets = (discover_node_t **)malloc(size * sizeof(discover_node_t *));
+        if (NULL == buckets) {
+            /* Unable to allocate memory */
+            return -1;
+        }
+        memset(buckets, 0, size * sizeof(discover_node_t *));
+        for (discover_node_t *curr = discover->nodes.first; NULL != curr; curr = curr->next) {
+            discover_record_t *record          = DISCOVER_RECORD(curr);
+            record->hnext                      = buckets[record->hash & (size - 1)];
+            buckets[record->hash & (size - 1)] = curr;
+        }
+        if (NULL != discover->nodes.buckets) {
+            free(discover->nodes.buckets);
+        }
+        discover->nodes.buckets = buckets;
+        discover->nodes.size    = size;
+    }
 
-    /* Initialize attributes of the thread */
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    /* Add the node to the index */
+    discover_record_t *record       = DISCOVER_RECORD(node);
+    record->hash                    = discover_hash_node(node->pid, node->iid);
+    size_t bucket                   = record->hash & (discover->nodes.size - 1);
+    record->hnext                   = discover->nodes.buckets[bucket];
+    discover->nodes.buckets[bucket] = node;
+
+    /* Add the node to the heap, to the counters and to the indexes */
+    record->position                            = discover->nodes.count;
+    discover->nodes.heap[discover->nodes.count] = node;
+    discover->nodes.count++;
+    discover_update_node(discover, node);
+    discover_count_node(discover, node, 1);
+    discover_filter_node(discover, node, 1);
+    discover_index_node(discover, node, true);
+
+    /* Add the node at the end of the list */
+    node->next = NULL;
+    if (NULL == discover->nodes.last) {
+        node->prev            = NULL;
+        discover->nodes.first = discover->nodes.last = node;
+    } else {
+        node->prev                 = discover->nodes.last;
+        discover->nodes.last->next = node;
+        discover->nodes.last       = node;
+    }
 
-    /* Start thread */
-    if (0 != pthread_create(&discover->thread_check, &attr, discover_thread_check, (void *)discover)) {
-        /* Unable to start the thread */
-        return -1;
+    return 0;
+}
+
+/**
+ * @brief Remove a node from the list and from the index, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @param node Node
+ */
+static void
+discover_remove_node(discover_t *discover, discover_node_t *node) {
+
+    /* Remove the node from the counters and from the indexes */
+    discover_count_node(discover, node, -1);
+    discover_filter_node(discover, node, -1);
+    discover_index_node(discover, node, false);
+
+    /* Remove the node from the heap, the last node of the heap takes its place */
+    discover_record_t *record = DISCOVER_RECORD(node);
+    discover_node_t *  last   = discover->nodes.heap[--discover->nodes.count];
+    if (last != node) {
+        DISCOVER_RECORD(last)->position        = record->position;
+        discover->nodes.heap[record->position] = last;
+        discover_update_node(discover, last);
     }
 
-    return 0;
+    /* Remove the node from the index */
+    discover_node_t **curr = &discover->nodes.buckets[record->hash & (discover->nodes.size - 1)];
+    while (NULL != *curr) {
+        if (node == *curr) {
+            *curr = record->hnext;
+            break;
+        }
+        curr = &DISCOVER_RECORD(*curr)->hnext;
+    }
+
+    /* Remove the node from the list */
+    if (NULL != node->prev) {
+        node->prev->next = node->next;
+    } else {
+        discover->nodes.first = node->next;
+    }
+    if (NULL != node->next) {
+        node->next->prev = node->prev;
+    } else {
+        discover->nodes.last = node->prev;
+    }
 }
 
 /**
- * @brief Thread used to periodically refresh the presence of other nodes
- * @param arg Discover instance
- * @return Always returns NULL
+ * @brief Move a node in the expiry heap after its deadline has changed, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @param node Node
  */
-static void *
-discover_thread_check(void *arg) {
+static void
+discover_update_node(discover_t *discover, discover_node_t *node) {
 
-    assert(NULL != arg);
+    discover_node_t **heap     = discover->nodes.heap;
+    uint64_t          deadline = DISCOVER_RECORD(node)->deadline;
+    size_t            position = DISCOVER_RECORD(node)->position;
 
-    /* Retrieve discover */
-    discover_t *discover = (discover_t *)arg;
+    /* Move the node up while its deadline is earlier than the one of its parent */
+    while ((0 < position) && (deadline < DISCOVER_RECORD(heap[(position - 1) / 2])->deadline)) {
+        heap[position]                            = heap[(position - 1) / 2];
+        DISCOVER_RECORD(heap[position])->position = position;
+        position                                  = (position - 1) / 2;
+    }
 
-    /* Infinite loop */
+    /* Move the node down while its deadline is later than the one of its children */
     while (1) {
+        size_t child = 2 * position + 1;
+        if (child >= discover->nodes.count) {
+            break;
+        }
+        if ((child + 1 < discover->nodes.count) && (DISCOVER_RECORD(heap[child + 1])->deadline < DISCOVER_RECORD(heap[child])->deadline)) {
+            child++;
+        }
+        if (DISCOVER_RECORD(heap[child])->deadline >= deadline) {
+            break;
+        }
+        heap[position]                            = heap[child];
+        DISCOVER_RECORD(heap[position])->position = position;
+        position                                  = child;
+    }
+
+    /* Store the node at its new position */
+    heap[position]                  = node;
+    DISCOVER_RECORD(node)->position = position;
+}
 
-        /* Flags */
-        int  masters_found                        = 0;
-        int  masters_higher_weight_found          = 0;
-        bool masters_eligible_higher_weight_found = false;
+/**
+ * @brief Add or remove a node from the master election counters, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @param node Node
+ * @param delta 1 to add the node, -1 to remove it
+ */
+static void
+discover_count_node(discover_t *discover, discover_node_t *node, int delta) {
+
+    if (true == node->data.is_master) {
+        /* One master found */
+        discover->nodes.masters += delta;
+        if (discover->nodes.weight < node->data.weight) {
+            /* Its weight is higher */
+            discover->nodes.masters_higher_weight += delta;
+        }
+    } else if (true == node->data.is_master_eligible) {
+        /* One eligible master found */
+        if (discover->nodes.weight < node->data.weight) {
+            /* Its weight is higher */
+            discover->nodes.eligibles_higher_weight += delta;
+        }
+    }
+}
 
-        /* Wait semaphores */
-        sem_wait(&discover->nodes.sem);
-        sem_wait(&discover->options.sem);
+/**
+ * @brief Add or remove a node from the channels joined by the nodes of its unicast address, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @param node Node
+ * @param delta 1 to add the node, -1 to remove it
+ */
+static void
+discover_filter_node(discover_t *discover, discover_node_t *node, int delta) {
 
-        /* Parse all nodes in the list */
-        discover_node_t *node = discover->nodes.first;
-        while (NULL != node) {
-            discover_node_t *tmp = node;
-            node                 = node->next;
-            time_t now           = time(NULL);
-            if ((now < tmp->last_seen)
-                || (now - tmp->last_seen > (((true == tmp->data.is_master) ? discover->options.master_timeout : discover->options.node_timeout) / 1000))) {
-                /* Node is no more alive, remove it from the list */
-                if (NULL != tmp->prev) {
-                    tmp->prev->next = tmp->next;
-                } else {
-                    discover->nodes.first = tmp->next;
+    /* Update the unicast addresses to which the node is bound */
+    for (int index = 0; index < discover->unicast.count; index++) {
+        if (0 != strcmp(node->address, discover->unicast.addresses[index])) {
+            continue;
+        }
+        discover_unicast_filter_t *filter = &discover->unicast.filters[index];
+        filter->nodes += delta;
+        if (false == node->data.filtered) {
+            /* The node may have joined all the channels */
+            filter->unfiltered += delta;
+            continue;
+        }
+        /* Count the bits of the bloom filter of the node, a bit of the union is set as long as one node sets it */
+        for (int byte = 0; byte < DISCOVER_CHANNELS_FILTER_SIZE; byte++) {
+            for (int bit = 0; (bit < 8) && (0 != node->data.channels[byte]); bit++) {
+                if (0 == (node->data.channels[byte] & (1 << bit))) {
+                    continue;
                 }
-                if (NULL != tmp->next) {
-                    tmp->next->prev = tmp->prev;
+                filter->bits[8 * byte + bit] += delta;
+                if (0 < filter->bits[8 * byte + bit]) {
+                    filter->channels[byte] |= (uint8_t)(1 << bit);
                 } else {
-                    discover->nodes.last = tmp->prev;
-                }
-                /* Invoke removed callback if defined */
-                if (NULL != discover->cb.removed.fct) {
-                    discover->cb.removed.fct(discover, tmp, discover->cb.removed.user);
-                }
-                /* Release memory */
-                if (NULL != tmp->pid) {
-                    free(tmp->pid);
-                }
-                if (NULL != tmp->iid) {
-                    free(tmp->iid);
-                }
-                if (NULL != tmp->hostname) {
-                    free(tmp->hostname);
-                }
-                if (NULL != tmp->address) {
-                    free(tmp->address);
-                }
-                if (NULL != tmp->data.address) {
-                    free(tmp->data.address);
-                }
-                if (NULL != tmp->data.advertisement) {
-                    cJSON_Delete(tmp->data.advertisement);
-                }
-                free(tmp);
-            } else {
-                if ((true == tmp->data.is_master) && (discover->options.master_timeout > now - tmp->last_seen)) {
-                    /* One master found */
-                    masters_found++;
-                    if (discover->options.weight < tmp->data.weight) {
-                        /* Its weight is higher */
-                        masters_higher_weight_found++;
-                    }
-                }
-                if ((false == tmp->data.is_master) && (true == tmp->data.is_master_eligible)) {
-                    /* One eligible master found */
-                    if (discover->options.weight < tmp->data.weight) {
-                        /* Its weight is higher */
-                        masters_eligible_higher_weight_found = true;
-                    }
+                    filter->channels[byte] &= (uint8_t)~(1 << bit);
                 }
             }
         }
+    }
+}
 
-        /* Check if I need to demote myself */
-        bool was_master = discover->is_master;
-        if ((true == was_master) && (discover->options.masters_required <= masters_higher_weight_found)) {
-            discover->is_master = false;
-            /* Invoke demotion callback if defined */
-            if (NULL != discover->cb.demotion.fct) {
-                discover->cb.demotion.fct(discover, discover->cb.demotion.user);
+/**
+ * @brief Add or remove a node from the indexes of the master and master eligible nodes, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @param node Node
+ * @param add true to add the node, false to remove it
+ */
+static void
+discover_index_node(discover_t *discover, discover_node_t *node, bool add) {
+
+    discover_record_t *record = DISCOVER_RECORD(node);
+
+    /* Index of the master nodes, the node is added after the ones with the same weight */
+    if (true == node->data.is_master) {
+        if (true == add) {
+            discover_node_t *prev = NULL;
+            discover_node_t *next = discover->nodes.master_first;
+            while ((NULL != next) && (next->data.weight >= node->data.weight)) {
+                prev = next;
+                next = DISCOVER_RECORD(next)->mnext;
+            }
+            record->mprev = prev;
+            record->mnext = next;
+            if (NULL != prev) {
+                DISCOVER_RECORD(prev)->mnext = node;
+            } else {
+                discover->nodes.master_first = node;
+            }
+            if (NULL != next) {
+                DISCOVER_RECORD(next)->mprev = node;
+            }
+            discover->nodes.master_count++;
+        } else {
+            if (NULL != record->mprev) {
+                DISCOVER_RECORD(record->mprev)->mnext = record->mnext;
+            } else {
+                discover->nodes.master_first = record->mnext;
             }
+            if (NULL != record->mnext) {
+                DISCOVER_RECORD(record->mnext)->mprev = record->mprev;
+            }
+            record->mprev = NULL;
+            record->mnext = NULL;
+            discover->nodes.master_count--;
         }
+    }
 
-        /* Check if I need to promote myself */
-        if ((false == was_master) && (true == discover->is_master_eligible) && (discover->options.masters_required > masters_higher_weight_found)
-            && (false == masters_eligible_higher_weight_found)) {
-            discover->is_master = true;
-            /* Invoke promotion callback if defined */
-            if (NULL != discover->cb.promotion.fct) {
-                discover->cb.promotion.fct(discover, discover->cb.promotion.user);
+    /* Index of the master eligible nodes, the node is added after the ones with the same weight */
+    if (true == node->data.is_master_eligible) {
+        if (true == add) {
+            discover_node_t *prev = NULL;
+            discover_node_t *next = discover->nodes.eligible_first;
+            while ((NULL != next) && (next->data.weight >= node->data.weight)) {
+                prev = next;
+                next = DISCOVER_RECORD(next)->enext;
+            }
+            record->eprev = prev;
+            record->enext = next;
+            if (NULL != prev) {
+                DISCOVER_RECORD(prev)->enext = node;
+            } else {
+                discover->nodes.eligible_first = node;
             }
+            if (NULL != next) {
+                DISCOVER_RECORD(next)->eprev = node;
+            }
+            discover->nodes.eligible_count++;
+        } else {
+            if (NULL != record->eprev) {
+                DISCOVER_RECORD(record->eprev)->enext = record->enext;
+            } else {
+                discover->nodes.eligible_first = record->enext;
+            }
+            if (NULL != record->enext) {
+                DISCOVER_RECORD(record->enext)->eprev = record->eprev;
+            }
+            record->eprev = NULL;
+            record->enext = NULL;
+            discover->nodes.eligible_count--;
         }
+    }
+}
 
-        /* Invoke check callback if defined */
-        if (NULL != discover->cb.check.fct) {
-            discover->cb.check.fct(discover, discover->cb.check.user);
-        }
+/**
+ * @brief Copy the content of a node, nodes semaphore must be taken
+ * @param copy Copy of the node
+ * @param node Node
+ */
+static void
+discover_copy_node(discover_node_t *copy, discover_node_t *node) {
+
+    assert(NULL != copy);
+    assert(NULL != node);
+
+    /* Copy the node, the hostname and the advertisement are duplicated */
+    memset(copy, 0, sizeof(discover_node_t));
+    strcpy(copy->pid, node->pid);
+    strcpy(copy->iid, node->iid);
+    strcpy(copy->address, node->address);
+    copy->hostname                = (NULL != node->hostname) ? strdup(node->hostname) : NULL;
+    copy->port                    = node->port;
+    copy->last_seen               = node->last_seen;
+    copy->last_seen_ms            = node->last_seen_ms;
+    copy->data.is_master          = node->data.is_master;
+    copy->data.is_master_eligible = node->data.is_master_eligible;
+    copy->data.weight             = node->data.weight;
+    strcpy(copy->data.address, node->data.address);
+    copy->data.advertisement      = (NULL != node->data.advertisement) ? cJSON_Duplicate(node->data.advertisement, 1) : NULL;
+    copy->data.advertisement_hash = node->data.advertisement_hash;
+    copy->data.filtered           = node->data.filtered;
+    memcpy(copy->data.channels, node->data.channels, DISCOVER_CHANNELS_FILTER_SIZE);
+    copy->data.stale              = node->data.stale;
+}
 
-        /* Retrieve check interval value */
-        int check_interval = discover->options.check_interval;
+/**
+ * @brief Duplicate a node, nodes semaphore must be taken
+ * @param node Node
+ * @return Copy of the node if the function succeeded, NULL otherwise, the copy must be released using discover_node_release
+ */
+static discover_node_t *
+discover_duplicate_node(discover_node_t *node) {
 
-        /* Release semaphores */
-        sem_post(&discover->options.sem);
-        sem_post(&discover->nodes.sem);
+    assert(NULL != node);
 
-        /* Sleep until the next loop */
-        usleep(check_interval * 1000);
+    /* Allocate memory */
+    discover_node_t *copy = (discover_node_t *)malloc(sizeof(discover_node_t));
+    if (NULL == copy) {
+        /* Unable to allocate memory */
+        return NULL;
     }
 
-    return NULL;
+    /* Copy the node */
+    discover_copy_node(copy, node);
+
+    return copy;
 }
 
 /**
- * @brief Callback function called to handle received data
- * @param sock Sock instance
- * @param ip IP address of the sender
- * @param port Port of the sender
- * @param buffer Data received
- * @param size Size of data received
- * @param user User data
+ * @brief Release the content of a node
+ * @param node Node
  */
 static void
-discover_message_cb(sock_t *sock, char *ip, uint16_t port, void *buffer, size_t size, void *user) {
-
-    (void)sock;
-    assert(NULL != ip);
-    assert(NULL != buffer);
-    (void)size;
-    assert(NULL != user);
+discover_clear_node(discover_node_t *node) {
 
-    /* Retrieve discover instance using user data */
-    discover_t *discover = (discover_t *)user;
+    assert(NULL != node);
 
-    /* Parse JSON string */
-    cJSON *json = cJSON_Parse(buffer);
-    if (NULL == json) {
-        /* Unable to parse JSON string */
-        return;
+    /* Release the hostname and the advertisement */
+    if (NULL != node->hostname) {
+        free(node->hostname);
+    }
+    if (NULL != node->data.advertisement) {
+        cJSON_Delete(node->data.advertisement);
     }
+}
 
-    /* Wait options semaphore */
-    sem_wait(&discover->options.sem);
+/**
+ * @brief Replace a string if its value has changed
+ * @param str String to be replaced
+ * @param value New value
+ * @return true if the string has changed, false otherwise
+ */
+static bool
+discover_update_string(char **str, const char *value) {
 
-    /* Check Process UUID */
-    cJSON *pid = cJSON_GetObjectItemCaseSensitive(json, "pid");
-    if ((NULL == pid) || (!cJSON_IsString(pid))) {
-        /* No Process UUID, ignore message */
-        sem_post(&discover->options.sem);
-        goto END;
-    } else {
-        if ((true == discover->options.ignore_process) && (!strcmp(cJSON_GetStringValue(pid), discover->pid))) {
-            /* Ignore this message */
-            sem_post(&discover->options.sem);
-            goto END;
-        }
-    }
+    assert(NULL != str);
+    assert(NULL != value);
 
-    /* Check Instance UUID */
-    cJSON *iid = cJSON_GetObjectItemCaseSensitive(json, "iid");
-    if ((NULL == iid) || (!cJSON_IsString(iid))) {
-        /* No Instance UUID, ignore message */
-        sem_post(&discover->options.sem);
-        goto END;
-    } else {
-        if ((true == discover->options.ignore_instance) && (!strcmp(cJSON_GetStringValue(iid), discover->iid))) {
-            /* Ignore this message */
-            sem_post(&discover->options.sem);
-            goto END;
-        }
+    /* Nothing to do if the value has not changed */
+    if ((NULL != *str) && (!strcmp(*str, value))) {
+        return false;
     }
 
-    /* Release options semaphore */
-    sem_post(&discover->options.sem);
+    /* Replace the string */
+    if (NULL != *str) {
+        free(*str);
+    }
+    *str = strdup(value);
 
-    /* Retrieve event */
-    cJSON *event = cJSON_GetObjectItemCaseSensitive(json, "event");
-    if ((NULL != event) && (cJSON_IsString(event))) {
+    return true;
+}
 
-        /* Treatment depending of the event type */
-        if (!strcmp(cJSON_GetStringValue(event), "hello")) {
+/**
+ * @brief Replace the content of a fixed size string if its value has changed, the value is truncated if it is too long
+ * @param str String to be replaced
+ * @param size Size of the string, including the null character
+ * @param value New value
+ * @return true if the string has changed, false otherwise
+ */
+static bool
+discover_update_buffer(char *str, size_t size, const char *value) {
 
-            /* Hello event, retrieve data */
-            cJSON *data = cJSON_GetObjectItemCaseSensitive(json, "data");
-            if ((NULL != data) && (cJSON_IsObject(data))) {
+    assert(NULL != str);
+    assert(0 < size);
+    assert(NULL != value);
 
-                /* Retrieve event fields */
-                cJSON *hostname = cJSON_GetObjectItemCaseSensitive(json, "hostName");
-                if ((NULL == hostname) || (!cJSON_IsString(hostname))) {
-                    /* Invalid message, ignore */
-                    goto END;
-                }
+    /* Nothing to do if the value has not changed */
+    if (!strncmp(str, value, size - 1)) {
+        return false;
+    }
 
-                /* Retrieve data fields */
-                cJSON *is_master = cJSON_GetObjectItemCaseSensitive(data, "isMaster");
-                if ((NULL == is_master) || (!cJSON_IsBool(is_master))) {
-                    /* Invalid message, ignore */
-                    goto END;
-                }
-                cJSON *is_master_eligible = cJSON_GetObjectItemCaseSensitive(data, "isMasterEligible");
-                if ((NULL == is_master_eligible) || (!cJSON_IsBool(is_master_eligible))) {
-                    /* Invalid message, ignore */
-                    goto END;
-                }
-                cJSON *weight = cJSON_GetObjectItemCaseSensitive(data, "weight");
-                if ((NULL == weight) || (!cJSON_IsNumber(weight))) {
-                    /* Invalid message, ignore */
-                    goto END;
-                }
-                cJSON *address = cJSON_GetObjectItemCaseSensitive(data, "address");
-                if ((NULL == address) || (!cJSON_IsString(address))) {
-                    /* Invalid message, ignore */
-                    goto END;
-                }
-                cJSON *advertisement = cJSON_GetObjectItemCaseSensitive(data, "advertisement");
-
-                /* Flags */
-                bool is_new     = false;
-                bool was_master = false;
-
-                /* Wait semaphore */
-                sem_wait(&discover->nodes.sem);
-
-                /* Search node in the list */
-                discover_node_t *node = discover->nodes.first;
-                while (NULL != node) {
-                    if ((!strcmp(cJSON_GetStringValue(pid), node->pid)) && (!strcmp(cJSON_GetStringValue(iid), node->iid))) {
-                        break;
-                    }
-                    node = node->next;
-                }
-                if (NULL != node) {
-                    /* Node found, update the node */
-                    if (NULL != node->hostname) {
-                        free(node->hostname);
-                    }
-                    node->hostname = strdup(cJSON_GetStringValue(hostname));
-                    if (NULL != node->address) {
-                        free(node->address);
-                    }
-                    node->address                 = strdup(ip);
-                    node->port                    = port;
-                    node->last_seen               = time(NULL);
-                    was_master                    = node->data.is_master;
-                    node->data.is_master          = cJSON_IsTrue(is_master) ? true : false;
-                    node->data.is_master_eligible = cJSON_IsTrue(is_master_eligible) ? true : false;
-                    node->data.weight             = cJSON_GetNumberValue(weight);
-                    if (NULL != node->data.address) {
-                        free(node->data.address);
-                    }
-                    node->data.address = strdup(cJSON_GetStringValue(address));
-                    if (NULL != node->data.advertisement) {
-                        cJSON_Delete(node->data.advertisement);
-                    }
-                    if (NULL != advertisement) {
-                        node->data.advertisement = cJSON_Duplicate(advertisement, 1);
-                    } else {
-                        node->data.advertisement = NULL;
-                    }
-                } else {
-                    /* No node found, create a new one and add it at the end of the list */
-                    is_new = true;
-                    node   = (discover_node_t *)malloc(sizeof(discover_node_t));
-                    if (NULL != node) {
-                        memset(node, 0, sizeof(discover_node_t));
-                        node->pid                     = strdup(cJSON_GetStringValue(pid));
-                        node->iid                     = strdup(cJSON_GetStringValue(iid));
-                        node->hostname                = strdup(cJSON_GetStringValue(hostname));
-                        node->address                 = strdup(ip);
-                        node->port                    = port;
-                        node->last_seen               = time(NULL);
-                        node->data.is_master          = cJSON_IsTrue(is_master) ? true : false;
-                        node->data.is_master_eligible = cJSON_IsTrue(is_master_eligible) ? true : false;
-                        node->data.weight             = cJSON_GetNumberValue(weight);
-                        node->data.address            = strdup(cJSON_GetStringValue(address));
-                        if (NULL != advertisement) {
-                            node->data.advertisement = cJSON_Duplicate(advertisement, 1);
-                        }
-                        if (NULL == discover->nodes.last) {
-                            discover->nodes.first = discover->nodes.last = node;
-                        } else {
-                            node->prev                 = discover->nodes.last;
-                            discover->nodes.last->next = node;
-                            discover->nodes.last       = node;
-                        }
-                    }
-                }
+    /* Replace the string */
+    strncpy(str, value, size - 1);
+    str[size - 1] = '\0';
 
-                /* Check if the node is new */
-                if ((NULL != node) && (true == is_new)) {
-                    /* Invoke added callback if defined */
-                    if (NULL != discover->cb.added.fct) {
-                        discover->cb.added.fct(discover, node, discover->cb.added.user);
-                    }
-                }
+    return true;
+}
 
-                /* Check if node is a new master */
-                if ((NULL != node) && (true == node->data.is_master) && ((true == is_new) || (false == was_master))) {
-                    /* Invoke master callback if defined */
-                    if (NULL != discover->cb.master.fct) {
-                        discover->cb.master.fct(discover, node, discover->cb.master.user);
-                    }
-                }
+/**
+ * @brief Allocate a node record from the slabs, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @return Node record cleared if the function succeeded, NULL otherwise
+ */
+static discover_node_t *
+discover_alloc_node(discover_t *discover) {
 
-                /* Release semaphore */
-                sem_post(&discover->nodes.sem);
+    assert(NULL != discover);
 
-                /* Invoke helloReceived callback if defined */
-                if (NULL != discover->cb.hello_received.fct) {
-                    discover->cb.hello_received.fct(discover, node, discover->cb.hello_received.user);
-                }
-            }
+    /* Allocate a new slab if all the records are used */
+    if (NULL == discover->nodes.unused) {
+        discover_nodes_slab_t *slab = (discover_nodes_slab_t *)malloc(sizeof(discover_nodes_slab_t));
+        if (NULL == slab) {
+            /* Unable to allocate memory */
+            return NULL;
+        }
+        slab->next            = discover->nodes.slabs;
+        discover->nodes.slabs = slab;
+        for (size_t index = 0; index < DISCOVER_NODES_SLAB_SIZE; index++) {
+            slab->records[index].node.next = discover->nodes.unused;
+            discover->nodes.unused         = &slab->records[index].node;
+        }
+    }
 
-        } else {
+    /* Take the first record available */
+    discover_node_t *node  = discover->nodes.unused;
+    discover->nodes.unused = node->next;
+    memset(DISCOVER_RECORD(node), 0, sizeof(discover_record_t));
 
-            /* Other event, check channels */
+    return node;
+}
 
-            /* Wait channels semaphore */
-            sem_wait(&discover->channels.sem);
-
-            /* Invoke channel callback(s) if defined */
-            if (NULL != discover->channels.first) {
-
-                /* Parse all channels */
-                discover_channel_t *curr_channel = discover->channels.first;
-                while (NULL != curr_channel) {
-                    if (NULL != curr_channel->fct) {
-                        regex_t regex;
-                        if (0 == regcomp(&regex, curr_channel->event, REG_NOSUB | REG_EXTENDED)) {
-                            if (0 == regexec(&regex, cJSON_GetStringValue(event), 0, NULL, 0)) {
-                                /* Invoke channels callback */
-                                curr_channel->fct(discover, cJSON_GetStringValue(event), json, curr_channel->user);
-                            }
-                            regfree(&regex);
-                        }
-                    }
-                    curr_channel = curr_channel->next;
-                }
-            }
+/**
+ * @brief Release the content of a node and give its record back to the slabs, nodes semaphore must be taken
+ * @param discover Discover instance
+ * @param node Node
+ */
+static void
+discover_free_node(discover_t *discover, discover_node_t *node) {
 
-            /* Release channels semaphore */
-            sem_post(&discover->channels.sem);
-        }
-    }
+    assert(NULL != discover);
+    assert(NULL != node);
 
-END:
+    /* Release the content of the node */
+    discover_clear_node(node);
 
-    /* Release memory */
-    cJSON_Delete(json);
+    /* The record is available again, the slabs are released with the instance */
+    node->next             = discover->nodes.unused;
+    discover->nodes.unused = node;
 }
 
 /**
- * @brief Callback function called to handle error from sock instance
- * @param sock Sock instance
- * @param err Error as string
- * @param user User data
+ * @brief Release a snapshot once its last reference is dropped
+ * @param snapshot Snapshot
  */
 static void
-discover_error_cb(sock_t *sock, char *err, void *user) {
+discover_unref_snapshot(discover_nodes_snapshot_t *snapshot) {
 
-    (void)sock;
-    assert(NULL != err);
-    assert(NULL != user);
+    assert(NULL != snapshot);
 
-    /* Retrieve discover instance using user data */
-    discover_t *discover = (discover_t *)user;
+    /* Drop the reference */
+    if (0 < __atomic_sub_fetch(&snapshot->refs, 1, __ATOMIC_ACQ_REL)) {
+        /* Snapshot still used */
+        return;
+    }
 
-    /* Invoke error callback if defined */
-    if (NULL != discover->cb.error.fct) {
-        discover->cb.error.fct(discover, err, discover->cb.error.user);
+    /* Release the copies of the nodes */
+    for (size_t index = 0; index < snapshot->count; index++) {
+        discover_clear_node(&snapshot->nodes[index]);
     }
+    if (NULL != snapshot->nodes) {
+        free(snapshot->nodes);
+    }
+    free(snapshot);
 }
 
 /**
- * @brief Generate UUID V4
- * @param buf Buffer to store UUID
- * @return 0 if the function succeeded, -1 otherwise
+ * @brief Allocate a snapshot of nodes
+ * @param capacity Maximum number of nodes of the snapshot
+ * @return Snapshot referenced once if the function succeeded, NULL otherwise
  */
-static int
-discover_generate_uuid(char **buf) {
-
-    assert(NULL != buf);
+static discover_nodes_snapshot_t *
+discover_create_snapshot(size_t capacity) {
 
-    /* Generate new UUID */
-    UUID4_STATE_T state;
-    UUID4_T       uuid;
-    uuid4_seed(&state);
-    uuid4_gen(&state, &uuid);
-
-    /* Convert UUID to string */
-    if (NULL == (*buf = (char *)malloc(UUID4_STR_BUFFER_SIZE + 1))) {
+    /* Allocate the snapshot */
+    discover_nodes_snapshot_t *snapshot = (discover_nodes_snapshot_t *)malloc(sizeof(discover_nodes_snapshot_t));
+    if (NULL == snapshot) {
         /* Unable to allocate memory */
-        return -1;
+        return NULL;
     }
-    memset(*buf, 0, UUID4_STR_BUFFER_SIZE + 1);
-    if (false == uuid4_to_s(uuid, *buf, UUID4_STR_BUFFER_SIZE)) {
-        /* Unable to generate UUID */
-        return -1;
+    memset(snapshot, 0, sizeof(discover_nodes_snapshot_t));
+
+    /* Allocate the copies of the nodes */
+    if ((0 < capacity) && (NULL == (snapshot->nodes = (discover_node_t *)malloc(capacity * sizeof(discover_node_t))))) {
+        /* Unable to allocate memory */
+        free(snapshot);
+        return NULL;
     }
+    snapshot->refs = 1;
 
-    return 0;
+    return snapshot;
+}
+
+/**
+ * @brief Add the copy of a node at the end of a snapshot, nodes semaphore must be taken
+ * @param snapshot Snapshot
+ * @param node Node
+ */
+static void
+discover_append_snapshot(discover_nodes_snapshot_t *snapshot, discover_node_t *node) {
+
+    assert(NULL != snapshot);
+    assert(NULL != node);
+
+    /* Copy the node and link it to the previous copy */
+    discover_node_t *copy = &snapshot->nodes[snapshot->count];
+    discover_copy_node(copy, node);
+    copy->prev = (0 < snapshot->count) ? &snapshot->nodes[snapshot->count - 1] : NULL;
+    copy->next = NULL;
+    if (NULL != copy->prev) {
+        copy->prev->next = copy;
+    }
+    snapshot->count++;
 }
@@ -0,0 +1,351 @@
+/**
+ * @file      poller.c
+ * @brief     Wait for events on a set of file descriptors
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021-2023 joelguittet and c-discover contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#define POLLER_KQUEUE
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#else
+#include <poll.h>
+#endif
+
+#include "poller.h"
+
+/******************************************************************************/
+/* Definitions                                                                */
+/******************************************************************************/
+
+/* Maximum number of events retrieved at once */
+#define POLLER_EVENTS_MAX 16
+
+/******************************************************************************/
+/* Prototypes                                                                 */
+/******************************************************************************/
+
+/**
+ * @brief Read the wake up file descriptor until it is empty
+ * @param poller Poller instance
+ */
+static void poller_drain(poller_t *poller);
+
+/******************************************************************************/
+/* Functions                                                                  */
+/******************************************************************************/
+
+/**
+ * @brief Function used to create a poller instance
+ * @return Poller instance if the function succeeded, NULL otherwise
+ */
+poller_t *
+poller_create(void) {
+
+    /* Create new poller instance */
+    poller_t *poller = (poller_t *)malloc(sizeof(poller_t));
+    if (NULL == poller) {
+        /* Unable to allocate memory */
+        return NULL;
+    }
+    memset(poller, 0, sizeof(poller_t));
+    poller->fd        = -1;
+    poller->wakeup[0] = -1;
+    poller->wakeup[1] = -1;
+
+    /* Create wake up file descriptors */
+#if defined(__linux__)
+    if (0 > (poller->wakeup[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))) {
+        /* Unable to create eventfd */
+        free(poller);
+        return NULL;
+    }
+    poller->wakeup[1] = poller->wakeup[0];
+#else
+    if (0 > pipe(poller->wakeup)) {
+        /* Unable to create pipe */
+        free(poller);
+        return NULL;
+    }
+    fcntl(poller->wakeup[0], F_SETFL, fcntl(poller->wakeup[0], F_GETFL) | O_NONBLOCK);
+    fcntl(poller->wakeup[1], F_SETFL, fcntl(poller->wakeup[1], F_GETFL) | O_NONBLOCK);
+#endif
+
+    /* Create epoll or kqueue instance, and watch the wake up file descriptor */
+#if defined(__linux__)
+    if (0 > (poller->fd = epoll_create1(EPOLL_CLOEXEC))) {
+        /* Unable to create epoll instance */
+        poller_release(poller);
+        return NULL;
+    }
+    struct epoll_event event;
+    memset(&event, 0, sizeof(struct epoll_event));
+    event.events  = EPOLLIN;
+    event.data.fd = poller->wakeup[0];
+    if (0 > epoll_ctl(poller->fd, EPOLL_CTL_ADD, poller->wakeup[0], &event)) {
+        /* Unable to watch wake up file descriptor */
+        poller_release(poller);
+        return NULL;
+    }
+#elif defined(POLLER_KQUEUE)
+    if (0 > (poller->fd = kqueue())) {
+        /* Unable to create kqueue instance */
+        poller_release(poller);
+        return NULL;
+    }
+    struct kevent event;
+    EV_SET(&event, poller->wakeup[0], EVFILT_READ, EV_ADD, 0, 0, NULL);
+    if (0 > kevent(poller->fd, &event, 1, NULL, 0, NULL)) {
+        /* Unable to watch wake up file descriptor */
+        poller_release(poller);
+        return NULL;
+    }
+#endif
+
+    return poller;
+}
+
+/**
+ * @brief Watch input on a file descriptor
+ * @param poller Poller instance
+ * @param fd File descriptor
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+poller_add(poller_t *poller, int fd) {
+
+    assert(NULL != poller);
+    assert(0 <= fd);
+
+    /* Add file descriptor to the table */
+    int *fds = (int *)realloc(poller->fds, (poller->count + 1) * sizeof(int));
+    if (NULL == fds) {
+        /* Unable to allocate memory */
+        return -1;
+    }
+    poller->fds = fds;
+
+    /* Watch file descriptor */
+#if defined(__linux__)
+    struct epoll_event event;
+    memset(&event, 0, sizeof(struct epoll_event));
+    event.events  = EPOLLIN;
+    event.data.fd = fd;
+    if (0 > epoll_ctl(poller->fd, EPOLL_CTL_ADD, fd, &event)) {
+        /* Unable to watch file descriptor */
+        return -1;
+    }
+#elif defined(POLLER_KQUEUE)
+    struct kevent event;
+    EV_SET(&event, fd, EVFILT_READ, EV_ADD, 0, 0, NULL);
+    if (0 > kevent(poller->fd, &event, 1, NULL, 0, NULL)) {
+        /* Unable to watch file descriptor */
+        return -1;
+    }
+#endif
+    poller->fds[poller->count++] = fd;
+
+    return 0;
+}
+
+/**
+ * @brief Wait until input arrives on one or more file descriptors
+ * @param poller Poller instance
+ * @param fds Table filled with the file descriptors with input pending
+ * @param max Size of the table
+ * @param timeout Timeout in milliseconds, -1 to wait forever
+ * @return Number of file descriptors with input pending, 0 on timeout or wake up, -1 otherwise
+ */
+int
+poller_wait(poller_t *poller, int *fds, int max, int timeout) {
+
+    assert(NULL != poller);
+    assert(NULL != fds);
+
+    int count = 0;
+
+    /* Limit the number of events retrieved */
+    if (POLLER_EVENTS_MAX < max) {
+        max = POLLER_EVENTS_MAX;
+    }
+
+#if defined(__linux__)
+
+    /* Wait for events */
+    struct epoll_event events[POLLER_EVENTS_MAX];
+    int                ret = epoll_wait(poller->fd, events, max, timeout);
+    if (0 > ret) {
+        return (EINTR == errno) ? 0 : -1;
+    }
+    for (int index = 0; index < ret; index++) {
+        if (events[index].data.fd == poller->wakeup[0]) {
+            poller_drain(poller);
+        } else {
+            fds[count++] = events[index].data.fd;
+        }
+    }
+
+#elif defined(POLLER_KQUEUE)
+
+    /* Wait for events */
+    struct kevent   events[POLLER_EVENTS_MAX];
+    struct timespec ts = { timeout / 1000, (timeout % 1000) * 1000000 };
+    int             ret = kevent(poller->fd, NULL, 0, events, max, (0 > timeout) ? NULL : &ts);
+    if (0 > ret) {
+        return (EINTR == errno) ? 0 : -1;
+    }
+    for (int index = 0; index < ret; index++) {
+        if ((int)events[index].ident == poller->wakeup[0]) {
+            poller_drain(poller);
+        } else {
+            fds[count++] = (int)events[index].ident;
+        }
+    }
+
+#else
+
+    /* Fallback to poll, build the table of file descriptors watched */
+    struct pollfd *pfds = (struct pollfd *)malloc((poller->count + 1) * sizeof(struct pollfd));
+    if (NULL == pfds) {
+        /* Unable to allocate memory */
+        return -1;
+    }
+    pfds[0].fd     = poller->wakeup[0];
+    pfds[0].events = POLLIN;
+    for (int index = 0; index < poller->count; index++) {
+        pfds[index + 1].fd     = poller->fds[index];
+        pfds[index + 1].events = POLLIN;
+    }
+
+    /* Wait for events */
+    int ret = poll(pfds, poller->count + 1, timeout);
+    if (0 > ret) {
+        free(pfds);
+        return (EINTR == errno) ? 0 : -1;
+    }
+    if (0 != (pfds[0].revents & POLLIN)) {
+        poller_drain(poller);
+    }
+    for (int index = 0; (index < poller->count) && (count < max); index++) {
+        if (0 != (pfds[index + 1].revents & POLLIN)) {
+            fds[count++] = pfds[index + 1].fd;
+        }
+    }
+    free(pfds);
+
+#endif
+
+    return count;
+}
+
+/**
+ * @brief Wake up the thread waiting on the poller
+ * @param poller Poller instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+poller_wakeup(poller_t *poller) {
+
+    assert(NULL != poller);
+
+    /* Write to the wake up file descriptor */
+#if defined(__linux__)
+    uint64_t value = 1;
+    if (sizeof(value) != write(poller->wakeup[1], &value, sizeof(value))) {
+        /* Unable to write, the counter is already set when it overflows */
+        return (EAGAIN == errno) ? 0 : -1;
+    }
+#else
+    char value = 1;
+    if (sizeof(value) != write(poller->wakeup[1], &value, sizeof(value))) {
+        /* Unable to write, the pipe is already readable when it is full */
+        return (EAGAIN == errno) ? 0 : -1;
+    }
+#endif
+
+    return 0;
+}
+
+/**
+ * @brief Release poller instance, the file descriptors watched are not closed
+ * @param poller Poller instance
+ */
+void
+poller_release(poller_t *poller) {
+
+    /* Release poller instance */
+    if (NULL != poller) {
+
+        /* Close epoll or kqueue instance */
+        if (0 <= poller->fd) {
+            close(poller->fd);
+        }
+
+        /* Close wake up file descriptors */
+        if (0 <= poller->wakeup[0]) {
+            close(poller->wakeup[0]);
+        }
+        if ((0 <= poller->wakeup[1]) && (poller->wakeup[1] != poller->wakeup[0])) {
+            close(poller->wakeup[1]);
+        }
+
+        /* Release table of file descriptors */
+        if (NULL != poller->fds) {
+            free(poller->fds);
+        }
+
+        /* Release poller instance */
+        free(poller);
+    }
+}
+
+/**
+ * @brief Read the wake up file descriptor until it is empty
+ * @param poller Poller instance
+ */
+static void
+poller_drain(poller_t *poller) {
+
+    /* Read until the file descriptor would block */
+    uint64_t value;
+    while (0 < read(poller->wakeup[0], &value, sizeof(value))) {
+        /* Nothing to do */
+    }
+}
@@ -29,18 +29,28 @@
 /* Includes                                                                   */
 /******************************************************************************/
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* Required for recvmmsg */
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 #include <assert.h>
-#include <sys/ioctl.h>
+#include <time.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <netdb.h>
+#include <ifaddrs.h>
 #include <semaphore.h>
 #include <pthread.h>
+#include <sched.h>
+#ifdef __linux__
+#include <linux/filter.h>
+#endif
 
 #include "sock.h"
 
@@ -55,6 +65,74 @@
  */
 static void *sock_thread_listenner(void *arg);
 
+/**
+ * @brief Start the listenners, one per shard, their sockets are opened before the function returns
+ * @param sock Sock instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int sock_start_listenners(sock_t *sock);
+
+/**
+ * @brief Create, configure and bind the sockets of a listenner
+ * @param sock Sock instance
+ * @param worker Listenner
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int sock_open_listenner(sock_t *sock, sock_worker_t *worker);
+
+/**
+ * @brief Close the sockets of a listenner and release its poller
+ * @param sock Sock instance
+ * @param worker Listenner
+ */
+static void sock_close_listenner(sock_t *sock, sock_worker_t *worker);
+
+/**
+ * @brief Create, configure and bind a socket of a listenner, the socket is added to the listenner, its poller and the clients sockets
+ * @param sock Sock instance
+ * @param worker Listenner
+ * @param interface Interface on which the multicast group is joined, NULL to let the system choose
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int sock_open_socket(sock_t *sock, sock_worker_t *worker, sock_interface_t *interface);
+
+/**
+ * @brief Join the multicast group and configure the multicast transmission of a socket
+ * @param sock Sock instance
+ * @param socket Socket
+ * @param interface Interface on which the multicast group is joined, NULL to let the system choose
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int sock_join_multicast(sock_t *sock, int socket, sock_interface_t *interface);
+
+/**
+ * @brief Set a socket option, the error is reported using the error callback
+ * @param sock Sock instance
+ * @param socket Socket
+ * @param level Level of the option
+ * @param name Name of the option
+ * @param value Value of the option
+ * @param length Length of the value
+ * @param option Name of the option, used to report the error
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int sock_set_socket_option(sock_t *sock, int socket, int level, int name, void *value, socklen_t length, char *option);
+
+/**
+ * @brief Attach the programs steering the datagrams of a sender to a single shard
+ * @param sock Sock instance
+ * @param socket Socket
+ * @param shard Shard of the socket
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int sock_attach_steering(sock_t *sock, int socket, int shard);
+
+/**
+ * @brief Pin the calling thread to a processor, depending of its shard
+ * @param shard Shard of the thread
+ */
+static void sock_pin_thread(int shard);
+
 /**
  * @brief Sock thread used to handle data received
  * @param arg Worker
@@ -62,6 +140,37 @@ static void *sock_thread_listenner(void *arg);
  */
 static void *sock_thread_messenger(void *arg);
 
+/**
+ * @brief Start the messengers and allocate the queue of datagrams received
+ * @param sock Sock instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int sock_start_messengers(sock_t *sock);
+
+/**
+ * @brief Read the datagrams pending on a socket and queue them, or handle them if no thread is created
+ * @param sock Sock instance
+ * @param socket Socket
+ * @return Number of datagrams read, 0 if no datagram is pending
+ */
+static int sock_receive(sock_t *sock, int socket);
+
+/**
+ * @brief Push a datagram slot to the queue of datagrams received
+ * @param sock Sock instance
+ * @param slot Datagram slot to push
+ * @return 0 if the function succeeded, -1 if the queue is full
+ */
+static int sock_push_datagram(sock_t *sock, sock_datagram_t *slot);
+
+/**
+ * @brief Give back datagram slots so that the listenner can reuse them
+ * @param sock Sock instance
+ * @param slots Datagram slots
+ * @param count Number of datagram slots
+ */
+static void sock_free_slots(sock_t *sock, sock_datagram_t **slots, int count);
+
 /**
  * @brief Sock thread used to send data
  * @param arg Worker
@@ -69,24 +178,96 @@ static void *sock_thread_messenger(void *arg);
  */
 static void *sock_thread_sender(void *arg);
 
+/**
+ * @brief Start the sender and allocate the queue of buffers to be sent
+ * @param sock Sock instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int sock_start_sender(sock_t *sock);
+
+/**
+ * @brief Push a buffer to the queue of buffers to be sent, or send it now if no thread is created
+ * @param sock Sock instance
+ * @param buffer Buffer to be sent
+ * @param size Size of buffer to send
+ * @param to Destination of the buffer, NULL to send the buffer to all destinations
+ * @return 0 if the function succeeded and the buffer is owned by the sock instance, -1 if the send queue is full or the sender is not started
+ */
+static int sock_push_buffer(sock_t *sock, void *buffer, size_t size, struct sockaddr_storage *to);
+
+/**
+ * @brief Pop the next buffer of the queue of buffers to be sent, must be called by the sender only
+ * @param sock Sock instance
+ * @param buffer Buffer to be sent
+ * @param size Size of buffer to send
+ * @param to Destination of the buffer, family AF_UNSPEC to send the buffer to all destinations
+ */
+static void sock_pop_buffer(sock_t *sock, void **buffer, size_t *size, struct sockaddr_storage *to);
+
+/**
+ * @brief Send buffer to all clients sockets depending of the configuration, or to a single destination
+ * @param sock Sock instance
+ * @param buffer Buffer to be sent
+ * @param size Size of buffer to send
+ * @param to Destination of the buffer, NULL to send the buffer to all destinations
+ */
+static void sock_send_buffer(sock_t *sock, void *buffer, size_t size, struct sockaddr_storage *to);
+
+/**
+ * @brief Parse the address to which the sockets are bound and the addresses to which the buffers are sent
+ * @param sock Sock instance
+ * @param addresses Addresses to which the buffers are sent, separated by a comma
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int sock_parse_addresses(sock_t *sock, char *addresses);
+
+/**
+ * @brief Parse a numeric address
+ * @param text Address, an IPv6 address may include a scope
+ * @param family Address family, AF_UNSPEC to accept both IPv4 and IPv6 addresses
+ * @param port Port
+ * @param addr Address parsed
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int sock_parse_address(char *text, int family, uint16_t port, struct sockaddr_storage *addr);
+
+/**
+ * @brief Parse the interfaces on which the multicast group is joined
+ * @param sock Sock instance
+ * @param interfaces Names of the interfaces, separated by a comma
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int sock_parse_interfaces(sock_t *sock, char *interfaces);
+
 /**
  * @brief Start a new worker
  * @param sock Sock instance
  * @param list List of workers to which the new one should be added
  * @param worker Worker to start
- * @param start_routine Worker thread function
+ * @param start_routine Worker thread function, NULL to only add the worker to the list
  * @return 0 if the function succeeded, -1 otherwise
  */
 static int sock_start_worker(sock_t *sock, sock_worker_list_t *list, sock_worker_t *worker, void *(*start_routine)(void *));
 
 /**
- * @brief Remove a worker
+ * @brief Count the workers of a list
+ * @param list Worker list
+ * @return Number of workers
+ */
+static int sock_count_workers(sock_worker_list_t *list);
+
+/**
+ * @brief Retrieve the number of shards receiving the datagrams
  * @param sock Sock instance
- * @param list List of workers to which the worker should be removed
- * @param worker Worker to remove
- * @return 0 if the function succeeded, -1 otherwise
+ * @return Number of shards, 1 if the datagrams are not sharded
+ */
+static int sock_count_shards(sock_t *sock);
+
+/**
+ * @brief Retrieve current time
+ * @return Time of the monotonic clock in microseconds
  */
-static int sock_remove_worker(sock_t *sock, sock_worker_list_t *list, sock_worker_t *worker);
+static uint64_t sock_get_time(void);
 
 /******************************************************************************/
 /* Functions                                                                  */
@@ -113,16 +294,93 @@ sock_create(void) {
     /* Initialize semaphore used to access messengers */
     sem_init(&sock->messengers.sem, 0, 1);
 
+    /* Initialize semaphores used to access queue of datagrams received */
+    sem_init(&sock->received.sem, 0, 1);
+    sem_init(&sock->received.pending, 0, 0);
+
     /* Initialize semaphore used to access senders */
     sem_init(&sock->senders.sem, 0, 1);
 
-    /* Initialize clients FDs and semaphore */
+    /* Initialize semaphore used to wake up the sender */
+    sem_init(&sock->sending.pending, 0, 0);
+
+    /* Initialize clients semaphore */
     sem_init(&sock->clients.sem, 0, 1);
-    FD_ZERO(&sock->clients.fds);
+
+    /* Set default options */
+    sock->options.receive_workers     = 4;
+    sock->options.receive_shards      = 1;
+    sock->options.receive_queue_depth = 128;
+    sock->options.send_queue_depth    = 128;
+    sock->options.max_datagram_size   = SOCK_DATAGRAM_SIZE_MAX;
+    sock->options.threaded            = true;
 
     return sock;
 }
 
+/**
+ * @brief Set sock options
+ * @param sock Sock instance
+ * @param option Option by name
+ * @param value New value of the option
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+sock_set_option(sock_t *sock, char *option, void *value) {
+
+    assert(NULL != sock);
+    assert(NULL != option);
+    assert(NULL != value);
+
+    int ret = -1;
+
+    /* Treatment depending of the option */
+    if (!strcmp("receiveWorkers", option)) {
+        int tmp = *((int *)value);
+        if (0 < tmp) {
+            sock->options.receive_workers = tmp;
+            ret                           = 0;
+        }
+    } else if (!strcmp("receiveShards", option)) {
+        int tmp = *((int *)value);
+        if ((0 < tmp) && (SOCK_RECEIVE_SHARDS_MAX >= tmp)) {
+            sock->options.receive_shards = tmp;
+            ret                          = 0;
+        }
+    } else if (!strcmp("receiveQueueDepth", option)) {
+        int tmp = *((int *)value);
+        if (0 < tmp) {
+            sock->options.receive_queue_depth = tmp;
+            ret                               = 0;
+        }
+    } else if (!strcmp("maxDatagramSize", option)) {
+        int tmp = *((int *)value);
+        if ((0 < tmp) && (SOCK_DATAGRAM_SIZE_MAX >= tmp)) {
+            sock->options.max_datagram_size = tmp;
+            ret                             = 0;
+        }
+    } else if (!strcmp("sendQueueDepth", option)) {
+        int tmp = *((int *)value);
+        if (0 < tmp) {
+            sock->options.send_queue_depth = tmp;
+            ret                            = 0;
+        }
+    } else if (!strcmp("threaded", option)) {
+        sock->options.threaded = *((bool *)value);
+        ret                    = 0;
+    } else if (!strcmp("interfaces", option)) {
+        if (NULL != sock->options.interfaces) {
+            free(sock->options.interfaces);
+        }
+        sock->options.interfaces = strdup((char *)value);
+        if (NULL != sock->options.interfaces) {
+            ret = 0;
+        }
+    }
+
+    return ret;
+}
+
 /**
  * @brief Bind a new socket to the wanted port, unicast configuration
  * @param sock Sock instance
@@ -139,33 +397,37 @@ sock_bind_unicast(sock_t *sock, char *address, uint16_t port, bool reuse_addr, c
     assert(NULL != address);
     assert(NULL != unicast);
 
-    /* Create new listenner */
-    sock_worker_t *worker = (sock_worker_t *)malloc(sizeof(sock_worker_t));
-    if (NULL == worker) {
-        /* Unable to allocate memory */
-        return -1;
-    }
-    memset(worker, 0, sizeof(sock_worker_t));
-
-    /* Store configuration, initialize FDs */
+    /* Store configuration */
     if (NULL == (sock->options.address = strdup(address))) {
         /* Unable to allocate memory */
-        free(worker);
         return -1;
     }
     sock->options.port       = port;
     sock->options.reuse_addr = reuse_addr;
     if (NULL == (sock->options.unicast = strdup(unicast))) {
         /* Unable to allocate memory */
-        free(worker);
         return -1;
     }
-    FD_ZERO(&worker->type.listenner.fds);
+    if (0 != sock_parse_addresses(sock, unicast)) {
+        /* Unable to parse addresses */
+        return -1;
+    }
 
-    /* Start listenner */
-    if (0 != sock_start_worker(sock, &sock->listenners, worker, sock_thread_listenner)) {
-        /* Unable to start the worker */
-        free(worker);
+    /* Start messengers */
+    if (0 != sock_start_messengers(sock)) {
+        /* Unable to start the messengers */
+        return -1;
+    }
+
+    /* Start sender */
+    if (0 != sock_start_sender(sock)) {
+        /* Unable to start the sender */
+        return -1;
+    }
+
+    /* Start listenners */
+    if (0 != sock_start_listenners(sock)) {
+        /* Unable to start the listenners */
         return -1;
     }
 
@@ -189,34 +451,42 @@ sock_bind_multicast(sock_t *sock, char *address, uint16_t port, bool reuse_addr,
     assert(NULL != address);
     assert(NULL != multicast);
 
-    /* Create new listenner */
-    sock_worker_t *worker = (sock_worker_t *)malloc(sizeof(sock_worker_t));
-    if (NULL == worker) {
-        /* Unable to allocate memory */
-        return -1;
-    }
-    memset(worker, 0, sizeof(sock_worker_t));
-
-    /* Store configuration, initialize FDs */
+    /* Store configuration */
     if (NULL == (sock->options.address = strdup(address))) {
         /* Unable to allocate memory */
-        free(worker);
         return -1;
     }
     sock->options.port       = port;
     sock->options.reuse_addr = reuse_addr;
     if (NULL == (sock->options.multicast = strdup(multicast))) {
         /* Unable to allocate memory */
-        free(worker);
+        return -1;
+    }
+    if ((0 != sock_parse_addresses(sock, multicast)) || (0 == sock->destinations.count)) {
+        /* Unable to parse addresses */
         return -1;
     }
     sock->options.multicast_ttl = multicast_ttl;
-    FD_ZERO(&worker->type.listenner.fds);
+    if ((NULL != sock->options.interfaces) && (0 != sock_parse_interfaces(sock, sock->options.interfaces))) {
+        /* Unable to parse interfaces */
+        return -1;
+    }
 
-    /* Start listenner */
-    if (0 != sock_start_worker(sock, &sock->listenners, worker, sock_thread_listenner)) {
-        /* Unable to start the worker */
-        free(worker);
+    /* Start messengers */
+    if (0 != sock_start_messengers(sock)) {
+        /* Unable to start the messengers */
+        return -1;
+    }
+
+    /* Start sender */
+    if (0 != sock_start_sender(sock)) {
+        /* Unable to start the sender */
+        return -1;
+    }
+
+    /* Start listenners */
+    if (0 != sock_start_listenners(sock)) {
+        /* Unable to start the listenners */
         return -1;
     }
 
@@ -239,33 +509,37 @@ sock_bind_broadcast(sock_t *sock, char *address, uint16_t port, bool reuse_addr,
     assert(NULL != address);
     assert(NULL != broadcast);
 
-    /* Create new listenner */
-    sock_worker_t *worker = (sock_worker_t *)malloc(sizeof(sock_worker_t));
-    if (NULL == worker) {
-        /* Unable to allocate memory */
-        return -1;
-    }
-    memset(worker, 0, sizeof(sock_worker_t));
-
-    /* Store configuration, initialize FDs */
+    /* Store configuration */
     if (NULL == (sock->options.address = strdup(address))) {
         /* Unable to allocate memory */
-        free(worker);
         return -1;
     }
     sock->options.port       = port;
     sock->options.reuse_addr = reuse_addr;
     if (NULL == (sock->options.broadcast = strdup(broadcast))) {
         /* Unable to allocate memory */
-        free(worker);
         return -1;
     }
-    FD_ZERO(&worker->type.listenner.fds);
+    if (0 != sock_parse_addresses(sock, broadcast)) {
+        /* Unable to parse addresses */
+        return -1;
+    }
 
-    /* Start listenner */
-    if (0 != sock_start_worker(sock, &sock->listenners, worker, sock_thread_listenner)) {
-        /* Unable to start the worker */
-        free(worker);
+    /* Start messengers */
+    if (0 != sock_start_messengers(sock)) {
+        /* Unable to start the messengers */
+        return -1;
+    }
+
+    /* Start sender */
+    if (0 != sock_start_sender(sock)) {
+        /* Unable to start the sender */
+        return -1;
+    }
+
+    /* Start listenners */
+    if (0 != sock_start_listenners(sock)) {
+        /* Unable to start the listenners */
         return -1;
     }
 
@@ -303,7 +577,7 @@ sock_on(sock_t *sock, char *topic, void *fct, void *user) {
  * @param sock Sock instance
  * @param buffer Buffer to be sent
  * @param size Size of buffer to send
- * @return 0 if the function succeeded, -1 otherwise
+ * @return 0 if the function succeeded and the buffer is owned by the sock instance, -1 if the send queue is full or the sender is not started
  */
 int
 sock_send(sock_t *sock, void *buffer, size_t size) {
@@ -311,25 +585,137 @@ sock_send(sock_t *sock, void *buffer, size_t size) {
     assert(NULL != sock);
     assert(NULL != buffer);
 
-    /* Create new sender */
-    sock_worker_t *worker = (sock_worker_t *)malloc(sizeof(sock_worker_t));
-    if (NULL == worker) {
-        /* Unable to allocate memory */
+    /* Send data to all destinations */
+    return sock_push_buffer(sock, buffer, size, NULL);
+}
+
+/**
+ * @brief Function used to send data to a single destination instead of all the destinations
+ * @param sock Sock instance
+ * @param ip Numeric IP address of the destination, as reported to the message callback
+ * @param port Port of the destination
+ * @param buffer Buffer to be sent
+ * @param size Size of buffer to send
+ * @return 0 if the function succeeded and the buffer is owned by the sock instance, -1 if the address is invalid or if the buffer cannot be queued
+ */
+int
+sock_send_to(sock_t *sock, char *ip, uint16_t port, void *buffer, size_t size) {
+
+    assert(NULL != sock);
+    assert(NULL != ip);
+    assert(NULL != buffer);
+
+    struct sockaddr_storage to;
+
+    /* Parse the destination, it must belong to the address family of the sockets */
+    if (0 != sock_parse_address(ip, sock->local.family, port, &to)) {
+        /* Invalid address */
         return -1;
     }
-    memset(worker, 0, sizeof(sock_worker_t));
 
-    /* Store buffer and size */
-    worker->type.sender.buffer = buffer;
-    worker->type.sender.size   = size;
+    /* Send data to the destination */
+    return sock_push_buffer(sock, buffer, size, &to);
+}
 
-    /* Start sender */
-    if (0 != sock_start_worker(sock, &sock->senders, worker, sock_thread_sender)) {
-        /* Unable to start the worker */
-        free(worker);
+/**
+ * @brief Retrieve the sockets to watch for input when no thread is created
+ * @param sock Sock instance
+ * @param fds Sockets
+ * @param max Maximum number of sockets
+ * @return Number of sockets
+ */
+int
+sock_get_fds(sock_t *sock, int *fds, int max) {
+
+    assert(NULL != sock);
+    assert((NULL != fds) || (0 == max));
+
+    /* Wait semaphore */
+    sem_wait(&sock->clients.sem);
+
+    /* Copy the sockets */
+    int count = 0;
+    while ((count < max) && (count < sock->clients.count)) {
+        fds[count] = sock->clients.sockets[count];
+        count++;
+    }
+
+    /* Release semaphore */
+    sem_post(&sock->clients.sem);
+
+    return count;
+}
+
+/**
+ * @brief Receive the datagrams pending and invoke the message callback, when no thread is created
+ * @param sock Sock instance
+ * @return Number of datagrams handled if the function succeeded, -1 otherwise
+ */
+int
+sock_process(sock_t *sock) {
+
+    assert(NULL != sock);
+
+    /* Check if the threads are created */
+    if (true == sock->options.threaded) {
         return -1;
     }
 
+    /* Read all the sockets, at most receiveQueueDepth datagrams are handled per socket so that the caller keeps control when flooded */
+    int handled = 0;
+    int index   = 0;
+    while (1) {
+
+        /* Retrieve the next socket, the semaphore is not held while receiving */
+        sem_wait(&sock->clients.sem);
+        int fd = (index < sock->clients.count) ? sock->clients.sockets[index++] : -1;
+        sem_post(&sock->clients.sem);
+        if (0 > fd) {
+            break;
+        }
+
+        /* Receive the datagrams pending */
+        int received = 0;
+        int ret;
+        while ((received < sock->options.receive_queue_depth) && (0 < (ret = sock_receive(sock, fd)))) {
+            received += ret;
+        }
+        handled += received;
+    }
+
+    return handled;
+}
+
+/**
+ * @brief Retrieve sock statistics
+ * @param sock Sock instance
+ * @param stats Statistics
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+sock_get_stats(sock_t *sock, sock_stats_t *stats) {
+
+    assert(NULL != sock);
+    assert(NULL != stats);
+
+    /* Retrieve counters of the queue of datagrams received */
+    sem_wait(&sock->received.sem);
+    stats->rx_dropped   = sock->received.dropped;
+    stats->rx_oversized = sock->received.oversized;
+    stats->rx_short     = sock->received.empty;
+    sem_post(&sock->received.sem);
+    stats->rx_packets = __atomic_load_n(&sock->received.received, __ATOMIC_RELAXED);
+    stats->rx_packets -= stats->rx_dropped + stats->rx_oversized + stats->rx_short;
+
+    /* Retrieve counters of the queue of buffers to be sent */
+    stats->tx_packets  = __atomic_load_n(&sock->sending.sent, __ATOMIC_RELAXED);
+    stats->tx_rejected = __atomic_load_n(&sock->sending.rejected, __ATOMIC_RELAXED);
+    stats->tx_errors   = __atomic_load_n(&sock->sending.errors, __ATOMIC_RELAXED);
+
+    /* Retrieve the number of threads */
+    stats->receive_threads = (1 < sock_count_shards(sock)) ? sock_count_workers(&sock->listenners) : sock_count_workers(&sock->messengers);
+    stats->send_threads    = sock_count_workers(&sock->senders);
+
     return 0;
 }
 
@@ -349,47 +735,85 @@ sock_release(sock_t *sock) {
         while (NULL != worker) {
             sock_worker_t *tmp = worker;
             worker             = worker->next;
-            pthread_cancel(tmp->thread);
-            pthread_join(tmp->thread, NULL);
-            for (int index = 0; index < FD_SETSIZE; index++) {
-                if (FD_ISSET(index, &tmp->type.listenner.fds)) {
-                    close(index);
-                }
+            if (true == sock->options.threaded) {
+                __atomic_store_n(&tmp->type.listenner.stop, true, __ATOMIC_RELEASE);
+                poller_wakeup(tmp->type.listenner.poller);
+                pthread_join(tmp->thread, NULL);
             }
+            sock_close_listenner(sock, tmp);
             free(tmp);
         }
         sem_post(&sock->listenners.sem);
         sem_close(&sock->listenners.sem);
 
-        /* Release messengers */
+        /* Release messengers, each one is woken up once and stops, so that none is stopped while it holds a lock in the message callback */
         sem_wait(&sock->messengers.sem);
+        __atomic_store_n(&sock->messengers.stop, true, __ATOMIC_RELEASE);
+        for (worker = sock->messengers.first; NULL != worker; worker = worker->next) {
+            sem_post(&sock->received.pending);
+        }
         worker = sock->messengers.first;
         while (NULL != worker) {
             sock_worker_t *tmp = worker;
             worker             = worker->next;
-            pthread_cancel(tmp->thread);
             pthread_join(tmp->thread, NULL);
-            free(tmp->type.messenger.buffer);
             free(tmp);
         }
         sem_post(&sock->messengers.sem);
         sem_close(&sock->messengers.sem);
 
-        /* Release senders */
+        /* Release datagram slots and queue */
+        sem_wait(&sock->received.sem);
+        if (NULL != sock->received.slots) {
+            free(sock->received.slots);
+        }
+        if (NULL != sock->received.buffers) {
+            free(sock->received.buffers);
+        }
+        if (NULL != sock->received.free) {
+            free(sock->received.free);
+        }
+        if (NULL != sock->received.items) {
+            free(sock->received.items);
+        }
+        sem_post(&sock->received.sem);
+        sem_close(&sock->received.sem);
+        sem_close(&sock->received.pending);
+
+        /* Release senders, each one is woken up once and stops, the buffers remaining in the queue are not sent */
         sem_wait(&sock->senders.sem);
+        __atomic_store_n(&sock->senders.stop, true, __ATOMIC_RELEASE);
+        for (worker = sock->senders.first; NULL != worker; worker = worker->next) {
+            sem_post(&sock->sending.pending);
+        }
         worker = sock->senders.first;
         while (NULL != worker) {
             sock_worker_t *tmp = worker;
             worker             = worker->next;
-            pthread_cancel(tmp->thread);
             pthread_join(tmp->thread, NULL);
-            free(tmp->type.sender.buffer);
+            if (NULL != tmp->type.sender.buffer) {
+                free(tmp->type.sender.buffer);
+            }
             free(tmp);
         }
         sem_post(&sock->senders.sem);
         sem_close(&sock->senders.sem);
 
-        /* Release clients semaphore */
+        /* Release buffers remaining in the queue */
+        if (NULL != sock->sending.cells) {
+            size_t mask = sock->sending.depth - 1;
+            while (sock->sending.cells[sock->sending.dequeue & mask].sequence == sock->sending.dequeue + 1) {
+                free(sock->sending.cells[sock->sending.dequeue & mask].buffer);
+                sock->sending.dequeue++;
+            }
+            free(sock->sending.cells);
+        }
+        sem_close(&sock->sending.pending);
+
+        /* Release clients sockets and semaphore */
+        if (NULL != sock->clients.sockets) {
+            free(sock->clients.sockets);
+        }
         sem_close(&sock->clients.sem);
 
         /* Release options */
@@ -405,6 +829,15 @@ sock_release(sock_t *sock) {
         if (NULL != sock->options.unicast) {
             free(sock->options.unicast);
         }
+        if (NULL != sock->options.interfaces) {
+            free(sock->options.interfaces);
+        }
+        if (NULL != sock->destinations.addrs) {
+            free(sock->destinations.addrs);
+        }
+        if (NULL != sock->interfaces.items) {
+            free(sock->interfaces.items);
+        }
 
         /* Release sock instance */
         free(sock);
@@ -425,54 +858,190 @@ sock_thread_listenner(void *arg) {
     sock_worker_t *worker = (sock_worker_t *)arg;
     sock_t *       sock   = worker->parent;
 
-    /* Create new SOCK_DGRAM socket */
-    worker->type.listenner.socket = socket(AF_INET, SOCK_DGRAM, 0);
-    if (0 > worker->type.listenner.socket) {
-        /* Unable to create socket */
-        if (NULL != sock->cb.error.fct) {
-            sock->cb.error.fct(sock, "sock: unable to create listenner socket", sock->cb.error.user);
-        }
-        goto END;
+    /* Each shard runs on its own processor */
+    if (1 < sock_count_shards(sock)) {
+        sock_pin_thread(worker->type.listenner.shard);
     }
 
-    /* Add myself to the FDs */
-    FD_SET(worker->type.listenner.socket, &worker->type.listenner.fds);
-    sem_wait(&sock->clients.sem);
-    FD_SET(worker->type.listenner.socket, &sock->clients.fds);
-    sem_post(&sock->clients.sem);
+    /* Loop until the listenner is stopped, the sockets are closed when releasing the sock instance */
+    while (false == __atomic_load_n(&worker->type.listenner.stop, __ATOMIC_ACQUIRE)) {
 
-    /* Set socket options */
-    if (NULL != sock->options.broadcast) {
-        int opt = 1;
-        if (0 > setsockopt(worker->type.listenner.socket, SOL_SOCKET, SO_BROADCAST, (void *)&opt, sizeof(opt))) {
-            /* Unable to set socket option */
-            close(worker->type.listenner.socket);
+        /* Block until input arrives on one or more active sockets, or the poller is woken up */
+        int fds[SOCK_RECEIVE_BATCH_SIZE];
+        int count = poller_wait(worker->type.listenner.poller, fds, SOCK_RECEIVE_BATCH_SIZE, -1);
+        if (0 > count) {
+            /* Unable to wait */
             if (NULL != sock->cb.error.fct) {
-                sock->cb.error.fct(sock, "sock: unable to set socket option SO_BROADCAST", sock->cb.error.user);
+                sock->cb.error.fct(sock, "sock: unable to wait for input", sock->cb.error.user);
             }
-            goto END;
+            return NULL;
+        }
+
+        /* Handling of all the sockets with input pending */
+        for (int index = 0; index < count; index++) {
+            /* Data arriving on an already-connected socket */
+            sock_receive(sock, fds[index]);
         }
     }
-    if (true == sock->options.reuse_addr) {
-        int opt = 1;
-        if (0 > setsockopt(worker->type.listenner.socket, SOL_SOCKET, SO_REUSEADDR, (void *)&opt, sizeof(opt))) {
-            /* Unable to set socket option */
-            close(worker->type.listenner.socket);
-            if (NULL != sock->cb.error.fct) {
-                sock->cb.error.fct(sock, "sock: unable to set socket option SO_REUSEADDR", sock->cb.error.user);
+
+    return NULL;
+}
+
+/**
+ * @brief Start the listenners, one per shard, their sockets are opened before the function returns
+ * @param sock Sock instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+sock_start_listenners(sock_t *sock) {
+
+    /* One listenner per shard, the sockets of the shards are opened in order so that their index in the group of sockets follows their shard */
+    int shards = sock_count_shards(sock);
+    for (int shard = 0; shard < shards; shard++) {
+
+        /* Create new listenner */
+        sock_worker_t *worker = (sock_worker_t *)malloc(sizeof(sock_worker_t));
+        if (NULL == worker) {
+            /* Unable to allocate memory */
+            return -1;
+        }
+        memset(worker, 0, sizeof(sock_worker_t));
+        worker->type.listenner.shard = shard;
+
+        /* Create poller of the listenner */
+        if (NULL == (worker->type.listenner.poller = poller_create())) {
+            /* Unable to create poller */
+            free(worker);
+            return -1;
+        }
+
+        /* Open the sockets, the messages can be sent as soon as the binding is done */
+        if (0 != sock_open_listenner(sock, worker)) {
+            /* Unable to open the sockets */
+            sock_close_listenner(sock, worker);
+            free(worker);
+            return -1;
+        }
+
+        /* Start listenner */
+        if (0 != sock_start_worker(sock, &sock->listenners, worker, (true == sock->options.threaded) ? sock_thread_listenner : NULL)) {
+            /* Unable to start the worker */
+            sock_close_listenner(sock, worker);
+            free(worker);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Create, configure and bind the sockets of a listenner
+ * @param sock Sock instance
+ * @param worker Listenner
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+sock_open_listenner(sock_t *sock, sock_worker_t *worker) {
+
+    assert(NULL != sock);
+    assert(NULL != worker);
+
+    /* One socket per interface when interfaces are given for multicast, a single socket otherwise */
+    int count = (0 < sock->interfaces.count) ? sock->interfaces.count : 1;
+    if (NULL == (worker->type.listenner.sockets = (int *)malloc(count * sizeof(int)))) {
+        /* Unable to allocate memory */
+        if (NULL != sock->cb.error.fct) {
+            sock->cb.error.fct(sock, "sock: unable to allocate memory", sock->cb.error.user);
+        }
+        return -1;
+    }
+
+    /* Open the sockets, the ones already opened if an error occurs are closed by the caller */
+    for (int index = 0; index < count; index++) {
+        if (0 != sock_open_socket(sock, worker, (0 < sock->interfaces.count) ? &sock->interfaces.items[index] : NULL)) {
+            /* Unable to open the socket, the error has been reported */
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Close the sockets of a listenner and release its poller
+ * @param sock Sock instance
+ * @param worker Listenner
+ */
+static void
+sock_close_listenner(sock_t *sock, sock_worker_t *worker) {
+
+    /* Close the sockets, they are removed from the clients sockets */
+    for (int socket = 0; socket < worker->type.listenner.count; socket++) {
+        sem_wait(&sock->clients.sem);
+        for (int index = 0; index < sock->clients.count; index++) {
+            if (sock->clients.sockets[index] == worker->type.listenner.sockets[socket]) {
+                sock->clients.sockets[index] = sock->clients.sockets[--sock->clients.count];
+                break;
             }
-            goto END;
         }
+        sem_post(&sock->clients.sem);
+        close(worker->type.listenner.sockets[socket]);
+    }
+    if (NULL != worker->type.listenner.sockets) {
+        free(worker->type.listenner.sockets);
+    }
+
+    /* Release poller */
+    poller_release(worker->type.listenner.poller);
+}
+
+/**
+ * @brief Create, configure and bind a socket of a listenner, the socket is added to the listenner, its poller and the clients sockets
+ * @param sock Sock instance
+ * @param worker Listenner
+ * @param interface Interface on which the multicast group is joined, NULL to let the system choose
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+sock_open_socket(sock_t *sock, sock_worker_t *worker, sock_interface_t *interface) {
+
+    int opt = 1;
+
+    /* Create new SOCK_DGRAM socket */
+    int fd = socket(sock->local.family, SOCK_DGRAM, 0);
+    if (0 > fd) {
+        /* Unable to create socket */
+        if (NULL != sock->cb.error.fct) {
+            sock->cb.error.fct(sock, "sock: unable to create listenner socket", sock->cb.error.user);
+        }
+        return -1;
+    }
+
+    /* Set socket options, the address is always reused when a socket is opened per interface */
+    if ((NULL != sock->options.broadcast) && (0 != sock_set_socket_option(sock, fd, SOL_SOCKET, SO_BROADCAST, &opt, sizeof(opt), "SO_BROADCAST"))) {
+        goto END;
+    }
+    if (((true == sock->options.reuse_addr) || (1 < sock->interfaces.count))
+        && (0 != sock_set_socket_option(sock, fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt), "SO_REUSEADDR"))) {
+        goto END;
+    }
+    if ((AF_INET6 == sock->local.family) && (0 != sock_set_socket_option(sock, fd, IPPROTO_IPV6, IPV6_V6ONLY, &opt, sizeof(opt), "IPV6_V6ONLY"))) {
+        goto END;
+    }
+#ifdef SO_REUSEPORT
+    if ((1 < sock_count_shards(sock)) && (0 != sock_set_socket_option(sock, fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt), "SO_REUSEPORT"))) {
+        goto END;
+    }
+#endif
+    if ((1 < sock_count_shards(sock)) && (0 != sock_attach_steering(sock, fd, worker->type.listenner.shard))) {
+        /* Unable to attach the steering programs, the error has been reported */
+        goto END;
     }
 
     /* Bind socket */
-    struct sockaddr_in addr_local;
-    addr_local.sin_family      = AF_INET;
-    addr_local.sin_addr.s_addr = inet_addr(sock->options.address);
-    addr_local.sin_port        = htons(sock->options.port);
-    if (0 > bind(worker->type.listenner.socket, (struct sockaddr *)&addr_local, sizeof(addr_local))) {
+    if (0 > bind(fd, (struct sockaddr *)&sock->local.addr, sock->local.length)) {
         /* Unable to bind socket */
-        close(worker->type.listenner.socket);
         if (NULL != sock->cb.error.fct) {
             sock->cb.error.fct(sock, "sock: unable to bind socket", sock->cb.error.user);
         }
@@ -480,89 +1049,246 @@ sock_thread_listenner(void *arg) {
     }
 
     /* Set more socket options */
-    if (NULL != sock->options.multicast) {
-        struct ip_mreq mreq;
-        mreq.imr_multiaddr.s_addr = inet_addr(sock->options.multicast);
-        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
-        if (0 > setsockopt(worker->type.listenner.socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, (void *)&mreq, sizeof(mreq))) {
-            /* Unable to set socket option */
-            close(worker->type.listenner.socket);
-            if (NULL != sock->cb.error.fct) {
-                sock->cb.error.fct(sock, "sock: unable to set socket option IP_ADD_MEMBERSHIP", sock->cb.error.user);
-            }
-            goto END;
+    if ((NULL != sock->options.multicast) && (0 != sock_join_multicast(sock, fd, interface))) {
+        /* Unable to join the multicast group, the error has been reported */
+        goto END;
+    }
+
+    /* Reserve room in the clients sockets, only the sockets of the first shard send the messages so that they are sent once */
+    sem_wait(&sock->clients.sem);
+    int *sockets = (int *)realloc(sock->clients.sockets, (sock->clients.count + 1) * sizeof(int));
+    if (NULL == sockets) {
+        /* Unable to allocate memory */
+        sem_post(&sock->clients.sem);
+        if (NULL != sock->cb.error.fct) {
+            sock->cb.error.fct(sock, "sock: unable to allocate memory", sock->cb.error.user);
         }
-        if (0 > setsockopt(worker->type.listenner.socket, IPPROTO_IP, IP_MULTICAST_TTL, (void *)&sock->options.multicast_ttl, sizeof(unsigned char))) {
-            /* Unable to set socket option */
-            close(worker->type.listenner.socket);
-            if (NULL != sock->cb.error.fct) {
-                sock->cb.error.fct(sock, "sock: unable to set socket option IP_MULTICAST_TTL", sock->cb.error.user);
-            }
-            goto END;
+        goto END;
+    }
+    sock->clients.sockets = sockets;
+    sem_post(&sock->clients.sem);
+
+    /* Add the socket to the poller */
+    if (0 != poller_add(worker->type.listenner.poller, fd)) {
+        /* Unable to watch the socket */
+        if (NULL != sock->cb.error.fct) {
+            sock->cb.error.fct(sock, "sock: unable to watch listenner socket", sock->cb.error.user);
         }
+        goto END;
     }
 
-    /* Infinite loop */
-    while (1) {
+    /* Add the socket to the clients sockets */
+    if (0 == worker->type.listenner.shard) {
+        sem_wait(&sock->clients.sem);
+        sock->clients.sockets[sock->clients.count++] = fd;
+        sem_post(&sock->clients.sem);
+    }
 
-        /* Block until input arrives on one or more active sockets */
-        fd_set         fds = worker->type.listenner.fds;
-        struct timeval tv  = { 5, 0 };
-        if (0 > select(FD_SETSIZE, &fds, NULL, NULL, &tv)) {
-            /* Unable to select */
-        }
+    /* Add the socket to the listenner, it is closed when releasing the sock instance */
+    worker->type.listenner.sockets[worker->type.listenner.count++] = fd;
 
-        /* Handling of all the sockets with input pending */
-        for (int index = 0; index < FD_SETSIZE; index++) {
-            if (FD_ISSET(index, &fds)) {
-                /* Data arriving on an already-connected socket */
-                size_t size = 0;
-                ioctl(index, FIONREAD, &size);
-                if (0 < size) {
-                    /* Create new messenger */
-                    sock_worker_t *w = (sock_worker_t *)malloc(sizeof(sock_worker_t));
-                    if (NULL != w) {
-                        memset(w, 0, sizeof(sock_worker_t));
-                        /* Store socket and size and create buffer */
-                        w->type.messenger.size   = size;
-                        w->type.messenger.buffer = malloc(size);
-                        if (NULL != w->type.messenger.buffer) {
-                            /* Read from socket */
-                            struct sockaddr_in addr_remote;
-                            socklen_t          size_remote = sizeof(addr_remote);
-                            if (size == recvfrom(index, w->type.messenger.buffer, size, 0, (struct sockaddr *)&addr_remote, &size_remote)) {
-                                /* Retrieve IP address and port of the sender */
-                                inet_ntop(AF_INET, &addr_remote.sin_addr, w->type.messenger.ip, sizeof(w->type.messenger.ip));
-                                w->type.messenger.port = ntohs(addr_remote.sin_port);
-                                /* Start messenger */
-                                if (0 != sock_start_worker(sock, &sock->messengers, w, sock_thread_messenger)) {
-                                    /* Unable to start the worker */
-                                    free(w->type.messenger.buffer);
-                                    free(w);
-                                }
-                            }
-                        } else {
-                            /* Unable to allocate memory */
-                            free(w);
-                        }
-                    }
-                }
+    return 0;
+
+END:
+
+    /* Release the socket */
+    close(fd);
+
+    return -1;
+}
+
+/**
+ * @brief Join the multicast group and configure the multicast transmission of a socket
+ * @param sock Sock instance
+ * @param socket Socket
+ * @param interface Interface on which the multicast group is joined, NULL to let the system choose
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+sock_join_multicast(sock_t *sock, int socket, sock_interface_t *interface) {
+
+    /* IPv6 multicast group, the interface is given by its index */
+    if (AF_INET6 == sock->local.family) {
+        struct ipv6_mreq mreq;
+        unsigned int     index = (NULL != interface) ? interface->index : 0;
+        int              hops  = sock->options.multicast_ttl;
+        mreq.ipv6mr_multiaddr  = ((struct sockaddr_in6 *)&sock->destinations.addrs[0])->sin6_addr;
+        mreq.ipv6mr_interface  = index;
+        if (0 != sock_set_socket_option(sock, socket, IPPROTO_IPV6, IPV6_JOIN_GROUP, &mreq, sizeof(mreq), "IPV6_JOIN_GROUP")) {
+            return -1;
+        }
+        if (0 != sock_set_socket_option(sock, socket, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &hops, sizeof(hops), "IPV6_MULTICAST_HOPS")) {
+            return -1;
+        }
+        if (NULL != interface) {
+            if (0 != sock_set_socket_option(sock, socket, IPPROTO_IPV6, IPV6_MULTICAST_IF, &index, sizeof(index), "IPV6_MULTICAST_IF")) {
+                return -1;
+            }
+#ifdef IPV6_MULTICAST_ALL
+            /* The datagrams of the groups joined by the other sockets are not wanted when a socket is opened per interface */
+            int all = 0;
+            if (0 != sock_set_socket_option(sock, socket, IPPROTO_IPV6, IPV6_MULTICAST_ALL, &all, sizeof(all), "IPV6_MULTICAST_ALL")) {
+                return -1;
             }
+#endif
+        }
+        return 0;
+    }
+
+    /* IPv4 multicast group, the interface is given by its address */
+    struct ip_mreq mreq;
+    mreq.imr_multiaddr = ((struct sockaddr_in *)&sock->destinations.addrs[0])->sin_addr;
+    if (NULL != interface) {
+        mreq.imr_interface = interface->address;
+    } else {
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+    }
+    if (0 != sock_set_socket_option(sock, socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq), "IP_ADD_MEMBERSHIP")) {
+        return -1;
+    }
+    if (0 != sock_set_socket_option(sock, socket, IPPROTO_IP, IP_MULTICAST_TTL, &sock->options.multicast_ttl, sizeof(unsigned char), "IP_MULTICAST_TTL")) {
+        return -1;
+    }
+    if (NULL != interface) {
+        if (0 != sock_set_socket_option(sock, socket, IPPROTO_IP, IP_MULTICAST_IF, &interface->address, sizeof(struct in_addr), "IP_MULTICAST_IF")) {
+            return -1;
+        }
+#ifdef IP_MULTICAST_ALL
+        /* The datagrams of the groups joined by the other sockets are not wanted when a socket is opened per interface */
+        int all = 0;
+        if (0 != sock_set_socket_option(sock, socket, IPPROTO_IP, IP_MULTICAST_ALL, &all, sizeof(all), "IP_MULTICAST_ALL")) {
+            return -1;
         }
+#endif
     }
 
-    /* Close my own socket */
-    close(worker->type.listenner.socket);
+    return 0;
+}
 
-END:
+/**
+ * @brief Set a socket option, the error is reported using the error callback
+ * @param sock Sock instance
+ * @param socket Socket
+ * @param level Level of the option
+ * @param name Name of the option
+ * @param value Value of the option
+ * @param length Length of the value
+ * @param option Name of the option, used to report the error
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+sock_set_socket_option(sock_t *sock, int socket, int level, int name, void *value, socklen_t length, char *option) {
 
-    /* Remove worker from listenners */
-    sock_remove_worker(sock, &sock->listenners, worker);
+    /* Set socket option */
+    if (0 > setsockopt(socket, level, name, value, length)) {
+        /* Unable to set socket option */
+        if (NULL != sock->cb.error.fct) {
+            char error[64];
+            snprintf(error, sizeof(error), "sock: unable to set socket option %s", option);
+            sock->cb.error.fct(sock, error, sock->cb.error.user);
+        }
+        return -1;
+    }
 
-    /* Release memory */
-    free(worker);
+    return 0;
+}
 
-    return NULL;
+/**
+ * @brief Attach the programs steering the datagrams of a sender to a single shard
+ * @param sock Sock instance
+ * @param socket Socket
+ * @param shard Shard of the socket
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+sock_attach_steering(sock_t *sock, int socket, int shard) {
+
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+
+    /* Hash of the sender address modulo the number of shards, the last 32 bits are used for IPv6 so that the link-local addresses differ */
+    uint32_t offset  = (uint32_t)SKF_NET_OFF + ((AF_INET6 == sock->local.family) ? 8 + 12 : 12);
+    uint32_t shards  = (uint32_t)sock_count_shards(sock);
+    uint32_t sockets = (0 < sock->interfaces.count) ? (uint32_t)sock->interfaces.count : 1;
+
+    /* The unicast datagrams are given to the socket of the group at the index returned, the first one of the shard as each shard has a socket per interface */
+    struct sock_filter steering[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offset),
+        BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 2654435761u),
+        BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 16),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, shards),
+        BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, sockets),
+        BPF_STMT(BPF_RET | BPF_A, 0),
+    };
+    struct sock_fprog program = { .len = sizeof(steering) / sizeof(struct sock_filter), .filter = steering };
+    if (0 != sock_set_socket_option(sock, socket, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program), "SO_ATTACH_REUSEPORT_CBPF")) {
+        return -1;
+    }
+
+    /* The multicast and broadcast datagrams are given by the system to all the sockets, each one only keeps the datagrams of its shard */
+    struct sock_filter filter[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offset),
+        BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 2654435761u),
+        BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 16),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, shards),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (uint32_t)shard, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, 0xFFFFFFFF),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+    program.len    = sizeof(filter) / sizeof(struct sock_filter);
+    program.filter = filter;
+    if (0 != sock_set_socket_option(sock, socket, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program), "SO_ATTACH_FILTER")) {
+        return -1;
+    }
+
+    return 0;
+
+#else
+
+    /* Steering is not supported */
+    (void)sock;
+    (void)socket;
+    (void)shard;
+    return -1;
+
+#endif
+}
+
+/**
+ * @brief Pin the calling thread to a processor, depending of its shard
+ * @param shard Shard of the thread
+ */
+static void
+sock_pin_thread(int shard) {
+
+#ifdef __linux__
+
+    cpu_set_t allowed;
+    cpu_set_t wanted;
+
+    /* Select the processor among the ones the process is allowed to use, the thread is not pinned if an error occurs */
+    if (0 != sched_getaffinity(0, sizeof(allowed), &allowed)) {
+        return;
+    }
+    int count = CPU_COUNT(&allowed);
+    if (0 == count) {
+        return;
+    }
+    int index = shard % count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if ((CPU_ISSET(cpu, &allowed)) && (0 == index--)) {
+            CPU_ZERO(&wanted);
+            CPU_SET(cpu, &wanted);
+            pthread_setaffinity_np(pthread_self(), sizeof(wanted), &wanted);
+            break;
+        }
+    }
+
+#else
+
+    /* Pinning is not supported */
+    (void)shard;
+
+#endif
 }
 
 /**
@@ -579,24 +1305,298 @@ sock_thread_messenger(void *arg) {
     sock_worker_t *worker = (sock_worker_t *)arg;
     sock_t *       sock   = worker->parent;
 
-    /* Check if message callback is define */
-    if (NULL != sock->cb.message.fct) {
+    /* Loop until the messenger is stopped */
+    while (1) {
 
-        /* Invoke message callback */
-        sock->cb.message.fct(
-            sock, worker->type.messenger.ip, worker->type.messenger.port, worker->type.messenger.buffer, worker->type.messenger.size, sock->cb.message.user);
-    }
+        /* Wait until a datagram is pending, or until the messenger is stopped */
+        if (0 != sem_wait(&sock->received.pending)) {
+            continue;
+        }
+        if (true == __atomic_load_n(&sock->messengers.stop, __ATOMIC_ACQUIRE)) {
+            break;
+        }
 
-    /* Remove worker from messengers */
-    sock_remove_worker(sock, &sock->messengers, worker);
+        /* Retrieve the first datagram of the queue */
+        sem_wait(&sock->received.sem);
+        worker->type.messenger = sock->received.items[sock->received.head];
+        sock->received.head    = (sock->received.head + 1) % sock->received.depth;
+        sock->received.count--;
+        sem_post(&sock->received.sem);
+
+        /* Check if message callback is define */
+        if (NULL != sock->cb.message.fct) {
+
+            /* Invoke message callback, the buffer belongs to the slot and is valid until the callback returns */
+            sock->cb.message.fct(sock,
+                                 worker->type.messenger->ip,
+                                 worker->type.messenger->port,
+                                 worker->type.messenger->buffer,
+                                 worker->type.messenger->size,
+                                 worker->type.messenger->time,
+                                 sock->cb.message.user);
+        }
 
-    /* Release memory */
-    free(worker->type.messenger.buffer);
-    free(worker);
+        /* Give back the slot */
+        sock_free_slots(sock, &worker->type.messenger, 1);
+        worker->type.messenger = NULL;
+    }
 
     return NULL;
 }
 
+/**
+ * @brief Start the messengers and allocate the queue of datagrams received
+ * @param sock Sock instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+sock_start_messengers(sock_t *sock) {
+
+    /* Check if the messengers are already started */
+    if (NULL != sock->received.items) {
+        return 0;
+    }
+
+    /* Allocate datagram slots, enough for a full queue, the messengers and a batch of the listenner, or only a batch per listenner if the datagrams are handled by the listenners */
+    int    shards = sock_count_shards(sock);
+    bool   pool   = ((true == sock->options.threaded) && (1 == shards)) ? true : false;
+    size_t slots  = SOCK_RECEIVE_BATCH_SIZE * shards;
+    if (true == pool) {
+        slots += sock->options.receive_queue_depth + sock->options.receive_workers;
+    }
+    if (NULL == (sock->received.slots = (sock_datagram_t *)malloc(slots * sizeof(sock_datagram_t)))) {
+        /* Unable to allocate memory */
+        return -1;
+    }
+    memset(sock->received.slots, 0, slots * sizeof(sock_datagram_t));
+    sock->received.size = sock->options.max_datagram_size;
+    if (NULL == (sock->received.buffers = malloc(slots * (sock->received.size + 1)))) {
+        /* Unable to allocate memory */
+        return -1;
+    }
+    if (NULL == (sock->received.free = (sock_datagram_t **)malloc(slots * sizeof(sock_datagram_t *)))) {
+        /* Unable to allocate memory */
+        return -1;
+    }
+    for (size_t index = 0; index < slots; index++) {
+        sock->received.slots[index].buffer = (char *)sock->received.buffers + index * (sock->received.size + 1);
+        sock->received.free[index]         = &sock->received.slots[index];
+    }
+    sock->received.unused = slots;
+
+    /* Allocate queue of datagrams received */
+    if (NULL == (sock->received.items = (sock_datagram_t **)malloc(sock->options.receive_queue_depth * sizeof(sock_datagram_t *)))) {
+        /* Unable to allocate memory */
+        return -1;
+    }
+    sock->received.depth = sock->options.receive_queue_depth;
+
+    /* Start the pool of messengers, the shards handle the datagrams they receive to keep the order of the datagrams of each sender */
+    for (int index = 0; (true == pool) && (index < sock->options.receive_workers); index++) {
+        sock_worker_t *worker = (sock_worker_t *)malloc(sizeof(sock_worker_t));
+        if (NULL == worker) {
+            /* Unable to allocate memory */
+            return -1;
+        }
+        memset(worker, 0, sizeof(sock_worker_t));
+        if (0 != sock_start_worker(sock, &sock->messengers, worker, sock_thread_messenger)) {
+            /* Unable to start the worker */
+            free(worker);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Read the datagrams pending on a socket and queue them, or handle them if no thread is created
+ * @param sock Sock instance
+ * @param socket Socket
+ * @return Number of datagrams read, 0 if no datagram is pending
+ */
+static int
+sock_receive(sock_t *sock, int socket) {
+
+    sock_datagram_t *       slots[SOCK_RECEIVE_BATCH_SIZE];
+    struct sockaddr_storage addrs[SOCK_RECEIVE_BATCH_SIZE];
+    bool                    truncated[SOCK_RECEIVE_BATCH_SIZE];
+    int                     count    = 0;
+    int                     received = 0;
+
+    /* Take free slots */
+    sem_wait(&sock->received.sem);
+    while ((SOCK_RECEIVE_BATCH_SIZE > count) && (0 < sock->received.unused)) {
+        slots[count++] = sock->received.free[--sock->received.unused];
+    }
+    sem_post(&sock->received.sem);
+
+    /* Check if slots are available */
+    if (0 == count) {
+        /* All the slots are queued or handled, read the datagram to drop it */
+        char dummy;
+        if (0 <= recv(socket, &dummy, sizeof(dummy), MSG_DONTWAIT)) {
+            __atomic_add_fetch(&sock->received.received, 1, __ATOMIC_RELAXED);
+            sem_wait(&sock->received.sem);
+            sock->received.dropped++;
+            sem_post(&sock->received.sem);
+            return 1;
+        }
+        return 0;
+    }
+
+#ifdef __linux__
+
+    /* Read as many datagrams as possible with a single system call */
+    struct mmsghdr msgs[SOCK_RECEIVE_BATCH_SIZE];
+    struct iovec   iovs[SOCK_RECEIVE_BATCH_SIZE];
+    memset(msgs, 0, sizeof(msgs));
+    for (int index = 0; index < count; index++) {
+        iovs[index].iov_base            = slots[index]->buffer;
+        iovs[index].iov_len             = sock->received.size;
+        msgs[index].msg_hdr.msg_name    = &addrs[index];
+        msgs[index].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        msgs[index].msg_hdr.msg_iov     = &iovs[index];
+        msgs[index].msg_hdr.msg_iovlen  = 1;
+    }
+    if (0 < (received = recvmmsg(socket, msgs, count, MSG_DONTWAIT, NULL))) {
+        for (int index = 0; index < received; index++) {
+            slots[index]->size = msgs[index].msg_len;
+            truncated[index]   = (0 != (msgs[index].msg_hdr.msg_flags & MSG_TRUNC)) ? true : false;
+        }
+    }
+
+#else
+
+    /* Read one datagram, recvmsg reports the datagrams truncated to the size of the buffer */
+    struct msghdr msg;
+    struct iovec  iov;
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base    = slots[0]->buffer;
+    iov.iov_len     = sock->received.size;
+    msg.msg_name    = &addrs[0];
+    msg.msg_namelen = sizeof(struct sockaddr_storage);
+    msg.msg_iov     = &iov;
+    msg.msg_iovlen  = 1;
+    ssize_t size    = recvmsg(socket, &msg, MSG_DONTWAIT);
+    if (0 <= size) {
+        slots[0]->size = size;
+        truncated[0]   = (0 != (msg.msg_flags & MSG_TRUNC)) ? true : false;
+        received       = 1;
+    }
+
+#endif
+
+    /* Queue the datagrams received, they share the time of the batch */
+    uint64_t now    = (0 < received) ? sock_get_time() : 0;
+    int      shards = sock_count_shards(sock);
+    if (0 < received) {
+        __atomic_add_fetch(&sock->received.received, received, __ATOMIC_RELAXED);
+    }
+    for (int index = 0; index < received; index++) {
+        slots[index]->time = now;
+        /* Drop the datagrams truncated because they are larger than the buffer, and the empty ones */
+        if ((true == truncated[index]) || (0 == slots[index]->size)) {
+            sem_wait(&sock->received.sem);
+            if (true == truncated[index]) {
+                sock->received.oversized++;
+            } else {
+                sock->received.empty++;
+            }
+            sem_post(&sock->received.sem);
+            sock_free_slots(sock, &slots[index], 1);
+            continue;
+        }
+        /* Terminate the data and retrieve IP address and port of the sender */
+        ((char *)slots[index]->buffer)[slots[index]->size] = '\0';
+        if (AF_INET6 == addrs[index].ss_family) {
+            struct sockaddr_in6 *addr = (struct sockaddr_in6 *)&addrs[index];
+            inet_ntop(AF_INET6, &addr->sin6_addr, slots[index]->ip, sizeof(slots[index]->ip));
+            slots[index]->port = ntohs(addr->sin6_port);
+        } else {
+            struct sockaddr_in *addr = (struct sockaddr_in *)&addrs[index];
+            inet_ntop(AF_INET, &addr->sin_addr, slots[index]->ip, sizeof(slots[index]->ip));
+            slots[index]->port = ntohs(addr->sin_port);
+        }
+        /* Handle the datagram now if no thread is created or if the datagrams are sharded */
+        if ((false == sock->options.threaded) || (1 < shards)) {
+            if (NULL != sock->cb.message.fct) {
+                sock->cb.message.fct(
+                    sock, slots[index]->ip, slots[index]->port, slots[index]->buffer, slots[index]->size, slots[index]->time, sock->cb.message.user);
+            }
+            sock_free_slots(sock, &slots[index], 1);
+            continue;
+        }
+        /* Queue datagram, it is dropped if the queue is full */
+        if (0 != sock_push_datagram(sock, slots[index])) {
+            sock_free_slots(sock, &slots[index], 1);
+        }
+    }
+
+    /* Give back the slots not used */
+    if (0 > received) {
+        received = 0;
+    }
+    if (received < count) {
+        sock_free_slots(sock, &slots[received], count - received);
+    }
+
+    return received;
+}
+
+/**
+ * @brief Push a datagram slot to the queue of datagrams received
+ * @param sock Sock instance
+ * @param slot Datagram slot to push
+ * @return 0 if the function succeeded, -1 if the queue is full
+ */
+static int
+sock_push_datagram(sock_t *sock, sock_datagram_t *slot) {
+
+    /* Wait semaphore */
+    sem_wait(&sock->received.sem);
+
+    /* Drop the new datagram if the queue is full, the datagrams already queued are kept in order */
+    if (sock->received.depth <= sock->received.count) {
+        sock->received.dropped++;
+        sem_post(&sock->received.sem);
+        return -1;
+    }
+
+    /* Add datagram at the end of the queue */
+    sock->received.items[(sock->received.head + sock->received.count) % sock->received.depth] = slot;
+    sock->received.count++;
+
+    /* Release semaphore */
+    sem_post(&sock->received.sem);
+
+    /* Wake up one messenger */
+    sem_post(&sock->received.pending);
+
+    return 0;
+}
+
+/**
+ * @brief Give back datagram slots so that the listenner can reuse them
+ * @param sock Sock instance
+ * @param slots Datagram slots
+ * @param count Number of datagram slots
+ */
+static void
+sock_free_slots(sock_t *sock, sock_datagram_t **slots, int count) {
+
+    /* Wait semaphore */
+    sem_wait(&sock->received.sem);
+
+    /* Push slots to the stack */
+    for (int index = 0; index < count; index++) {
+        sock->received.free[sock->received.unused++] = slots[index];
+    }
+
+    /* Release semaphore */
+    sem_post(&sock->received.sem);
+}
+
 /**
  * @brief Sock thread used to send data
  * @param arg Worker
@@ -611,79 +1611,435 @@ sock_thread_sender(void *arg) {
     sock_worker_t *worker = (sock_worker_t *)arg;
     sock_t *       sock   = worker->parent;
 
+    /* Loop until the sender is stopped */
+    while (1) {
+
+        /* Wait until a buffer is pending, or until the sender is stopped */
+        if (0 != sem_wait(&sock->sending.pending)) {
+            continue;
+        }
+        if (true == __atomic_load_n(&sock->senders.stop, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+
+        /* Retrieve the next buffer of the queue */
+        sock_pop_buffer(sock, &worker->type.sender.buffer, &worker->type.sender.size, &worker->type.sender.to);
+
+        /* Send data */
+        sock_send_buffer(sock,
+                         worker->type.sender.buffer,
+                         worker->type.sender.size,
+                         (AF_UNSPEC != worker->type.sender.to.ss_family) ? &worker->type.sender.to : NULL);
+
+        /* Release memory */
+        free(worker->type.sender.buffer);
+        worker->type.sender.buffer = NULL;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Start the sender and allocate the queue of buffers to be sent
+ * @param sock Sock instance
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+sock_start_sender(sock_t *sock) {
+
+    /* Check if the sender is already started, or if no thread is created and the buffers are sent directly */
+    if ((NULL != sock->sending.cells) || (false == sock->options.threaded)) {
+        return 0;
+    }
+
+    /* Allocate queue of buffers to be sent, the depth is rounded up to a power of 2 */
+    size_t depth = 1;
+    while (depth < (size_t)sock->options.send_queue_depth) {
+        depth <<= 1;
+    }
+    sock_send_cell_t *cells = (sock_send_cell_t *)malloc(depth * sizeof(sock_send_cell_t));
+    if (NULL == cells) {
+        /* Unable to allocate memory */
+        return -1;
+    }
+    memset(cells, 0, depth * sizeof(sock_send_cell_t));
+    for (size_t index = 0; index < depth; index++) {
+        cells[index].sequence = index;
+    }
+    sock->sending.depth = depth;
+
+    /* Start the sender */
+    sock_worker_t *worker = (sock_worker_t *)malloc(sizeof(sock_worker_t));
+    if (NULL == worker) {
+        /* Unable to allocate memory */
+        free(cells);
+        return -1;
+    }
+    memset(worker, 0, sizeof(sock_worker_t));
+    if (0 != sock_start_worker(sock, &sock->senders, worker, sock_thread_sender)) {
+        /* Unable to start the worker */
+        free(worker);
+        free(cells);
+        return -1;
+    }
+
+    /* Publish the queue, producers can use it from now */
+    __atomic_store_n(&sock->sending.cells, cells, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+/**
+ * @brief Push a buffer to the queue of buffers to be sent, or send it now if no thread is created
+ * @param sock Sock instance
+ * @param buffer Buffer to be sent
+ * @param size Size of buffer to send
+ * @param to Destination of the buffer, NULL to send the buffer to all destinations
+ * @return 0 if the function succeeded and the buffer is owned by the sock instance, -1 if the send queue is full or the sender is not started
+ */
+static int
+sock_push_buffer(sock_t *sock, void *buffer, size_t size, struct sockaddr_storage *to) {
+
+    /* Send data now if no thread is created */
+    if (false == sock->options.threaded) {
+        sock_send_buffer(sock, buffer, size, to);
+        free(buffer);
+        return 0;
+    }
+
+    /* Check if the sender is started */
+    if (NULL == sock->sending.cells) {
+        return -1;
+    }
+
+    /* Reserve a cell, several producers may compete for the same position */
+    size_t            mask     = sock->sending.depth - 1;
+    size_t            position = __atomic_load_n(&sock->sending.enqueue, __ATOMIC_RELAXED);
+    sock_send_cell_t *cell;
+    while (1) {
+        cell            = &sock->sending.cells[position & mask];
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        if (sequence == position) {
+            /* Cell is free, try to reserve it */
+            if (__atomic_compare_exchange_n(&sock->sending.enqueue, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (sequence < position) {
+            /* Queue is full, the caller is responsible of the buffer */
+            __atomic_fetch_add(&sock->sending.rejected, 1, __ATOMIC_RELAXED);
+            return -1;
+        } else {
+            /* Cell reserved by another producer, retry with the new position */
+            position = __atomic_load_n(&sock->sending.enqueue, __ATOMIC_RELAXED);
+        }
+    }
+
+    /* Store buffer, size and destination, then publish the cell */
+    cell->buffer = buffer;
+    cell->size   = size;
+    if (NULL != to) {
+        memcpy(&cell->to, to, sizeof(struct sockaddr_storage));
+    } else {
+        cell->to.ss_family = AF_UNSPEC;
+    }
+    __atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+
+    /* Wake up the sender */
+    sem_post(&sock->sending.pending);
+
+    return 0;
+}
+
+/**
+ * @brief Pop the next buffer of the queue of buffers to be sent, must be called by the sender only
+ * @param sock Sock instance
+ * @param buffer Buffer to be sent
+ * @param size Size of buffer to send
+ * @param to Destination of the buffer, family AF_UNSPEC to send the buffer to all destinations
+ */
+static void
+sock_pop_buffer(sock_t *sock, void **buffer, size_t *size, struct sockaddr_storage *to) {
+
+    /* Retrieve the next cell */
+    size_t            position = sock->sending.dequeue;
+    sock_send_cell_t *cell     = &sock->sending.cells[position & (sock->sending.depth - 1)];
+
+    /* The cell may be reserved but not yet published by its producer */
+    while (__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) != position + 1) {
+        sched_yield();
+    }
+
+    /* Retrieve buffer, size and destination, then release the cell for the next round */
+    *buffer = cell->buffer;
+    *size   = cell->size;
+    memcpy(to, &cell->to, sizeof(struct sockaddr_storage));
+    __atomic_store_n(&cell->sequence, position + sock->sending.depth, __ATOMIC_RELEASE);
+    sock->sending.dequeue = position + 1;
+}
+
+/**
+ * @brief Send buffer to all clients sockets depending of the configuration, or to a single destination
+ * @param sock Sock instance
+ * @param buffer Buffer to be sent
+ * @param size Size of buffer to send
+ * @param to Destination of the buffer, NULL to send the buffer to all destinations
+ */
+static void
+sock_send_buffer(sock_t *sock, void *buffer, size_t size, struct sockaddr_storage *to) {
+
     /* Wait semaphore */
     sem_wait(&sock->clients.sem);
 
-    /* Send data to all clients sockets depending of the configuration */
-    if (NULL != sock->options.unicast) {
-
-        /* Unicast */
-        char *unicast = strdup(sock->options.unicast);
-        if (NULL != unicast) {
-            char *saveptr = NULL;
-            char *pch     = strtok_r(unicast, ",", &saveptr);
-            while (NULL != pch) {
-                struct sockaddr_in addr;
-                addr.sin_family      = AF_INET;
-                addr.sin_port        = htons(sock->options.port);
-                addr.sin_addr.s_addr = inet_addr(pch);
-                for (int index = 0; index < FD_SETSIZE; index++) {
-                    if (FD_ISSET(index, &sock->clients.fds)) {
-                        if (worker->type.sender.size
-                            != sendto(index, worker->type.sender.buffer, worker->type.sender.size, 0, (struct sockaddr *)&addr, sizeof(addr))) {
-                            /* Unable to send data */
-                        }
-                    }
-                }
-                pch = strtok_r(NULL, ",", &saveptr);
+    /* Send data to the destination from the first client socket, only one copy is expected by the destination */
+    if (NULL != to) {
+        if (0 < sock->clients.count) {
+            if (size != sendto(sock->clients.sockets[0], buffer, size, 0, (struct sockaddr *)to, sock->local.length)) {
+                /* Unable to send data */
+                __atomic_add_fetch(&sock->sending.errors, 1, __ATOMIC_RELAXED);
+            } else {
+                __atomic_add_fetch(&sock->sending.sent, 1, __ATOMIC_RELAXED);
             }
-            free(unicast);
-        }
-
-    } else if (NULL != sock->options.multicast) {
-
-        /* Multicast */
-        struct sockaddr_in addr;
-        addr.sin_family      = AF_INET;
-        addr.sin_port        = htons(sock->options.port);
-        addr.sin_addr.s_addr = inet_addr(sock->options.multicast);
-        for (int index = 0; index < FD_SETSIZE; index++) {
-            if (FD_ISSET(index, &sock->clients.fds)) {
-                if (worker->type.sender.size
-                    != sendto(index, worker->type.sender.buffer, worker->type.sender.size, 0, (struct sockaddr *)&addr, sizeof(addr))) {
-                    /* Unable to send data */
-                }
+        }
+        sem_post(&sock->clients.sem);
+        return;
+    }
+
+    /* Send data to all destinations from all clients sockets */
+    for (int client = 0; client < sock->clients.count; client++) {
+        int fd = sock->clients.sockets[client];
+
+#ifdef __linux__
+
+        /* Send to as many destinations as possible with a single system call */
+        struct mmsghdr msgs[SOCK_SEND_BATCH_SIZE];
+        struct iovec   iov  = { .iov_base = buffer, .iov_len = size };
+        int            sent = 0;
+        while (sent < sock->destinations.count) {
+            int count = sock->destinations.count - sent;
+            if (SOCK_SEND_BATCH_SIZE < count) {
+                count = SOCK_SEND_BATCH_SIZE;
+            }
+            memset(msgs, 0, count * sizeof(struct mmsghdr));
+            for (int dest = 0; dest < count; dest++) {
+                msgs[dest].msg_hdr.msg_name    = &sock->destinations.addrs[sent + dest];
+                msgs[dest].msg_hdr.msg_namelen = sock->local.length;
+                msgs[dest].msg_hdr.msg_iov     = &iov;
+                msgs[dest].msg_hdr.msg_iovlen  = 1;
             }
+            int ret = sendmmsg(fd, msgs, count, 0);
+            if (0 >= ret) {
+                /* Unable to send data to the first destination of the batch, skip it */
+                __atomic_add_fetch(&sock->sending.errors, 1, __ATOMIC_RELAXED);
+                ret = 1;
+            } else {
+                __atomic_add_fetch(&sock->sending.sent, ret, __ATOMIC_RELAXED);
+            }
+            sent += ret;
         }
 
-    } else if (NULL != sock->options.broadcast) {
+#else
 
-        /* Broadcast */
-        struct sockaddr_in addr;
-        addr.sin_family      = AF_INET;
-        addr.sin_port        = htons(sock->options.port);
-        addr.sin_addr.s_addr = inet_addr(sock->options.broadcast);
-        for (int index = 0; index < FD_SETSIZE; index++) {
-            if (FD_ISSET(index, &sock->clients.fds)) {
-                if (worker->type.sender.size
-                    != sendto(index, worker->type.sender.buffer, worker->type.sender.size, 0, (struct sockaddr *)&addr, sizeof(addr))) {
-                    /* Unable to send data */
-                }
+        /* Send to each destination */
+        for (int dest = 0; dest < sock->destinations.count; dest++) {
+            if (size != sendto(fd, buffer, size, 0, (struct sockaddr *)&sock->destinations.addrs[dest], sock->local.length)) {
+                /* Unable to send data */
+                __atomic_add_fetch(&sock->sending.errors, 1, __ATOMIC_RELAXED);
+            } else {
+                __atomic_add_fetch(&sock->sending.sent, 1, __ATOMIC_RELAXED);
             }
         }
+
+#endif
     }
 
     /* Release semaphore */
     sem_post(&sock->clients.sem);
+}
 
-    /* Remove worker from senders */
-    sock_remove_worker(sock, &sock->senders, worker);
+/**
+ * @brief Parse the address to which the sockets are bound and the addresses to which the buffers are sent
+ * @param sock Sock instance
+ * @param addresses Addresses to which the buffers are sent, separated by a comma
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+sock_parse_addresses(sock_t *sock, char *addresses) {
 
-    /* Release memory */
-    free(worker->type.sender.buffer);
-    free(worker);
+    /* Parse the address to which the sockets are bound, it gives the address family */
+    if (0 != sock_parse_address(sock->options.address, AF_UNSPEC, sock->options.port, &sock->local.addr)) {
+        /* Invalid address */
+        if (NULL != sock->cb.error.fct) {
+            sock->cb.error.fct(sock, "sock: invalid address", sock->cb.error.user);
+        }
+        return -1;
+    }
+    sock->local.family = sock->local.addr.ss_family;
 
-    return NULL;
+    /* Any IPv4 address is replaced by any IPv6 address when the buffers are sent to IPv6 addresses, so that only the destinations need to be configured */
+    struct sockaddr_in *local = (struct sockaddr_in *)&sock->local.addr;
+    if ((AF_INET == sock->local.family) && (INADDR_ANY == ntohl(local->sin_addr.s_addr)) && (NULL != strchr(addresses, ':'))) {
+        sock_parse_address("::", AF_INET6, sock->options.port, &sock->local.addr);
+        sock->local.family = AF_INET6;
+    }
+    sock->local.length = (AF_INET6 == sock->local.family) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+
+    /* Release previous destinations */
+    if (NULL != sock->destinations.addrs) {
+        free(sock->destinations.addrs);
+        sock->destinations.addrs = NULL;
+    }
+    sock->destinations.count = 0;
+
+    /* Count the addresses to allocate the table */
+    int count = 1;
+    for (char *pch = addresses; '\0' != *pch; pch++) {
+        if (',' == *pch) {
+            count++;
+        }
+    }
+    if (NULL == (sock->destinations.addrs = (struct sockaddr_storage *)malloc(count * sizeof(struct sockaddr_storage)))) {
+        /* Unable to allocate memory */
+        return -1;
+    }
+    memset(sock->destinations.addrs, 0, count * sizeof(struct sockaddr_storage));
+
+    /* Parse addresses, invalid ones and the ones of the other address family are ignored */
+    char *tmp = strdup(addresses);
+    if (NULL == tmp) {
+        /* Unable to allocate memory */
+        return -1;
+    }
+    char *saveptr = NULL;
+    char *pch     = strtok_r(tmp, ",", &saveptr);
+    while (NULL != pch) {
+        if (0 == sock_parse_address(pch, sock->local.family, sock->options.port, &sock->destinations.addrs[sock->destinations.count])) {
+            sock->destinations.count++;
+        }
+        pch = strtok_r(NULL, ",", &saveptr);
+    }
+    free(tmp);
+
+    return 0;
+}
+
+/**
+ * @brief Parse a numeric address
+ * @param text Address, an IPv6 address may include a scope
+ * @param family Address family, AF_UNSPEC to accept both IPv4 and IPv6 addresses
+ * @param port Port
+ * @param addr Address parsed
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+sock_parse_address(char *text, int family, uint16_t port, struct sockaddr_storage *addr) {
+
+    struct addrinfo  hints;
+    struct addrinfo *result = NULL;
+
+    /* Parse the address, no name resolution is performed */
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = family;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags    = AI_NUMERICHOST;
+    if ((0 != getaddrinfo(text, NULL, &hints, &result)) || (NULL == result)) {
+        /* Invalid address */
+        return -1;
+    }
+
+    /* Copy the address and set the port */
+    memset(addr, 0, sizeof(struct sockaddr_storage));
+    memcpy(addr, result->ai_addr, result->ai_addrlen);
+    if (AF_INET6 == addr->ss_family) {
+        ((struct sockaddr_in6 *)addr)->sin6_port = htons(port);
+    } else {
+        ((struct sockaddr_in *)addr)->sin_port = htons(port);
+    }
+    freeaddrinfo(result);
+
+    return 0;
+}
+
+/**
+ * @brief Parse the interfaces on which the multicast group is joined
+ * @param sock Sock instance
+ * @param interfaces Names of the interfaces, separated by a comma
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+sock_parse_interfaces(sock_t *sock, char *interfaces) {
+
+    struct ifaddrs *ifaddrs = NULL;
+    int             ret     = 0;
+
+    /* Release previous interfaces */
+    if (NULL != sock->interfaces.items) {
+        free(sock->interfaces.items);
+        sock->interfaces.items = NULL;
+    }
+    sock->interfaces.count = 0;
+
+    /* Count the interfaces to allocate the table */
+    int count = 1;
+    for (char *pch = interfaces; '\0' != *pch; pch++) {
+        if (',' == *pch) {
+            count++;
+        }
+    }
+    if (NULL == (sock->interfaces.items = (sock_interface_t *)malloc(count * sizeof(sock_interface_t)))) {
+        /* Unable to allocate memory */
+        return -1;
+    }
+    memset(sock->interfaces.items, 0, count * sizeof(sock_interface_t));
+
+    /* Retrieve the addresses of the interfaces */
+    if (0 != getifaddrs(&ifaddrs)) {
+        /* Unable to retrieve the addresses */
+        return -1;
+    }
+
+    /* Parse interfaces, an unknown interface is an error so that the messages are not sent elsewhere */
+    char *tmp = strdup(interfaces);
+    if (NULL == tmp) {
+        /* Unable to allocate memory */
+        freeifaddrs(ifaddrs);
+        return -1;
+    }
+    char *saveptr = NULL;
+    char *pch     = strtok_r(tmp, ",", &saveptr);
+    while (NULL != pch) {
+        sock_interface_t *interface = &sock->interfaces.items[sock->interfaces.count];
+        if ((IF_NAMESIZE <= strlen(pch)) || (0 == (interface->index = if_nametoindex(pch)))) {
+            /* Unknown interface */
+            if (NULL != sock->cb.error.fct) {
+                sock->cb.error.fct(sock, "sock: unknown interface", sock->cb.error.user);
+            }
+            ret = -1;
+            break;
+        }
+        strcpy(interface->name, pch);
+        /* The IPv4 multicast groups are joined using the address of the interface */
+        interface->address.s_addr = htonl(INADDR_ANY);
+        for (struct ifaddrs *ifa = ifaddrs; NULL != ifa; ifa = ifa->ifa_next) {
+            if ((NULL != ifa->ifa_addr) && (AF_INET == ifa->ifa_addr->sa_family) && (!strcmp(ifa->ifa_name, pch))) {
+                interface->address = ((struct sockaddr_in *)ifa->ifa_addr)->sin_addr;
+                break;
+            }
+        }
+        if ((AF_INET == sock->local.family) && (INADDR_ANY == ntohl(interface->address.s_addr))) {
+            /* No IPv4 address on the interface */
+            if (NULL != sock->cb.error.fct) {
+                sock->cb.error.fct(sock, "sock: no IPv4 address on interface", sock->cb.error.user);
+            }
+            ret = -1;
+            break;
+        }
+        sock->interfaces.count++;
+        pch = strtok_r(NULL, ",", &saveptr);
+    }
+    free(tmp);
+    freeifaddrs(ifaddrs);
+
+    return ret;
 }
 
 /**
@@ -691,7 +2047,7 @@ sock_thread_sender(void *arg) {
  * @param sock Sock instance
  * @param list List of workers to which the worker should be added
  * @param worker Worker to start
- * @param start_routine Worker thread function
+ * @param start_routine Worker thread function, NULL to only add the worker to the list
  * @return 0 if the function succeeded, -1 otherwise
  */
 static int
@@ -703,16 +2059,18 @@ sock_start_worker(sock_t *sock, sock_worker_list_t *list, sock_worker_t *worker,
     /* Store sock parent instance */
     worker->parent = sock;
 
-    /* Initialize attributes of the thread */
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-
-    /* Start thread */
-    if (0 != pthread_create(&worker->thread, &attr, start_routine, (void *)worker)) {
-        /* Unable to start the thread */
-        sem_post(&list->sem);
-        return -1;
+    /* Start thread, it is joined when releasing the sock instance */
+    if (NULL != start_routine) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+        if (0 != pthread_create(&worker->thread, &attr, start_routine, (void *)worker)) {
+            /* Unable to start the thread */
+            pthread_attr_destroy(&attr);
+            sem_post(&list->sem);
+            return -1;
+        }
+        pthread_attr_destroy(&attr);
     }
 
     /* Add worker to the daisy chain */
@@ -731,34 +2089,57 @@ sock_start_worker(sock_t *sock, sock_worker_list_t *list, sock_worker_t *worker,
 }
 
 /**
- * @brief Remove a worker
+ * @brief Count the workers of a list
+ * @param list Worker list
+ * @return Number of workers
+ */
+static int
+sock_count_workers(sock_worker_list_t *list) {
+
+    int count = 0;
+
+    /* Walk the daisy chain */
+    sem_wait(&list->sem);
+    for (sock_worker_t *worker = list->first; NULL != worker; worker = worker->next) {
+        count++;
+    }
+    sem_post(&list->sem);
+
+    return count;
+}
+
+/**
+ * @brief Retrieve the number of shards receiving the datagrams
  * @param sock Sock instance
- * @param list List of workers to which the worker should be removed
- * @param worker Worker to remove
- * @return 0 if the function succeeded, -1 otherwise
+ * @return Number of shards, 1 if the datagrams are not sharded
  */
 static int
-sock_remove_worker(sock_t *sock, sock_worker_list_t *list, sock_worker_t *worker) {
+sock_count_shards(sock_t *sock) {
+
+#ifdef SO_ATTACH_REUSEPORT_CBPF
 
+    /* The shards are only used when threads are created */
+    return (true == sock->options.threaded) ? sock->options.receive_shards : 1;
+
+#else
+
+    /* The system can't steer the datagrams of a sender to a shard */
     (void)sock;
+    return 1;
 
-    /* Wait semaphore */
-    sem_wait(&list->sem);
+#endif
+}
 
-    /* Remove the worker from the daisy chain */
-    if (NULL != worker->prev) {
-        worker->prev->next = worker->next;
-    } else {
-        list->first = worker->next;
-    }
-    if (NULL != worker->next) {
-        worker->next->prev = worker->prev;
-    } else {
-        list->last = worker->prev;
-    }
+/**
+ * @brief Retrieve current time
+ * @return Time of the monotonic clock in microseconds
+ */
+static uint64_t
+sock_get_time(void) {
 
-    /* Release semaphore */
-    sem_post(&list->sem);
+    /* The monotonic clock is not affected by the changes of the system time */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
 
-    return 0;
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
 }
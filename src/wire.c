@@ -0,0 +1,331 @@
+/**
+ * @file      wire.c
+ * @brief     Binary encoding of the messages
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021-2023 joelguittet and c-discover contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "wire.h"
+
+/******************************************************************************/
+/* Definitions                                                                */
+/******************************************************************************/
+
+/* Size of the header of the binary messages: magic byte, version, type and flags */
+#define WIRE_HEADER_SIZE 4
+
+/* Size of a raw UUID */
+#define WIRE_UUID_SIZE 16
+
+/* Flags of the hello message */
+#define WIRE_FLAG_MASTER          0x01
+#define WIRE_FLAG_MASTER_ELIGIBLE 0x02
+#define WIRE_FLAG_ADVERTISEMENT   0x04
+#define WIRE_FLAG_HASH            0x08
+#define WIRE_FLAG_CHANNELS        0x10
+
+/******************************************************************************/
+/* Prototypes                                                                 */
+/******************************************************************************/
+
+/**
+ * @brief Convert UUID string to raw UUID
+ * @param str UUID string
+ * @param uuid Raw UUID
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int wire_parse_uuid(const char *str, uint8_t *uuid);
+
+/**
+ * @brief Convert raw UUID to UUID string
+ * @param uuid Raw UUID
+ * @param str UUID string, WIRE_UUID_STR_SIZE bytes
+ */
+static void wire_format_uuid(const uint8_t *uuid, char *str);
+
+/******************************************************************************/
+/* Functions                                                                  */
+/******************************************************************************/
+
+/**
+ * @brief Check if a buffer contains a binary message
+ * @param buffer Buffer
+ * @param size Size of the buffer
+ * @return true if the buffer starts with the magic byte and a supported version, false otherwise
+ */
+bool
+wire_is_binary(void *buffer, size_t size) {
+
+    assert(NULL != buffer);
+
+    uint8_t *pos = (uint8_t *)buffer;
+
+    return ((WIRE_HEADER_SIZE <= size) && (WIRE_MAGIC == pos[0]) && (WIRE_VERSION == pos[1])) ? true : false;
+}
+
+/**
+ * @brief Encode hello message
+ * @param hello Hello message
+ * @param size Size of the message encoded
+ * @return Message encoded if the function succeeded, NULL otherwise, it must be released by the caller
+ */
+void *
+wire_encode_hello(wire_hello_t *hello, size_t *size) {
+
+    assert(NULL != hello);
+    assert(NULL != size);
+
+    /* Check the length of the strings */
+    size_t hostname_length = (NULL != hello->hostname) ? strlen(hello->hostname) : 0;
+    size_t address_length  = (NULL != hello->address) ? strlen(hello->address) : 0;
+    if ((WIRE_STRING_LENGTH_MAX < hostname_length) || (WIRE_STRING_LENGTH_MAX < address_length)) {
+        /* Strings are too long */
+        return NULL;
+    }
+
+    /* Allocate memory, strings are length-prefixed and null terminated so that they can be used in place once decoded */
+    *size = WIRE_HEADER_SIZE + 2 * WIRE_UUID_SIZE + sizeof(uint64_t) + (1 + hostname_length + 1) + (1 + address_length + 1)
+            + ((0 != hello->advertisement_hash) ? sizeof(uint32_t) : 0) + ((NULL != hello->channels) ? WIRE_CHANNELS_SIZE : 0) + sizeof(uint16_t)
+            + ((NULL != hello->advertisement) ? hello->advertisement_size : 0);
+    uint8_t *buffer = (uint8_t *)malloc(*size);
+    if (NULL == buffer) {
+        /* Unable to allocate memory */
+        return NULL;
+    }
+    uint8_t *pos = buffer;
+
+    /* Header */
+    *pos++ = WIRE_MAGIC;
+    *pos++ = WIRE_VERSION;
+    *pos++ = WIRE_TYPE_HELLO;
+    *pos++ = ((true == hello->is_master) ? WIRE_FLAG_MASTER : 0) | ((true == hello->is_master_eligible) ? WIRE_FLAG_MASTER_ELIGIBLE : 0)
+             | ((NULL != hello->advertisement) ? WIRE_FLAG_ADVERTISEMENT : 0) | ((0 != hello->advertisement_hash) ? WIRE_FLAG_HASH : 0)
+             | ((NULL != hello->channels) ? WIRE_FLAG_CHANNELS : 0);
+
+    /* UUIDs */
+    if ((0 != wire_parse_uuid(hello->pid, pos)) || (0 != wire_parse_uuid(hello->iid, pos + WIRE_UUID_SIZE))) {
+        /* Invalid UUIDs */
+        free(buffer);
+        return NULL;
+    }
+    pos += 2 * WIRE_UUID_SIZE;
+
+    /* Weight, IEEE 754 double in network byte order */
+    uint64_t weight;
+    memcpy(&weight, &hello->weight, sizeof(uint64_t));
+    for (int index = 7; index >= 0; index--) {
+        *pos++ = (uint8_t)(weight >> (8 * index));
+    }
+
+    /* Hostname and address */
+    *pos++ = (uint8_t)hostname_length;
+    memcpy(pos, (NULL != hello->hostname) ? hello->hostname : "", hostname_length + 1);
+    pos += hostname_length + 1;
+    *pos++ = (uint8_t)address_length;
+    memcpy(pos, (NULL != hello->address) ? hello->address : "", address_length + 1);
+    pos += address_length + 1;
+
+    /* Advertisement hash, in network byte order */
+    if (0 != hello->advertisement_hash) {
+        for (int index = 3; index >= 0; index--) {
+            *pos++ = (uint8_t)(hello->advertisement_hash >> (8 * index));
+        }
+    }
+
+    /* Bloom filter of the channels joined */
+    if (NULL != hello->channels) {
+        memcpy(pos, hello->channels, WIRE_CHANNELS_SIZE);
+        pos += WIRE_CHANNELS_SIZE;
+    }
+
+    /* Advertisement */
+    size_t advertisement_size = (NULL != hello->advertisement) ? hello->advertisement_size : 0;
+    *pos++                    = (uint8_t)(advertisement_size >> 8);
+    *pos++                    = (uint8_t)advertisement_size;
+    if (NULL != hello->advertisement) {
+        memcpy(pos, hello->advertisement, advertisement_size);
+    }
+
+    return buffer;
+}
+
+/**
+ * @brief Decode hello message, strings of the hello message point to the buffer
+ * @param buffer Buffer
+ * @param size Size of the buffer
+ * @param hello Hello message
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+int
+wire_decode_hello(void *buffer, size_t size, wire_hello_t *hello) {
+
+    assert(NULL != buffer);
+    assert(NULL != hello);
+
+    uint8_t *pos = (uint8_t *)buffer;
+    uint8_t *end = pos + size;
+
+    /* Header */
+    if ((WIRE_HEADER_SIZE + 2 * WIRE_UUID_SIZE + sizeof(uint64_t) + 1 > size) || (WIRE_TYPE_HELLO != pos[2])) {
+        /* Invalid message */
+        return -1;
+    }
+    uint8_t flags             = pos[3];
+    hello->is_master          = (0 != (flags & WIRE_FLAG_MASTER)) ? true : false;
+    hello->is_master_eligible = (0 != (flags & WIRE_FLAG_MASTER_ELIGIBLE)) ? true : false;
+    pos += WIRE_HEADER_SIZE;
+
+    /* UUIDs */
+    wire_format_uuid(pos, hello->pid);
+    wire_format_uuid(pos + WIRE_UUID_SIZE, hello->iid);
+    pos += 2 * WIRE_UUID_SIZE;
+
+    /* Weight */
+    uint64_t weight = 0;
+    for (int index = 0; index < 8; index++) {
+        weight = (weight << 8) | *pos++;
+    }
+    memcpy(&hello->weight, &weight, sizeof(double));
+
+    /* Hostname and address, the null character must be present */
+    size_t length = *pos++;
+    if ((end - pos < (ptrdiff_t)(length + 2)) || ('\0' != pos[length])) {
+        /* Invalid message */
+        return -1;
+    }
+    hello->hostname = (char *)pos;
+    pos += length + 1;
+    length       = *pos++;
+    size_t fixed = ((0 != (flags & WIRE_FLAG_HASH)) ? sizeof(uint32_t) : 0) + ((0 != (flags & WIRE_FLAG_CHANNELS)) ? WIRE_CHANNELS_SIZE : 0) + sizeof(uint16_t);
+    if ((end - pos < (ptrdiff_t)(length + 1 + fixed)) || ('\0' != pos[length])) {
+        /* Invalid message */
+        return -1;
+    }
+    hello->address = (char *)pos;
+    pos += length + 1;
+
+    /* Advertisement hash */
+    hello->advertisement_hash = 0;
+    if (0 != (flags & WIRE_FLAG_HASH)) {
+        for (int index = 0; index < 4; index++) {
+            hello->advertisement_hash = (hello->advertisement_hash << 8) | *pos++;
+        }
+    }
+
+    /* Bloom filter of the channels joined */
+    hello->channels = NULL;
+    if (0 != (flags & WIRE_FLAG_CHANNELS)) {
+        hello->channels = pos;
+        pos += WIRE_CHANNELS_SIZE;
+    }
+
+    /* Advertisement */
+    hello->advertisement_size = (uint16_t)((pos[0] << 8) | pos[1]);
+    pos += sizeof(uint16_t);
+    if (end - pos != hello->advertisement_size) {
+        /* Invalid message */
+        return -1;
+    }
+    hello->advertisement = (0 != (flags & WIRE_FLAG_ADVERTISEMENT)) ? (char *)pos : NULL;
+
+    return 0;
+}
+
+/**
+ * @brief Convert UUID string to raw UUID
+ * @param str UUID string
+ * @param uuid Raw UUID
+ * @return 0 if the function succeeded, -1 otherwise
+ */
+static int
+wire_parse_uuid(const char *str, uint8_t *uuid) {
+
+    /* Parse the 32 hexadecimal digits, separated by dashes at the usual positions */
+    int count = 0;
+    for (int index = 0; index < WIRE_UUID_STR_SIZE - 1; index++) {
+        char c = str[index];
+        if ((8 == index) || (13 == index) || (18 == index) || (23 == index)) {
+            if ('-' != c) {
+                /* Invalid UUID */
+                return -1;
+            }
+            continue;
+        }
+        int digit;
+        if (('0' <= c) && ('9' >= c)) {
+            digit = c - '0';
+        } else if (('a' <= c) && ('f' >= c)) {
+            digit = c - 'a' + 10;
+        } else {
+            /* Invalid UUID, only lower case is accepted so that the UUID is the same once decoded */
+            return -1;
+        }
+        if (0 == (count % 2)) {
+            uuid[count / 2] = (uint8_t)(digit << 4);
+        } else {
+            uuid[count / 2] |= (uint8_t)digit;
+        }
+        count++;
+    }
+
+    return ('\0' == str[WIRE_UUID_STR_SIZE - 1]) ? 0 : -1;
+}
+
+/**
+ * @brief Convert raw UUID to UUID string
+ * @param uuid Raw UUID
+ * @param str UUID string, WIRE_UUID_STR_SIZE bytes
+ */
+static void
+wire_format_uuid(const uint8_t *uuid, char *str) {
+
+    snprintf(str,
+             WIRE_UUID_STR_SIZE,
+             "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+             uuid[0],
+             uuid[1],
+             uuid[2],
+             uuid[3],
+             uuid[4],
+             uuid[5],
+             uuid[6],
+             uuid[7],
+             uuid[8],
+             uuid[9],
+             uuid[10],
+             uuid[11],
+             uuid[12],
+             uuid[13],
+             uuid[14],
+             uuid[15]);
+}